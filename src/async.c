@@ -0,0 +1,186 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Continuations for commands that need a result of the web process or the
+ * clipboard. Instead of iterating the main loop until the result arrives the
+ * command returns and the continuation is called with the result later. The
+ * continuations of a client are dropped without being called if the client
+ * is destroyed before.
+ */
+#include <gtk/gtk.h>
+#include <webkit/webkit.h>
+
+#include "async.h"
+#include "main.h"
+#include "trace.h"
+
+extern struct Vimb vb;
+
+typedef struct {
+    Client          *c;
+    AsyncTextFunc   func;
+    gpointer        data;
+    GDestroyNotify  destroy;
+    GCancellable    *cancellable;
+    guint64         id;         /* identifies the async trace span */
+} Cont;
+
+static struct {
+    GHashTable  *cancellables;  /* Client* -> GCancellable* */
+    guint64     next_id;
+} async;
+
+static Cont *cont_new(Client *c, AsyncTextFunc func, gpointer data,
+        GDestroyNotify destroy);
+static void cont_resume(Cont *cont, const char *text);
+static void cont_free(Cont *cont);
+static void on_eval_finished(GObject *source, GAsyncResult *res, Cont *cont);
+static void on_clipboard_finished(GObject *source, GAsyncResult *res, Cont *cont);
+
+
+/**
+ * Evaluate the script in the webextension and call func with the result.
+ */
+void async_eval(Client *c, const char *js, AsyncTextFunc func, gpointer data,
+        GDestroyNotify destroy)
+{
+    Cont *cont = cont_new(c, func, data, destroy);
+    WebKitUserMessage *message;
+
+    if (!c->webview) {
+        cont_resume(cont, NULL);
+        return;
+    }
+    message = webkit_user_message_new("EvalJs", g_variant_new("(s)", js));
+    webkit_web_view_send_message_to_page(c->webview, message, cont->cancellable,
+            (GAsyncReadyCallback)on_eval_finished, cont);
+}
+
+/**
+ * Read the primary selection or the clipboard and call func with the text.
+ */
+void async_clipboard(Client *c, gboolean primary, AsyncTextFunc func,
+        gpointer data, GDestroyNotify destroy)
+{
+    Cont *cont = cont_new(c, func, data, destroy);
+    GdkDisplay *display;
+    GdkClipboard *clipboard;
+
+    display   = gtk_widget_get_display(GTK_WIDGET(c->window));
+    clipboard = primary ? gdk_display_get_primary_clipboard(display)
+                        : gdk_display_get_clipboard(display);
+    gdk_clipboard_read_text_async(clipboard, cont->cancellable,
+            (GAsyncReadyCallback)on_clipboard_finished, cont);
+}
+
+/**
+ * Drop the waiting continuations of the client.
+ */
+void async_client_cancel(Client *c)
+{
+    GCancellable *cancellable;
+
+    if (async.cancellables && (cancellable = g_hash_table_lookup(async.cancellables, c))) {
+        g_cancellable_cancel(cancellable);
+        g_hash_table_remove(async.cancellables, c);
+    }
+}
+
+void async_cleanup(void)
+{
+    if (async.cancellables) {
+        g_hash_table_destroy(async.cancellables);
+        async.cancellables = NULL;
+    }
+}
+
+static Cont *cont_new(Client *c, AsyncTextFunc func, gpointer data,
+        GDestroyNotify destroy)
+{
+    Cont *cont = g_slice_new0(Cont);
+    GCancellable *cancellable;
+
+    if (!async.cancellables) {
+        async.cancellables = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, g_object_unref);
+    }
+    if (!(cancellable = g_hash_table_lookup(async.cancellables, c))) {
+        cancellable = g_cancellable_new();
+        g_hash_table_insert(async.cancellables, c, cancellable);
+    }
+
+    cont->c           = c;
+    cont->func        = func;
+    cont->data        = data;
+    cont->destroy     = destroy;
+    cont->cancellable = g_object_ref(cancellable);
+    cont->id          = ++async.next_id;
+    trace_async_begin("async", cont->id);
+
+    return cont;
+}
+
+/**
+ * Call the continuation unless its client was destroyed meanwhile.
+ */
+static void cont_resume(Cont *cont, const char *text)
+{
+    if (!g_cancellable_is_cancelled(cont->cancellable)) {
+        cont->func(cont->c, text, cont->data);
+    }
+    cont_free(cont);
+}
+
+static void cont_free(Cont *cont)
+{
+    trace_async_end("async", cont->id);
+    if (cont->destroy) {
+        cont->destroy(cont->data);
+    }
+    g_object_unref(cont->cancellable);
+    g_slice_free(Cont, cont);
+}
+
+static void on_eval_finished(GObject *source, GAsyncResult *res, Cont *cont)
+{
+    WebKitUserMessage *reply;
+    GVariant *params;
+    gboolean success = FALSE;
+    char *value = NULL;
+
+    reply = webkit_web_view_send_message_to_page_finish(WEBKIT_WEB_VIEW(source), res, NULL);
+    if (reply) {
+        if ((params = webkit_user_message_get_parameters(reply))) {
+            g_variant_get(params, "(bs)", &success, &value);
+        }
+        g_object_unref(reply);
+    }
+    cont_resume(cont, success ? value : NULL);
+    g_free(value);
+}
+
+static void on_clipboard_finished(GObject *source, GAsyncResult *res, Cont *cont)
+{
+    char *text;
+
+    text = gdk_clipboard_read_text_finish(GDK_CLIPBOARD(source), res, NULL);
+    cont_resume(cont, text);
+    g_free(text);
+}
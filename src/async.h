@@ -0,0 +1,36 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _ASYNC_H
+#define _ASYNC_H
+
+#include "main.h"
+
+/* Continuation of an operation that waits for another process. The text is
+ * NULL if the operation failed and is only valid during the call. */
+typedef void (*AsyncTextFunc)(Client *c, const char *text, gpointer data);
+
+void async_eval(Client *c, const char *js, AsyncTextFunc func, gpointer data,
+        GDestroyNotify destroy);
+void async_clipboard(Client *c, gboolean primary, AsyncTextFunc func,
+        gpointer data, GDestroyNotify destroy);
+void async_client_cancel(Client *c);
+void async_cleanup(void);
+
+#endif /* end of include guard: _ASYNC_H */
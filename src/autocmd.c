@@ -24,6 +24,7 @@
 #include "autocmd.h"
 #include "ascii.h"
 #include "ex.h"
+#include "trace.h"
 #include "util.h"
 #include "completion.h"
 
@@ -64,6 +65,8 @@ static AuGroup *new_group(const char *name);
 static void free_group(AuGroup *group);
 static AutoCmd *new_autocmd(const char *excmd, const char *pattern);
 static void free_autocmd(AutoCmd *cmd);
+static gboolean run(Client *c, AuEvent event, const char *uri, NavContext *nav,
+        const char *group);
 
 
 void autocmd_init(Client *c)
@@ -245,56 +248,17 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
  */
 gboolean autocmd_run(Client *c, AuEvent event, const char *uri, const char *group)
 {
-    GSList  *lg, *lc, *lcc;
-    AuGroup *grp;
-    AutoCmd *cmd, *new;
-    guint bits = events[event].bits;
-
-    /* if there is no autocmd for this event - skip here */
-    if (!(c->autocmd.usedbits & bits)) {
-        return true;
-    }
-
-    /* loop over the groups and find matching commands */
-    for (lg = c->autocmd.groups; lg; lg = lg->next) {
-        grp = lg->data;
-        /* if a group was given - skip all none matching groupes */
-        if (group && strcmp(group, grp->name)) {
-            continue;
-        }
-
-        /* make a deep copy of grp->cmds since it can be modified by ex_run_string() below */
-        lcc = NULL;
-        for (lc = grp->cmds; lc; lc = lc->next) {
-            cmd = lc->data;
-            new = new_autocmd(cmd->excmd, cmd->pattern);
-            new->bits = cmd->bits;
-            lcc = g_slist_prepend(lcc, new); // use prepend+reverse instead of append for efficiency
-        }
-        lcc = g_slist_reverse(lcc);
-
-        /* test each command in group */
-        for (lc = lcc; lc; lc = lc->next, free_autocmd(cmd)) {
-            cmd = lc->data;
-            /* skip if this dos not match the event bits */
-            if (!(bits & cmd->bits)) {
-                continue;
-            }
-            /* check pattern only if uri was given */
-            /* skip if pattern does not match */
-            if (uri && !util_wildmatch(cmd->pattern, uri)) {
-                continue;
-            }
-            /* run the command */
-            /* TODO shoult the result be tested for RESULT_COMPLETE? */
-            /* run command and make sure it's not writte to command history */
-            ex_run_string(c, cmd->excmd, false);
-        }
-
-        g_slist_free(lcc);
-    }
+    return run(c, event, uri, NULL, group);
+}
 
-    return true;
+/**
+ * Run the auto commands for a load event of the navigation. The patterns are
+ * matched once per navigation. If nav is NULL all commands of the event are
+ * run like for autocmd_run() without uri.
+ */
+gboolean autocmd_run_nav(Client *c, AuEvent event, NavContext *nav)
+{
+    return run(c, event, nav ? nav->uri : NULL, nav, NULL);
 }
 
 gboolean autocmd_fill_group_completion(Client *c, GListStore *store, const char *input)
@@ -499,4 +463,59 @@ static void free_autocmd(AutoCmd *cmd)
     g_slice_free(AutoCmd, cmd);
 }
 
+static gboolean run(Client *c, AuEvent event, const char *uri, NavContext *nav,
+        const char *group)
+{
+    GSList  *lg, *lc, *matched = NULL;
+    AuGroup *grp;
+    AutoCmd *cmd;
+    guint bits = events[event].bits;
+
+    /* if there is no autocmd for this event - skip here */
+    if (!(c->autocmd.usedbits & bits)) {
+        return true;
+    }
+
+    trace_begin("autocmd_run");
+    /* loop over the groups and collect the matching commands */
+    for (lg = c->autocmd.groups; lg; lg = lg->next) {
+        grp = lg->data;
+        /* if a group was given - skip all none matching groupes */
+        if (group && strcmp(group, grp->name)) {
+            continue;
+        }
+
+        for (lc = grp->cmds; lc; lc = lc->next) {
+            cmd = lc->data;
+            /* skip if this dos not match the event bits */
+            if (!(bits & cmd->bits)) {
+                continue;
+            }
+            /* check pattern only if uri was given */
+            /* skip if pattern does not match */
+            if (nav && !nav_wildmatch(nav, cmd->pattern)) {
+                continue;
+            }
+            if (!nav && uri && !util_wildmatch(cmd->pattern, uri)) {
+                continue;
+            }
+            /* copy the command since the groups can be modified by
+             * ex_run_string() below */
+            matched = g_slist_prepend(matched, g_strdup(cmd->excmd)); // use prepend+reverse instead of append for efficiency
+        }
+    }
+    matched = g_slist_reverse(matched);
+
+    for (lc = matched; lc; lc = lc->next) {
+        /* run the command */
+        /* TODO shoult the result be tested for RESULT_COMPLETE? */
+        /* run command and make sure it's not writte to command history */
+        ex_run_string(c, (char*)lc->data, false);
+    }
+    g_slist_free_full(matched, g_free);
+    trace_end("autocmd_run");
+
+    return true;
+}
+
 #endif
@@ -24,6 +24,7 @@
 #define _AUTOCMD_H
 
 #include "main.h"
+#include "nav.h"
 
 /* this values correspond to indices in events[] array in autocmd.c */
 typedef enum {
@@ -44,6 +45,7 @@ void autocmd_cleanup(Client *c);
 gboolean autocmd_augroup(Client *c, char *name, gboolean delete);
 gboolean autocmd_add(Client *c, char *name, gboolean delete);
 gboolean autocmd_run(Client *c, AuEvent event, const char *uri, const char *group);
+gboolean autocmd_run_nav(Client *c, AuEvent event, NavContext *nav);
 gboolean autocmd_fill_group_completion(Client *c, GListStore *store, const char *input);
 gboolean autocmd_fill_event_completion(Client *c, GListStore *store, const char *input);
 
@@ -0,0 +1,337 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "config.h"
+#include "main.h"
+#include "bench-load.h"
+#include "perf.h"
+#include "util.h"
+
+extern struct Vimb vb;
+
+/* Result of the load of a single uri of the list. */
+typedef struct {
+    char        *uri;
+    gboolean    done;
+    gboolean    timeout;
+    PerfRecord  record;         /* copy of the record without uri */
+    long        peak_rss;       /* peak rss of the ui process in kB after the load */
+} BenchResult;
+
+/* A tab that loads one uri after the other. */
+typedef struct {
+    Client      *c;
+    BenchResult *result;        /* the load in progress or NULL */
+    gint64      started;        /* monotonic time the load was requested */
+    guint       timer;
+} BenchSlot;
+
+static struct {
+    GPtrArray   *results;       /* BenchResult in order of the uri file */
+    guint       next;           /* index of the next uri to load */
+    guint       pending;        /* number of loads not done yet */
+    GSList      *slots;
+    char        *report;        /* file to write the report to or NULL */
+    int         jobs;
+    gint64      started;
+    int         status;
+} bench = {NULL, 0, 0, NULL, NULL, 1, 0, EXIT_SUCCESS};
+
+static void on_record(Client *c, const PerfRecord *record);
+static gboolean on_timeout(gpointer data);
+static void slot_next(BenchSlot *slot);
+static void result_done(BenchSlot *slot);
+static void finish(void);
+static void write_csv(FILE *out);
+static void write_json(FILE *out, gint64 total);
+static const char *result_status(BenchResult *r);
+static long get_peak_rss(void);
+static void slot_free(BenchSlot *slot);
+static void result_free(BenchResult *r);
+
+
+/**
+ * Load the uris listed in file one after the other or in up to jobs tabs in
+ * parallel. Once all pages are loaded the report is written to the report
+ * file, as JSON if the file name ends in .json or CSV else, or as CSV to
+ * stdout and vimb quits.
+ */
+gboolean bench_load_start(Client *c, const char *file, int jobs,
+        const char *report, GError **error)
+{
+    char *content, **lines;
+    BenchResult *r;
+    BenchSlot *slot;
+
+    if (!g_file_get_contents(file, &content, NULL, error)) {
+        return FALSE;
+    }
+    bench.results = g_ptr_array_new_with_free_func((GDestroyNotify)result_free);
+    lines = g_strsplit(content, "\n", -1);
+    for (int i = 0; lines[i]; i++) {
+        char *line = g_strstrip(lines[i]);
+        if (*line && *line != '#') {
+            r      = g_slice_new0(BenchResult);
+            r->uri = g_strdup(line);
+            g_ptr_array_add(bench.results, r);
+        }
+    }
+    g_strfreev(lines);
+    g_free(content);
+
+    if (!bench.results->len) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "no uris found in %s", file);
+        g_ptr_array_free(bench.results, TRUE);
+        bench.results = NULL;
+        return FALSE;
+    }
+
+    bench.pending = bench.results->len;
+    bench.jobs    = CLAMP(jobs, 1, (int)bench.results->len);
+    bench.report  = g_strdup(report);
+    bench.started = g_get_monotonic_time();
+    perf_set_record_func(on_record);
+
+    /* the first slot uses the given tab, further ones get an own tab */
+    for (int i = 0; i < bench.jobs; i++) {
+        slot    = g_slice_new0(BenchSlot);
+        slot->c = i ? vb_tab_new(NULL, NULL) : c;
+        bench.slots = g_slist_append(bench.slots, slot);
+    }
+    for (GSList *l = bench.slots; l; l = l->next) {
+        slot_next(l->data);
+    }
+
+    return TRUE;
+}
+
+/**
+ * Returns the exit status of the benchmark.
+ */
+int bench_load_status(void)
+{
+    return bench.status;
+}
+
+static void on_record(Client *c, const PerfRecord *record)
+{
+    BenchSlot *slot;
+
+    for (GSList *l = bench.slots; l; l = l->next) {
+        slot = l->data;
+        /* Ignore records of loads started before the uri was requested,
+         * those belong to a previous uri that timed out. */
+        if (slot->c == c && slot->result && record->started >= slot->started) {
+            slot->result->record     = *record;
+            slot->result->record.uri = NULL;
+            result_done(slot);
+            return;
+        }
+    }
+}
+
+static gboolean on_timeout(gpointer data)
+{
+    BenchSlot *slot = data;
+
+    slot->timer = 0;
+    if (slot->result) {
+        slot->result->timeout = TRUE;
+        result_done(slot);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Start the load of the next uri in the tab of the slot.
+ */
+static void slot_next(BenchSlot *slot)
+{
+    if (bench.next >= bench.results->len) {
+        return;
+    }
+    slot->result  = g_ptr_array_index(bench.results, bench.next++);
+    slot->started = g_get_monotonic_time();
+    slot->timer   = g_timeout_add_seconds(BENCH_LOAD_TIMEOUT, on_timeout, slot);
+    vb_load_uri(slot->c, &(Arg){TARGET_CURRENT, slot->result->uri});
+}
+
+static void result_done(BenchSlot *slot)
+{
+    if (slot->timer) {
+        g_source_remove(slot->timer);
+        slot->timer = 0;
+    }
+    slot->result->done     = TRUE;
+    slot->result->peak_rss = get_peak_rss();
+    slot->result           = NULL;
+
+    if (--bench.pending) {
+        slot_next(slot);
+    } else {
+        finish();
+    }
+}
+
+/**
+ * Write the report and quit vimb.
+ */
+static void finish(void)
+{
+    FILE *out = stdout;
+    gint64 total = g_get_monotonic_time() - bench.started;
+
+    perf_set_record_func(NULL);
+    for (guint i = 0; i < bench.results->len; i++) {
+        BenchResult *r = g_ptr_array_index(bench.results, i);
+        if (r->timeout || r->record.failed) {
+            g_printerr("%s: %s\n", result_status(r), r->uri);
+        }
+    }
+    if (bench.report && !(out = g_fopen(bench.report, "w"))) {
+        g_printerr("can't write report %s: %s\n", bench.report, g_strerror(errno));
+        bench.status = EXIT_FAILURE;
+    } else {
+        if (bench.report && g_str_has_suffix(bench.report, ".json")) {
+            write_json(out, total);
+        } else {
+            write_csv(out);
+        }
+        if (out != stdout) {
+            fclose(out);
+        } else {
+            fflush(out);
+        }
+    }
+
+    g_slist_free_full(bench.slots, (GDestroyNotify)slot_free);
+    bench.slots = NULL;
+    g_ptr_array_free(bench.results, TRUE);
+    bench.results = NULL;
+    g_clear_pointer(&bench.report, g_free);
+
+    vb_quit_all(TRUE);
+}
+
+static void write_csv(FILE *out)
+{
+    BenchResult *r;
+    char **parts, *uri;
+
+    fputs("uri,status,commit_ms,finish_ms,ttfb_ms,dcl_ms,load_ms,fcp_ms,"
+            "transfer_bytes,handler_ms,peak_rss_kb\n", out);
+    for (guint i = 0; i < bench.results->len; i++) {
+        r = g_ptr_array_index(bench.results, i);
+        /* quotes within the quoted field are doubled */
+        parts = g_strsplit(r->uri, "\"", -1);
+        uri   = g_strjoinv("\"\"", parts);
+        fprintf(out, "\"%s\",%s,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%" G_GINT64_FORMAT ",%.1f,%ld\n",
+                uri, result_status(r),
+                r->record.committed / 1000.0,
+                r->record.finished / 1000.0,
+                r->record.page[PERF_TTFB],
+                r->record.page[PERF_DCL],
+                r->record.page[PERF_LOAD],
+                r->record.page[PERF_FCP],
+                r->record.transfer_size,
+                (r->record.handlers[PERF_AUTOCMD]
+                 + r->record.handlers[PERF_HISTORY]
+                 + r->record.handlers[PERF_STATUSBAR]) / 1000.0,
+                r->peak_rss);
+        g_free(uri);
+        g_strfreev(parts);
+    }
+}
+
+static void write_json(FILE *out, gint64 total)
+{
+    BenchResult *r;
+    GString *uri = g_string_new(NULL);
+
+    fprintf(out, "{\"jobs\":%d,\"total_ms\":%.1f,\"peak_rss_kb\":%ld,\"loads\":[",
+            bench.jobs, total / 1000.0, get_peak_rss());
+    for (guint i = 0; i < bench.results->len; i++) {
+        r = g_ptr_array_index(bench.results, i);
+        g_string_truncate(uri, 0);
+        util_json_append_string(uri, r->uri);
+        fprintf(out, "%s\n{\"uri\":%s,\"status\":\"%s\",\"commit_ms\":%.1f,"
+                "\"finish_ms\":%.1f,\"ttfb_ms\":%.1f,\"dcl_ms\":%.1f,\"load_ms\":%.1f,"
+                "\"fcp_ms\":%.1f,\"transfer_bytes\":%" G_GINT64_FORMAT ","
+                "\"autocmd_ms\":%.1f,\"history_ms\":%.1f,\"statusbar_ms\":%.1f,"
+                "\"peak_rss_kb\":%ld}",
+                i ? "," : "", uri->str, result_status(r),
+                r->record.committed / 1000.0,
+                r->record.finished / 1000.0,
+                r->record.page[PERF_TTFB],
+                r->record.page[PERF_DCL],
+                r->record.page[PERF_LOAD],
+                r->record.page[PERF_FCP],
+                r->record.transfer_size,
+                r->record.handlers[PERF_AUTOCMD] / 1000.0,
+                r->record.handlers[PERF_HISTORY] / 1000.0,
+                r->record.handlers[PERF_STATUSBAR] / 1000.0,
+                r->peak_rss);
+    }
+    fputs("\n]}\n", out);
+    g_string_free(uri, TRUE);
+}
+
+/**
+ * Returns the status of the load shown in the report.
+ */
+static const char *result_status(BenchResult *r)
+{
+    if (r->timeout) {
+        return "timeout";
+    }
+    return r->record.failed ? "failed" : "ok";
+}
+
+/**
+ * Returns the peak resident set size of the ui process in kB.
+ */
+static long get_peak_rss(void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+static void slot_free(BenchSlot *slot)
+{
+    if (slot->timer) {
+        g_source_remove(slot->timer);
+    }
+    g_slice_free(BenchSlot, slot);
+}
+
+static void result_free(BenchResult *r)
+{
+    g_free(r->uri);
+    g_slice_free(BenchResult, r);
+}
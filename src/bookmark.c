@@ -34,6 +34,13 @@ typedef struct {
 extern struct Vimb vb;
 
 static GList *load(const char *file);
+static GList *load_tags(const char *file);
+static gboolean fill_completion(GList *src, const char *input,
+        CompletionAddFunc add, gpointer target);
+static void source_bookmarks(const char *input, gpointer file,
+        CompletionAddFunc add, gpointer target);
+static void source_tags(const char *input, gpointer file,
+        CompletionAddFunc add, gpointer target);
 static gboolean bookmark_contains_all_tags(Bookmark *bm, char **query,
     unsigned int qlen);
 static Bookmark *line_to_bookmark(const char *uri, const char *data);
@@ -99,80 +106,36 @@ gboolean bookmark_remove(const char *uri)
 
 gboolean bookmark_fill_completion(GListStore *store, const char *input)
 {
-    gboolean found = FALSE;
-    char **parts;
-    unsigned int len;
-    GList *src = NULL;
-    Bookmark *bm;
-
-    src = load(vb.files[FILES_BOOKMARK]);
-    src = g_list_reverse(src);
-    if (!input || !*input) {
-        /* without any tags return all bookmarked items */
-        for (GList *l = src; l; l = l->next) {
-            bm = (Bookmark*)l->data;
-            CompletionItem *item = completion_item_new(bm->uri, bm->title);
-            g_list_store_append(store, item);
-            g_object_unref(item);
-            found = TRUE;
-        }
-    } else {
-        parts = g_strsplit(input, " ", 0);
-        len   = g_strv_length(parts);
-
-        for (GList *l = src; l; l = l->next) {
-            bm = (Bookmark*)l->data;
-            if (bookmark_contains_all_tags(bm, parts, len)) {
-                CompletionItem *item = completion_item_new(bm->uri, bm->title);
-                g_list_store_append(store, item);
-                g_object_unref(item);
-                found = TRUE;
-            }
-        }
-        g_strfreev(parts);
-    }
+    gboolean found;
+    GList *src;
 
+    src   = load(vb.files[FILES_BOOKMARK]);
+    found = fill_completion(src, input, completion_store_add, store);
     g_list_free_full(src, (GDestroyNotify)free_bookmark);
 
     return found;
 }
 
-gboolean bookmark_fill_tag_completion(GListStore *store, const char *input)
+/**
+ * Fills the store like bookmark_fill_completion() but reads and matches the
+ * bookmarks on a worker thread.
+ */
+void bookmark_fill_completion_async(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc update)
 {
-    gboolean found;
-    unsigned int len, i;
-    char **tags, *tag;
-    GList *src = NULL, *taglist = NULL;
-    Bookmark *bm;
-
-    /* get all distinct tags from bookmark file */
-    src = load(vb.files[FILES_BOOKMARK]);
-    for (GList *l = src; l; l = l->next) {
-        bm = (Bookmark*)l->data;
-        /* if bookmark contains no tags we can go to the next bookmark */
-        if (!bm->tags) {
-            continue;
-        }
-
-        tags = g_strsplit(bm->tags, " ", -1);
-        len  = g_strv_length(tags);
-        for (i = 0; i < len; i++) {
-            tag = tags[i];
-            /* add tag only if it isn't already in the list */
-            if (!g_list_find_custom(taglist, tag, (GCompareFunc)strcmp)) {
-                taglist = g_list_prepend(taglist, g_strdup(tag));
-            }
-        }
-        g_strfreev(tags);
-    }
-
-    /* generate the completion with the found tags */
-    found = util_fill_completion(store, input, taglist);
-
-    g_list_free_full(src, (GDestroyNotify)free_bookmark);
-    g_list_free_full(taglist, (GDestroyNotify)g_free);
+    completion_source_start(c, store, input, source_bookmarks,
+            g_strdup(vb.files[FILES_BOOKMARK]), g_free, update);
+}
 
-    return found;
+/**
+ * Fills the store with the bookmark tags matching the input. The tags are
+ * read on a worker thread and added in sorted order.
+ */
+void bookmark_fill_tag_completion_async(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc update)
+{
+    completion_source_start(c, store, input, source_tags,
+            g_strdup(vb.files[FILES_BOOKMARK]), g_free, update);
 }
 
 #ifdef FEATURE_QUEUE
@@ -231,6 +194,96 @@ static GList *load(const char *file)
     return list;
 }
 
+/**
+ * Retrieves all distinct tags from bookmark file.
+ *
+ * Returned list must be freed with (GDestroyNotify)g_free.
+ */
+static GList *load_tags(const char *file)
+{
+    unsigned int len, i;
+    char **tags, *tag;
+    GList *src = NULL, *taglist = NULL;
+    Bookmark *bm;
+
+    src = load(file);
+    for (GList *l = src; l; l = l->next) {
+        bm = (Bookmark*)l->data;
+        /* if bookmark contains no tags we can go to the next bookmark */
+        if (!bm->tags) {
+            continue;
+        }
+
+        tags = g_strsplit(bm->tags, " ", -1);
+        len  = g_strv_length(tags);
+        for (i = 0; i < len; i++) {
+            tag = tags[i];
+            /* add tag only if it isn't already in the list */
+            if (!g_list_find_custom(taglist, tag, (GCompareFunc)strcmp)) {
+                taglist = g_list_prepend(taglist, g_strdup(tag));
+            }
+        }
+        g_strfreev(tags);
+    }
+    g_list_free_full(src, (GDestroyNotify)free_bookmark);
+
+    return taglist;
+}
+
+/**
+ * Adds the bookmarks of src matching all the tags of the input, the latest
+ * added bookmark first.
+ */
+static gboolean fill_completion(GList *src, const char *input,
+        CompletionAddFunc add, gpointer target)
+{
+    gboolean found = FALSE;
+    char **parts;
+    unsigned int len;
+    Bookmark *bm;
+
+    parts = g_strsplit(input ? input : "", " ", 0);
+    len   = g_strv_length(parts);
+    for (GList *l = g_list_last(src); l; l = l->prev) {
+        bm = (Bookmark*)l->data;
+        if (!bookmark_contains_all_tags(bm, parts, len)) {
+            continue;
+        }
+        found = TRUE;
+        if (!add(target, bm->uri, bm->title)) {
+            break;
+        }
+    }
+    g_strfreev(parts);
+
+    return found;
+}
+
+static void source_bookmarks(const char *input, gpointer file,
+        CompletionAddFunc add, gpointer target)
+{
+    GList *src = load(file);
+
+    fill_completion(src, input, add, target);
+    g_list_free_full(src, (GDestroyNotify)free_bookmark);
+}
+
+static void source_tags(const char *input, gpointer file,
+        CompletionAddFunc add, gpointer target)
+{
+    GList *taglist = g_list_sort(load_tags(file), (GCompareFunc)strcmp);
+
+    for (GList *l = taglist; l; l = l->next) {
+        if (!g_str_has_prefix(l->data, input)) {
+            continue;
+        }
+        if (!add(target, l->data, NULL)) {
+            break;
+        }
+    }
+    g_list_free_full(taglist, (GDestroyNotify)g_free);
+}
+
 /**
  * Checks if the given bookmark matches all given query strings as prefix. If
  * the bookmark has no tags, the matching is done on the '/' splited URL.
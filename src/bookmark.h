@@ -20,12 +20,16 @@
 #ifndef _BOOKMARK_H
 #define _BOOKMARK_H
 
+#include "completion.h"
 #include "main.h"
 
 gboolean bookmark_add(const char *uri, const char *title, const char *tags);
 gboolean bookmark_remove(const char *uri);
 gboolean bookmark_fill_completion(GListStore *store, const char *input);
-gboolean bookmark_fill_tag_completion(GListStore *store, const char *input);
+void bookmark_fill_completion_async(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc update);
+void bookmark_fill_tag_completion_async(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc update);
 #ifdef FEATURE_QUEUE
 gboolean bookmark_queue_push(const char *uri);
 gboolean bookmark_queue_unshift(const char *uri);
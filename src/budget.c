@@ -0,0 +1,245 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "budget.h"
+#include "config.h"
+#include "main.h"
+#include "setting.h"
+
+extern struct Vimb vb;
+
+/* The resource budget of the browser. This is read from the config file
+ * before the network session and the web context are created. Only the cache
+ * model can be changed afterwards. */
+static struct {
+    guint                        memory_limit;      /* MB, 0 to use WebKit's default */
+    guint                        conservative;      /* percent of the memory limit */
+    guint                        strict;            /* percent of the memory limit */
+    guint                        poll_interval;     /* seconds */
+    WebKitCacheModel             cache_model;
+    WebKitMemoryPressureSettings *settings;         /* NULL if WebKit's defaults are used */
+} budget = {
+    BUDGET_MEMORY_LIMIT, BUDGET_CONSERVATIVE_THRESHOLD, BUDGET_STRICT_THRESHOLD,
+    BUDGET_POLL_INTERVAL, WEBKIT_CACHE_MODEL_WEB_BROWSER, NULL
+};
+
+static const struct {
+    const char       *name;
+    WebKitCacheModel model;
+} cache_models[] = {
+    {"web-browser",       WEBKIT_CACHE_MODEL_WEB_BROWSER},
+    {"document-browser",  WEBKIT_CACHE_MODEL_DOCUMENT_BROWSER},
+    {"document-viewer",   WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER},
+};
+
+static const char *cache_model_name(WebKitCacheModel model);
+static guint64 get_rss(void);
+
+
+/**
+ * Read the budget settings and apply the memory pressure settings to the
+ * network process. This must be called before the network session is
+ * created.
+ */
+void budget_init(void)
+{
+    WebKitMemoryPressureSettings *mps;
+
+    setting_read_startup(vb.files[FILES_CONFIG]);
+
+    if (!budget.memory_limit && !budget.conservative && !budget.strict
+            && !budget.poll_interval) {
+        return;
+    }
+
+    mps = webkit_memory_pressure_settings_new();
+    if (budget.memory_limit) {
+        webkit_memory_pressure_settings_set_memory_limit(mps, budget.memory_limit);
+    }
+    if (budget.conservative && budget.strict) {
+        if (budget.conservative >= budget.strict) {
+            g_warning("memory-conservative-threshold must be less than memory-strict-threshold");
+        } else if (budget.strict / 100.0 > webkit_memory_pressure_settings_get_conservative_threshold(mps)) {
+            /* WebKit requires the conservative threshold to be less than
+             * the strict one at any time, so the order matters. */
+            webkit_memory_pressure_settings_set_strict_threshold(mps, budget.strict / 100.0);
+            webkit_memory_pressure_settings_set_conservative_threshold(mps, budget.conservative / 100.0);
+        } else {
+            webkit_memory_pressure_settings_set_conservative_threshold(mps, budget.conservative / 100.0);
+            webkit_memory_pressure_settings_set_strict_threshold(mps, budget.strict / 100.0);
+        }
+    } else if (budget.conservative || budget.strict) {
+        g_warning("memory-conservative-threshold and memory-strict-threshold must be set both");
+    }
+    if (budget.poll_interval) {
+        webkit_memory_pressure_settings_set_poll_interval(mps, budget.poll_interval);
+    }
+
+    webkit_network_session_set_memory_pressure_settings(mps);
+    budget.settings = mps;
+}
+
+/**
+ * Create the web context with the memory pressure settings and cache model of
+ * the budget.
+ */
+WebKitWebContext *budget_web_context_new(void)
+{
+    WebKitWebContext *ctx;
+
+    if (budget.settings) {
+        ctx = g_object_new(WEBKIT_TYPE_WEB_CONTEXT,
+                "memory-pressure-settings", budget.settings,
+                NULL);
+    } else {
+        ctx = webkit_web_context_new();
+    }
+    webkit_web_context_set_cache_model(ctx, budget.cache_model);
+
+    return ctx;
+}
+
+/**
+ * Print the active resource budget and the memory used by the browser.
+ */
+void budget_stats(Client *c)
+{
+    GString *str;
+    Client *p;
+    guint tabs = 0, discarded = 0;
+
+    for (p = vb.clients; p; p = p->next) {
+        tabs++;
+        if (!p->webview) {
+            discarded++;
+        }
+    }
+
+    str = g_string_new("-- Memory --");
+    g_string_append_printf(str, "\ncache model:    %s", cache_model_name(budget.cache_model));
+    if (budget.settings) {
+        g_string_append_printf(str, "\nmemory limit:   %u MB",
+                webkit_memory_pressure_settings_get_memory_limit(budget.settings));
+        g_string_append_printf(str, "\nthresholds:     %.0f%% conservative, %.0f%% strict",
+                webkit_memory_pressure_settings_get_conservative_threshold(budget.settings) * 100,
+                webkit_memory_pressure_settings_get_strict_threshold(budget.settings) * 100);
+        g_string_append_printf(str, "\npoll interval:  %.0f s",
+                webkit_memory_pressure_settings_get_poll_interval(budget.settings));
+    } else {
+        g_string_append(str, "\nmemory limit:   WebKit default");
+    }
+    g_string_append_printf(str, "\ntabs:           %u (%u discarded)", tabs, discarded);
+    g_string_append_printf(str, "\nui process rss: %" G_GUINT64_FORMAT " kB", get_rss() / 1024);
+
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", str->str);
+    g_string_free(str, TRUE);
+}
+
+/**
+ * Setter of the budget settings. Before the web context exists the values
+ * make up the budget, the client is NULL then. Afterwards the cache model is
+ * applied to the web context and the memory settings only accept the values
+ * they have, because the network process already runs with them.
+ */
+int budget_set(Client *c, const char *name, void *value)
+{
+    guint *field, v;
+
+    if (!strcmp(name, "cache-model")) {
+        for (int i = 0; i < G_N_ELEMENTS(cache_models); i++) {
+            if (!strcmp(value, cache_models[i].name)) {
+                budget.cache_model = cache_models[i].model;
+                if (vb.webcontext) {
+                    webkit_web_context_set_cache_model(vb.webcontext, budget.cache_model);
+                }
+                return CMD_SUCCESS;
+            }
+        }
+        if (c) {
+            vb_echo(c, MSG_ERROR, TRUE, "%s must be in [web-browser, document-browser, document-viewer]", name);
+        } else {
+            g_warning("Unknown cache-model '%s'", (char*)value);
+        }
+        return CMD_ERROR|CMD_KEEPINPUT;
+    }
+
+    v = *(int*)value;
+    if (!strcmp(name, "memory-limit")) {
+        field = &budget.memory_limit;
+    } else if (!strcmp(name, "memory-conservative-threshold")) {
+        field = &budget.conservative;
+        v     = MIN(v, 100);
+    } else if (!strcmp(name, "memory-strict-threshold")) {
+        field = &budget.strict;
+        v     = MIN(v, 100);
+    } else {
+        field = &budget.poll_interval;
+    }
+
+    if (vb.webcontext && v != *field) {
+        if (c) {
+            vb_echo(c, MSG_ERROR, TRUE, "%s can only be set in the config file", name);
+        }
+        return CMD_ERROR|CMD_KEEPINPUT;
+    }
+    *field = v;
+
+    return CMD_SUCCESS;
+}
+
+void budget_cleanup(void)
+{
+    if (budget.settings) {
+        webkit_memory_pressure_settings_free(budget.settings);
+        budget.settings = NULL;
+    }
+}
+
+static const char *cache_model_name(WebKitCacheModel model)
+{
+    for (int i = 0; i < G_N_ELEMENTS(cache_models); i++) {
+        if (cache_models[i].model == model) {
+            return cache_models[i].name;
+        }
+    }
+    return "unknown";
+}
+
+/**
+ * Returns the resident set size of the ui process in bytes.
+ */
+static guint64 get_rss(void)
+{
+    FILE *f;
+    unsigned long size, resident = 0;
+
+    if ((f = fopen("/proc/self/statm", "r"))) {
+        if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(f);
+    }
+
+    return (guint64)resident * sysconf(_SC_PAGESIZE);
+}
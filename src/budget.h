@@ -0,0 +1,33 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _BUDGET_H
+#define _BUDGET_H
+
+#include <webkit/webkit.h>
+
+#include "main.h"
+
+void budget_init(void);
+WebKitWebContext *budget_web_context_new(void);
+void budget_stats(Client *c);
+int budget_set(Client *c, const char *name, void *value);
+void budget_cleanup(void);
+
+#endif /* end of include guard: _BUDGET_H */
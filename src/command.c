@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "config.h"
+#include "async.h"
 #ifdef FEATURE_QUEUE
 #include "bookmark.h"
 #endif
@@ -41,6 +42,12 @@ typedef struct {
 } EditorData;
 
 static void resume_editor(GPid pid, int status, gpointer edata);
+static void search_start(Client *c, const char *query, int direction, guint max);
+static void search_cancel(Client *c);
+static WebKitFindOptions search_options(int direction);
+static gboolean on_incsearch_timeout(gpointer data);
+static gboolean on_count_idle(gpointer data);
+static void yank_text(Client *c, const char *yanked, gpointer data);
 
 /**
  * Start/perform/stop searching in webview.
@@ -60,6 +67,7 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
     g_assert(arg);
 
     if (arg->i == 0) {
+        search_cancel(c);
         webkit_find_controller_search_finish(c->finder);
 
         /* Clear the input only if the search is active and commit flag is
@@ -80,6 +88,21 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
     count = abs(arg->i);
     direction = arg->i > 0 ? 1 : -1;
 
+    /* Intermediate strings of incsearch are searched once the typing paused
+     * for INCSEARCH_DELAY, each key supersedes the waiting query. */
+    if (!commit && query) {
+        g_free(c->state.search.pending);
+        c->state.search.pending           = g_strdup(query);
+        c->state.search.pending_direction = direction;
+        if (c->state.search.pending_source) {
+            g_source_remove(c->state.search.pending_source);
+        }
+        c->state.search.pending_source = g_timeout_add(INCSEARCH_DELAY, on_incsearch_timeout, c);
+
+        return TRUE;
+    }
+    search_cancel(c);
+
     /* restart the last search if a search result is asked for and no
      * search was active */
     if (!query && !c->state.search.active) {
@@ -106,26 +129,10 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
          * depends on the most recent selection or caret position (even when
          * caret browsing is disabled). */
         if (commit) {
-            c->state.search.awaited_matches_updates++;
             webkit_find_controller_search(c->finder, "", WEBKIT_FIND_OPTIONS_NONE, G_MAXUINT);
         }
 
-        if (!c->state.search.last_query) {
-            c->state.search.last_query = g_strdup(query);
-        } else if (strcmp(c->state.search.last_query, query)) {
-            g_free(c->state.search.last_query);
-            c->state.search.last_query = g_strdup(query);
-        }
-
-        c->state.search.awaited_matches_updates++;
-        webkit_find_controller_search(c->finder, query,
-                WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE |
-                WEBKIT_FIND_OPTIONS_WRAP_AROUND |
-                (direction > 0 ?  WEBKIT_FIND_OPTIONS_NONE : WEBKIT_FIND_OPTIONS_BACKWARDS),
-                (!commit && arg->s ? INCSEARCH_MATCHES_LIMIT : G_MAXUINT));
-
-        c->state.search.active    = TRUE;
-        c->state.search.direction = direction;
+        search_start(c, query, direction, G_MAXUINT);
 
         /* Skip first search because the first match is already
          * highlighted on search start. */
@@ -148,6 +155,133 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
     return TRUE;
 }
 
+/**
+ * Take the number of matches counted by webkit. The counts are answered in
+ * the order they were requested, so the generation of the answered count is
+ * the head of the queue. Returns TRUE if the count belongs to the current
+ * search and was taken.
+ */
+gboolean command_search_counted(Client *c, guint count)
+{
+    guint generation;
+
+    if (g_queue_is_empty(&c->state.search.counts)) {
+        return FALSE;
+    }
+    generation = GPOINTER_TO_UINT(g_queue_pop_head(&c->state.search.counts));
+    if (generation != c->state.search.generation || !c->state.search.active) {
+        return FALSE;
+    }
+    c->state.search.matches = count;
+
+    return TRUE;
+}
+
+/**
+ * Forget the requested match counts. Used if the finder or its web process
+ * is gone, so that counts that will never be answered don't shift the
+ * answers of later requests.
+ */
+void command_search_reset_counts(Client *c)
+{
+    if (c->state.search.count_source) {
+        g_source_remove(c->state.search.count_source);
+        c->state.search.count_source = 0;
+    }
+    g_queue_clear(&c->state.search.counts);
+}
+
+/**
+ * Free the search state of a client that is destroyed.
+ */
+void command_search_cleanup(Client *c)
+{
+    search_cancel(c);
+    command_search_reset_counts(c);
+    g_clear_pointer(&c->state.search.last_query, g_free);
+}
+
+/**
+ * Start a new search generation. The number of matches is requested
+ * separately at idle priority and the shown count is hidden until the count
+ * of this generation arrives.
+ */
+static void search_start(Client *c, const char *query, int direction, guint max)
+{
+    if (!c->state.search.last_query) {
+        c->state.search.last_query = g_strdup(query);
+    } else if (strcmp(c->state.search.last_query, query)) {
+        g_free(c->state.search.last_query);
+        c->state.search.last_query = g_strdup(query);
+    }
+
+    c->state.search.generation++;
+    c->state.search.matches   = 0;
+    c->state.search.max       = max;
+    c->state.search.active    = TRUE;
+    c->state.search.direction = direction;
+    webkit_find_controller_search(c->finder, query, search_options(direction), max);
+
+    if (!c->state.search.count_source) {
+        c->state.search.count_source = g_idle_add_full(G_PRIORITY_LOW,
+                on_count_idle, c, NULL);
+    }
+    /* hide the count of the previous search */
+    vb_statusbar_update(c);
+}
+
+/**
+ * Drop the incsearch query that waits for the delay.
+ */
+static void search_cancel(Client *c)
+{
+    if (c->state.search.pending_source) {
+        g_source_remove(c->state.search.pending_source);
+        c->state.search.pending_source = 0;
+    }
+    g_clear_pointer(&c->state.search.pending, g_free);
+}
+
+static WebKitFindOptions search_options(int direction)
+{
+    return WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE
+        | WEBKIT_FIND_OPTIONS_WRAP_AROUND
+        | (direction > 0 ? WEBKIT_FIND_OPTIONS_NONE : WEBKIT_FIND_OPTIONS_BACKWARDS);
+}
+
+static gboolean on_incsearch_timeout(gpointer data)
+{
+    Client *c = data;
+
+    c->state.search.pending_source = 0;
+    if (c->state.search.pending) {
+        search_start(c, c->state.search.pending,
+                c->state.search.pending_direction, INCSEARCH_MATCHES_LIMIT);
+        g_clear_pointer(&c->state.search.pending, g_free);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Request the number of matches of the latest search. Searches started
+ * before the idle callback ran are superseded and never counted.
+ */
+static gboolean on_count_idle(gpointer data)
+{
+    Client *c = data;
+
+    c->state.search.count_source = 0;
+    if (c->finder && c->state.search.active && c->state.search.last_query) {
+        g_queue_push_tail(&c->state.search.counts,
+                GUINT_TO_POINTER(c->state.search.generation));
+        webkit_find_controller_count_matches(c->finder, c->state.search.last_query,
+                search_options(c->state.search.direction), c->state.search.max);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
 gboolean command_yank(Client *c, const Arg *arg, char buf)
 {
     /**
@@ -157,7 +291,6 @@ gboolean command_yank(Client *c, const Arg *arg, char buf)
      */
 
     const char *uri = NULL;
-    char *yanked = NULL;
 
     g_assert(c);
     g_assert(arg);
@@ -168,21 +301,35 @@ gboolean command_yank(Client *c, const Arg *arg, char buf)
         arg->i == COMMAND_YANK_ARG);
 
     if (arg->i == COMMAND_YANK_URI) {
-        if ((uri = webkit_web_view_get_uri(c->webview))) {
-            yanked = g_strdup(uri);
+        if (!(uri = webkit_web_view_get_uri(c->webview))) {
+            return FALSE;
         }
+        yank_text(c, uri, GINT_TO_POINTER(buf));
     } else if (arg->i == COMMAND_YANK_SELECTION) {
         /* copy web view selection to clipboard */
         webkit_web_view_execute_editing_command(c->webview, WEBKIT_EDITING_COMMAND_COPY);
         /* read back copy from clipboard */
-        yanked = util_clipboard_get_text(GTK_WIDGET(c->webview), TRUE);
+        async_clipboard(c, TRUE, yank_text, GINT_TO_POINTER(buf), NULL);
     } else {
         /* use current arg.s as new clipboard content */
-        yanked = g_strdup(arg->s);
+        if (!arg->s) {
+            return FALSE;
+        }
+        yank_text(c, arg->s, GINT_TO_POINTER(buf));
     }
 
-    if(!yanked) {
-        return FALSE;
+    return TRUE;
+}
+
+/**
+ * Store the yanked text in the registers and the clipboards.
+ */
+static void yank_text(Client *c, const char *yanked, gpointer data)
+{
+    char buf = GPOINTER_TO_INT(data);
+
+    if (!yanked) {
+        return;
     }
 
     /* store in vimb default register */
@@ -196,10 +343,6 @@ gboolean command_yank(Client *c, const Arg *arg, char buf)
     util_clipboard_set_text(GTK_WIDGET(c->webview), yanked, FALSE);
 
     vb_echo(c, MSG_NORMAL, FALSE, "Yanked: %s", yanked);
-
-    g_free(yanked);
-
-    return TRUE;
 }
 
 gboolean command_save(Client *c, const Arg *arg)
@@ -292,7 +435,7 @@ gboolean command_spawn_editor(Client *c, const Arg *arg,
     GError *error = NULL;
 
     /* get the editor command */
-    editor_command = GET_CHAR(c, "editor-command");
+    editor_command = c->config.settings.editor_command;
     if (!editor_command || !*editor_command) {
         vb_echo(c, MSG_ERROR, TRUE, "No editor-command configured");
         return FALSE;
@@ -46,6 +46,9 @@ enum {
 typedef void (*PostEditFunc)(const char *, Client *, gpointer);
 
 gboolean command_search(Client *c, const Arg *arg, bool commit);
+gboolean command_search_counted(Client *c, guint count);
+void command_search_reset_counts(Client *c);
+void command_search_cleanup(Client *c);
 gboolean command_yank(Client *c, const Arg *arg, char buf);
 gboolean command_save(Client *c, const Arg *arg);
 #ifdef FEATURE_QUEUE
@@ -20,6 +20,7 @@
 #include "completion.h"
 #include "config.h"
 #include "main.h"
+#include "trace.h"
 
 /* CompletionItem GObject implementation */
 struct _CompletionItem {
@@ -130,16 +131,59 @@ GListStore *completion_store_new(void)
     return g_list_store_new(COMPLETION_TYPE_ITEM);
 }
 
+/**
+ * CompletionAddFunc that appends the item to the GListStore given as target.
+ */
+gboolean completion_store_add(gpointer store, const char *first, const char *second)
+{
+    CompletionItem *item = completion_item_new(first, second);
+    g_list_store_append(G_LIST_STORE(store), item);
+    g_object_unref(item);
+
+    return TRUE;
+}
+
 /* Completion widget state */
 typedef struct {
     GtkWidget               *win, *listview;
     GtkSingleSelection      *selection;
     int                     active;  /* number of the current active item */
     CompletionSelectFunc    selfunc;
+    GCancellable            *cancellable; /* of the running source */
 } Completion;
 
+/* number of items a source hands over to the main thread at once */
+#define SOURCE_CHUNK_SIZE 100
+
+/* A completion source running on a worker thread. The items are collected
+ * in chunk by the worker and moved into the store on the main thread. */
+typedef struct {
+    int                     ref;
+    Client                  *c;
+    GListStore              *store;
+    char                    *input;
+    CompletionSourceFunc    func;
+    gpointer                snapshot;
+    GDestroyNotify          snapshot_free;
+    CompletionUpdateFunc    update;
+    GCancellable            *cancellable;
+    GMutex                  lock;
+    GPtrArray               *chunk;     /* items not yet in the store */
+    gboolean                flush_pending;
+} Source;
+
 static void on_selection_changed(GtkSelectionModel *model, guint position,
         guint n_items, gpointer data);
+static void on_items_changed(GListModel *model, guint position, guint removed,
+        guint added, gpointer data);
+static void update_height(Client *c);
+static void source_run(GTask *task, gpointer source_object, gpointer data,
+        GCancellable *cancellable);
+static gboolean source_add(gpointer target, const char *first, const char *second);
+static gboolean source_flush_idle(gpointer data);
+static gboolean source_flush(Source *src);
+static void source_done(GObject *object, GAsyncResult *res, gpointer data);
+static void source_unref(Source *src);
 static void setup_listitem(GtkListItemFactory *factory, GtkListItem *list_item,
         gpointer user_data);
 static void bind_listitem(GtkListItemFactory *factory, GtkListItem *list_item,
@@ -156,11 +200,17 @@ void completion_clean(Client *c)
     Completion *comp = (Completion*)c->comp;
     c->mode->flags  &= ~FLAG_COMPLETION;
 
+    completion_source_cancel(c);
+
     if (comp->win) {
         /* Disconnect signal before destroying to avoid spurious callbacks */
         if (comp->selection) {
             g_signal_handlers_disconnect_by_func(comp->selection,
                 G_CALLBACK(on_selection_changed), c);
+            /* The store may be filled further by its source. */
+            g_signal_handlers_disconnect_by_func(
+                gtk_single_selection_get_model(comp->selection),
+                G_CALLBACK(on_items_changed), c);
         }
         gtk_widget_unparent(comp->win);
         comp->win       = NULL;
@@ -175,6 +225,7 @@ void completion_clean(Client *c)
 void completion_cleanup(Client *c)
 {
     if (c->comp) {
+        completion_source_cancel(c);
         g_slice_free(Completion, c->comp);
         c->comp = NULL;
     }
@@ -188,8 +239,6 @@ gboolean completion_create(Client *c, GListStore *store,
         CompletionSelectFunc selfunc, gboolean back)
 {
     GtkListItemFactory *factory;
-    GtkRequisition size;
-    int height, width;
     Completion *comp = (Completion*)c->comp;
     guint n_items;
 
@@ -234,26 +283,14 @@ gboolean completion_create(Client *c, GListStore *store,
     /* Connect selection changed signal */
     g_signal_connect(comp->selection, "selection-changed",
         G_CALLBACK(on_selection_changed), c);
-
-    /* get window dimension */
-    gtk_window_get_default_size(GTK_WINDOW(c->window), &width, &height);
+    /* Follow items added to the store after the completion was started.
+     * Connected after the selection, so that the selected position is
+     * already moved along with the items. */
+    g_signal_connect(store, "items-changed", G_CALLBACK(on_items_changed), c);
 
     /* Show the list view first */
     gtk_widget_set_visible(comp->listview, TRUE);
-
-    /* this prevents the first item to be placed out of view if the completion
-     * is shown */
-    while (g_main_context_pending(NULL)) {
-        g_main_context_iteration(NULL, TRUE);
-    }
-
-    /* use max 1/3 of window height for the completion */
-    gtk_widget_get_preferred_size(comp->listview, NULL, &size);
-    height /= 3;
-    gtk_scrolled_window_set_min_content_height(
-        GTK_SCROLLED_WINDOW(comp->win),
-        size.height > height ? height : size.height
-    );
+    update_height(c);
 
     c->mode->flags |= FLAG_COMPLETION;
 
@@ -266,6 +303,57 @@ gboolean completion_create(Client *c, GListStore *store,
     return TRUE;
 }
 
+/**
+ * Runs the source func on a worker thread with the snapshot of the data to
+ * match. The found items are moved into the store in chunks and update is
+ * called after each chunk and once the source has finished. A source started
+ * before for the client is cancelled.
+ */
+void completion_source_start(Client *c, GListStore *store, const char *input,
+        CompletionSourceFunc func, gpointer snapshot, GDestroyNotify snapshot_free,
+        CompletionUpdateFunc update)
+{
+    Completion *comp = (Completion*)c->comp;
+    Source *src;
+    GTask *task;
+
+    completion_source_cancel(c);
+
+    src                = g_slice_new0(Source);
+    src->ref           = 1;
+    src->c             = c;
+    src->store         = g_object_ref(store);
+    src->input         = g_strdup(input);
+    src->func          = func;
+    src->snapshot      = snapshot;
+    src->snapshot_free = snapshot_free;
+    src->update        = update;
+    src->cancellable   = g_cancellable_new();
+    src->chunk         = g_ptr_array_new_with_free_func(g_object_unref);
+    g_mutex_init(&src->lock);
+
+    comp->cancellable = g_object_ref(src->cancellable);
+
+    task = g_task_new(NULL, src->cancellable, source_done, src);
+    g_task_set_task_data(task, src, NULL);
+    g_task_run_in_thread(task, source_run);
+    g_object_unref(task);
+}
+
+/**
+ * Cancels the running source of the client. Items that have not been moved
+ * into the store are dropped and the update function is not called anymore.
+ */
+void completion_source_cancel(Client *c)
+{
+    Completion *comp = (Completion*)c->comp;
+
+    if (comp && comp->cancellable) {
+        g_cancellable_cancel(comp->cancellable);
+        g_clear_object(&comp->cancellable);
+    }
+}
+
 /**
  * Initialize the completion system for given client.
  */
@@ -413,3 +501,160 @@ static void on_selection_changed(GtkSelectionModel *model, guint position,
         g_object_unref(item);
     }
 }
+
+/**
+ * Keeps the active item and the height of the list view in sync if the store
+ * is changed while the completion is shown.
+ */
+static void on_items_changed(GListModel *model, guint position, guint removed,
+        guint added, gpointer data)
+{
+    Client *c = (Client*)data;
+    Completion *comp = (Completion*)c->comp;
+    guint selected;
+
+    selected = gtk_single_selection_get_selected(comp->selection);
+    if (selected != GTK_INVALID_LIST_POSITION) {
+        comp->active = selected;
+    } else if (comp->active >= (int)position) {
+        /* Keep the position after the last or before the first item. */
+        comp->active += (int)added - (int)removed;
+    }
+    update_height(c);
+}
+
+/**
+ * Use max 1/3 of window height for the completion, the preferred size is
+ * measured at once so there is no need to run the main loop until the list
+ * view has been laid out.
+ */
+static void update_height(Client *c)
+{
+    Completion *comp = (Completion*)c->comp;
+    GtkRequisition size;
+    int height, width;
+
+    gtk_window_get_default_size(GTK_WINDOW(c->window), &width, &height);
+    gtk_widget_get_preferred_size(comp->listview, NULL, &size);
+    height /= 3;
+    gtk_scrolled_window_set_min_content_height(
+        GTK_SCROLLED_WINDOW(comp->win),
+        size.height > height ? height : size.height
+    );
+}
+
+static void source_run(GTask *task, gpointer source_object, gpointer data,
+        GCancellable *cancellable)
+{
+    Source *src = (Source*)data;
+
+    trace_begin("completion source");
+    src->func(src->input, src->snapshot, source_add, src);
+    trace_end("completion source");
+
+    g_task_return_boolean(task, TRUE);
+}
+
+/**
+ * Collects the item on the worker thread and schedules a flush to the main
+ * thread once a chunk is full.
+ */
+static gboolean source_add(gpointer target, const char *first, const char *second)
+{
+    Source *src = (Source*)target;
+    CompletionItem *item;
+    gboolean flush = FALSE;
+
+    if (g_cancellable_is_cancelled(src->cancellable)) {
+        return FALSE;
+    }
+
+    item = completion_item_new(first, second);
+    g_mutex_lock(&src->lock);
+    g_ptr_array_add(src->chunk, item);
+    if (src->chunk->len >= SOURCE_CHUNK_SIZE && !src->flush_pending) {
+        src->flush_pending = TRUE;
+        flush = TRUE;
+    }
+    g_mutex_unlock(&src->lock);
+
+    if (flush) {
+        g_atomic_int_inc(&src->ref);
+        g_idle_add(source_flush_idle, src);
+    }
+
+    return TRUE;
+}
+
+static gboolean source_flush_idle(gpointer data)
+{
+    Source *src = (Source*)data;
+
+    if (source_flush(src)) {
+        src->update(src->c, src->store, FALSE);
+    }
+    source_unref(src);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Moves the collected items into the store. Returns TRUE if items were added.
+ */
+static gboolean source_flush(Source *src)
+{
+    GPtrArray *chunk;
+    guint n_items;
+
+    g_mutex_lock(&src->lock);
+    chunk              = src->chunk;
+    src->chunk         = g_ptr_array_new_with_free_func(g_object_unref);
+    src->flush_pending = FALSE;
+    g_mutex_unlock(&src->lock);
+
+    /* The client may be gone if the source was cancelled. */
+    if (!chunk->len || g_cancellable_is_cancelled(src->cancellable)) {
+        g_ptr_array_unref(chunk);
+        return FALSE;
+    }
+
+    n_items = g_list_model_get_n_items(G_LIST_MODEL(src->store));
+    g_list_store_splice(src->store, n_items, 0, chunk->pdata, chunk->len);
+    g_ptr_array_unref(chunk);
+
+    return TRUE;
+}
+
+static void source_done(GObject *object, GAsyncResult *res, gpointer data)
+{
+    Source *src = (Source*)data;
+    Completion *comp;
+
+    if (!g_cancellable_is_cancelled(src->cancellable)) {
+        source_flush(src);
+
+        /* There is nothing left to cancel. */
+        comp = (Completion*)src->c->comp;
+        if (comp->cancellable == src->cancellable) {
+            g_clear_object(&comp->cancellable);
+        }
+        src->update(src->c, src->store, TRUE);
+    }
+    source_unref(src);
+}
+
+static void source_unref(Source *src)
+{
+    if (!g_atomic_int_dec_and_test(&src->ref)) {
+        return;
+    }
+    if (src->snapshot_free) {
+        src->snapshot_free(src->snapshot);
+    }
+    g_object_unref(src->store);
+    g_object_unref(src->cancellable);
+    g_ptr_array_unref(src->chunk);
+    g_mutex_clear(&src->lock);
+    g_free(src->input);
+    g_slice_free(Source, src);
+}
@@ -27,6 +27,15 @@
 #include "main.h"
 
 typedef void (*CompletionSelectFunc) (Client *c, char *match);
+/* Adds an item to the target, returns FALSE if no more items are wanted. */
+typedef gboolean (*CompletionAddFunc) (gpointer target, const char *first,
+        const char *second);
+/* Matches the input against a snapshot of a store on a worker thread. */
+typedef void (*CompletionSourceFunc) (const char *input, gpointer snapshot,
+        CompletionAddFunc add, gpointer target);
+/* Called if items were added to the store of a completion that is filled in
+ * the background, with done set once the source has finished. */
+typedef void (*CompletionUpdateFunc) (Client *c, GListStore *store, gboolean done);
 
 /* CompletionItem GObject for use with GListStore */
 #define COMPLETION_TYPE_ITEM (completion_item_get_type())
@@ -45,5 +54,11 @@ gboolean completion_next(Client *c, gboolean back);
 
 /* Helper to create a new GListStore for completion items */
 GListStore *completion_store_new(void);
+gboolean completion_store_add(gpointer store, const char *first, const char *second);
+
+void completion_source_start(Client *c, GListStore *store, const char *input,
+        CompletionSourceFunc func, gpointer snapshot, GDestroyNotify snapshot_free,
+        CompletionUpdateFunc update);
+void completion_source_cancel(Client *c);
 
 #endif /* end of include guard: _COMPLETION_H */
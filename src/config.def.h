@@ -54,6 +54,69 @@
 #define GUI_WINDOW_BACKGROUND_COLOR "#FFFFFF"
 
 #define INCSEARCH_MATCHES_LIMIT 1000
+/* milliseconds without typing before incsearch starts the search, so that
+ * fast typing on large pages does not queue a search per key */
+#define INCSEARCH_DELAY             60
+
+/* maximum number of :shellcmd and :shellex commands running at the same
+ * time, further commands are queued */
+#define SHELL_JOBS_MAX              4
+/* milliseconds between the updates of the shown :shellcmd output, so that
+ * commands writing many lines don't redraw the output for each of them */
+#define SHELL_ECHO_INTERVAL         100
+
+/* maximum number of pages loaded at the same time into tabs that are not
+ * visible, further loads are queued */
+#define LOAD_JOBS_MAX               4
+
+/* interval in seconds in which hidden tabs are checked against the
+ * tab-discard-timeout setting */
+#define TAB_DISCARD_INTERVAL        60
+
+/* default resource budget, 0 means to use the WebKit defaults; the memory
+ * limit is given in MB, the thresholds in percent of the memory limit and the
+ * poll interval in seconds */
+#define BUDGET_MEMORY_LIMIT             0
+#define BUDGET_CONSERVATIVE_THRESHOLD   0
+#define BUDGET_STRICT_THRESHOLD         0
+#define BUDGET_POLL_INTERVAL            0
+
+/* time in seconds the writing of the session file is delayed to bundle the
+ * changes of the tabs */
+#define SESSION_SAVE_DELAY          2
+
+/* interval in milliseconds the throughput of running downloads is sampled
+ * and the statusbar is refreshed, the weight of the latest sample in the
+ * moving average of the throughput and the number of finished or failed
+ * downloads kept for the :downloads listing */
+#define DOWNLOAD_REFRESH_INTERVAL   250
+#define DOWNLOAD_RATE_WEIGHT        0.2
+#define DOWNLOAD_HISTORY_MAX        20
+
+/* maximum number of download-command processes running at the same time,
+ * further downloads are queued; a failed command is run again up to
+ * DOWNLOAD_RETRY_MAX times, the first time after DOWNLOAD_RETRY_DELAY seconds
+ * and the delay is doubled for each further attempt */
+#define DOWNLOAD_JOBS_MAX           4
+#define DOWNLOAD_RETRY_MAX          2
+#define DOWNLOAD_RETRY_DELAY        5
+
+/* number of events kept per thread by the trace recorder, must be a power of
+ * two */
+#define TRACE_BUFFER_SIZE           4096
+
+/* number of page loads kept for the :perf report and time in milliseconds
+ * waited after a finished load for the timing reported by the page */
+#define PERF_RECORDS_MAX            500
+#define PERF_PAGE_TIMEOUT           2000
+
+/* seconds a page of --bench-load may take before it is reported as timed out
+ * and the next page is loaded */
+#define BENCH_LOAD_TIMEOUT          60
+
+/* seconds an invocation with --server waits for the running instance to
+ * accept its uri before it starts on its own */
+#define SERVER_TIMEOUT              2
 
 /* default font size for fonts in webview */
 #define SETTING_DEFAULT_FONT_SIZE             16
@@ -88,24 +151,26 @@
  * enabled.
  * The CHAR_MAP(value, internalValue, outputValue, valueIfNotMapped) is a
  * little workaround to translate internal used string value like for
- * GET_CHAR(c, "cookie-accept") which is one of "always", "origin" or "never"
+ * c->config.settings.cookie_accept which is one of "always", "origin" or "never"
  * to those values that should be shown on statusbar.
  * The STATUS_VARAIBLE_SHOW is used as argument for a printf like function. So
- * the first argument is the output pattern. */
+ * the first argument is the output pattern. The settings are read from the
+ * fields of c->config.settings, named like the setting with '-' replaced by
+ * '_'. */
 /*
 #define STATUS_VARAIBLE_SHOW "js: %s, cookies: %s, hint-timeout: %d", \
-    GET_BOOL(c, "scripts") ? "on" : "off", \
-    GET_CHAR(c, "cookie-accept"), \
-    GET_INT(c, "hint-timeout")
+    c->config.settings.scripts ? "on" : "off", \
+    c->config.settings.cookie_accept, \
+    c->config.settings.hint_timeout
 */
-#define COOKIE GET_CHAR(c, "cookie-accept")
+#define COOKIE c->config.settings.cookie_accept
 #define CHAR_MAP(v, i, m, d) (strcmp(v, i) == 0 ? m : (d))
 #define STATUS_VARAIBLE_SHOW "%c%c%c%c%c%c%c%c", \
     CHAR_MAP(COOKIE, "always", 'A', CHAR_MAP(COOKIE, "origin", '@', 'a')), \
-    GET_BOOL(c, "dark-mode") ? 'D' : 'd', \
+    c->config.settings.dark_mode ? 'D' : 'd', \
     vb.incognito ? 'E' : 'e', \
-    GET_BOOL(c, "images") ? 'I' : 'i', \
-    GET_BOOL(c, "html5-local-storage") ? 'L' : 'l', \
-    GET_BOOL(c, "stylesheet") ? 'M' : 'm', \
-    GET_BOOL(c, "scripts") ? 'S' : 's', \
-    GET_BOOL(c, "strict-ssl") ? 'T' : 't'
+    c->config.settings.images ? 'I' : 'i', \
+    c->config.settings.html5_local_storage ? 'L' : 'l', \
+    c->config.settings.stylesheet ? 'M' : 'm', \
+    c->config.settings.scripts ? 'S' : 's', \
+    c->config.settings.strict_ssl ? 'T' : 't'
@@ -0,0 +1,364 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <webkit/webkit.h>
+
+#include "config.h"
+#include "main.h"
+#include "control.h"
+#include "ex.h"
+#include "ext-proxy.h"
+#include "util.h"
+
+extern struct Vimb vb;
+
+/* A connection to the control socket. The requests of a connection are run
+ * one after the other, but the main loop runs between them. */
+typedef struct {
+    GSocketConnection   *conn;
+    GDataInputStream    *in;
+    GOutputStream       *out;
+    GCancellable        *cancellable;
+    /* the request in progress */
+    char                *id;
+    Client              *c;
+    GString             *reply;
+    GString             *messages;  /* JSON strings of the messages of c */
+} Conn;
+
+static struct {
+    GSocketService  *service;
+    char            *path;
+    GList           *conns;
+    Conn            *running;       /* connection of the running ex command */
+} control;
+
+static gboolean remove_stale_socket(const char *path, GError **error);
+static gboolean on_incoming(GSocketService *service, GSocketConnection *conn,
+        GObject *source, gpointer data);
+static void on_read_line(GObject *stream, GAsyncResult *res, Conn *conn);
+static void on_eval_finished(GObject *source, GAsyncResult *res, Conn *conn);
+static void on_reply_written(GObject *stream, GAsyncResult *res, Conn *conn);
+static void request_run(Conn *conn, char *line);
+static Client *request_client(const char *tab);
+static void reply_begin(Conn *conn, VbCmdResult result);
+static void reply_send(Conn *conn);
+static void read_next(Conn *conn);
+static void conn_free(Conn *conn);
+
+
+/**
+ * Listen for ex commands on the unix socket at given path.
+ *
+ * Each line of a request is "{id} {tab} {command}", where tab is the number
+ * of the tab counted from 1 or "-" for the current tab. Each request is
+ * answered by a line with a JSON object with the id, the VbCmdResult, the
+ * messages written by the command and in case of :eval the result.
+ */
+gboolean control_start(const char *path, GError **error)
+{
+    GSocketAddress *address;
+    mode_t mask;
+    gboolean ok;
+
+    if (!remove_stale_socket(path, error)) {
+        return FALSE;
+    }
+
+    control.service = g_socket_service_new();
+    address         = g_unix_socket_address_new(path);
+    /* The socket runs ex commands, so it must not be accessible by others
+     * at any time. */
+    mask = umask(0077);
+    ok   = g_socket_listener_add_address(G_SOCKET_LISTENER(control.service),
+            address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+            NULL, NULL, error);
+    umask(mask);
+    g_object_unref(address);
+    if (!ok) {
+        g_clear_object(&control.service);
+
+        return FALSE;
+    }
+    control.path = g_strdup(path);
+
+    g_signal_connect(control.service, "incoming", G_CALLBACK(on_incoming), NULL);
+    g_socket_service_start(control.service);
+
+    return TRUE;
+}
+
+/**
+ * Collect the messages of the client while a control command runs on it.
+ */
+void control_echo(Client *c, MessageType type, const char *message)
+{
+    if (!control.running || control.running->c != c) {
+        return;
+    }
+    if (control.running->messages->len) {
+        g_string_append_c(control.running->messages, ',');
+    }
+    util_json_append_string(control.running->messages, message);
+}
+
+void control_cleanup(void)
+{
+    if (control.service) {
+        g_socket_service_stop(control.service);
+        g_socket_listener_close(G_SOCKET_LISTENER(control.service));
+        g_clear_object(&control.service);
+    }
+    g_list_free_full(control.conns, (GDestroyNotify)conn_free);
+    control.conns = NULL;
+    if (control.path) {
+        g_unlink(control.path);
+        g_clear_pointer(&control.path, g_free);
+    }
+}
+
+/**
+ * Remove a socket left at path by a crashed instance, which would make the
+ * bind fail. Fails if the path is no socket or another instance listens on
+ * it.
+ */
+static gboolean remove_stale_socket(const char *path, GError **error)
+{
+    GSocketClient *client;
+    GSocketConnection *conn;
+    GSocketAddress *address;
+    GStatBuf st;
+
+    if (g_lstat(path, &st)) {
+        return TRUE;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS, "%s exists and is no socket", path);
+        return FALSE;
+    }
+
+    address = g_unix_socket_address_new(path);
+    client  = g_socket_client_new();
+    conn    = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+    g_object_unref(client);
+    g_object_unref(address);
+    if (conn) {
+        g_object_unref(conn);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE, "%s is used by another instance", path);
+        return FALSE;
+    }
+    g_unlink(path);
+
+    return TRUE;
+}
+
+static gboolean on_incoming(GSocketService *service, GSocketConnection *sc,
+        GObject *source, gpointer data)
+{
+    Conn *conn = g_slice_new0(Conn);
+
+    conn->conn        = g_object_ref(sc);
+    conn->in          = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(sc)));
+    conn->out         = g_io_stream_get_output_stream(G_IO_STREAM(sc));
+    conn->cancellable = g_cancellable_new();
+    conn->reply       = g_string_sized_new(256);
+    conn->messages    = g_string_sized_new(64);
+    control.conns     = g_list_prepend(control.conns, conn);
+
+    read_next(conn);
+
+    return TRUE;
+}
+
+static void on_read_line(GObject *stream, GAsyncResult *res, Conn *conn)
+{
+    char *line;
+    GError *error = NULL;
+
+    line = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(stream), res, NULL, &error);
+    if (!line) {
+        /* the connection was closed by the peer or by control_cleanup */
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            control.conns = g_list_remove(control.conns, conn);
+            conn_free(conn);
+        }
+        g_clear_error(&error);
+        return;
+    }
+
+    request_run(conn, line);
+    g_free(line);
+}
+
+/**
+ * Run the command of a request line. All commands except of :eval are
+ * answered immediately, :eval is answered once the script returned.
+ */
+static void request_run(Conn *conn, char *line)
+{
+    char **parts;
+    const char *cmd;
+    VbCmdResult result;
+
+    parts = g_strsplit(line, " ", 3);
+    if (!parts[0] || !parts[1] || !parts[2]) {
+        conn->id = g_strdup(parts[0] ? parts[0] : "");
+        reply_begin(conn, CMD_ERROR);
+        g_string_append(conn->reply, ",\"error\":\"expected: {id} {tab} {command}\"");
+        goto send;
+    }
+    conn->id = g_strdup(parts[0]);
+    conn->c  = request_client(parts[1]);
+    if (!conn->c || !conn->c->webview) {
+        reply_begin(conn, CMD_ERROR);
+        g_string_append(conn->reply, ",\"error\":\"no such tab or tab is discarded\"");
+        goto send;
+    }
+
+    cmd = parts[2];
+    while (*cmd == ':' || *cmd == ' ') {
+        cmd++;
+    }
+    /* Evaluate the script directly to pass the result with the reply
+     * instead of writing it into the inputbox. */
+    if (g_str_has_prefix(cmd, "eval ")) {
+        ext_proxy_eval_script_full(conn->c, strchr(cmd, ' ') + 1, conn->cancellable,
+                (GAsyncReadyCallback)on_eval_finished, conn);
+        g_strfreev(parts);
+        return;
+    }
+
+    control.running = conn;
+    result          = ex_run_string(conn->c, cmd, FALSE);
+    control.running = NULL;
+    reply_begin(conn, result);
+
+send:
+    g_strfreev(parts);
+    reply_send(conn);
+}
+
+static void on_eval_finished(GObject *source, GAsyncResult *res, Conn *conn)
+{
+    WebKitUserMessage *message;
+    GError *error = NULL;
+    gboolean success = FALSE;
+    char *value = NULL;
+
+    message = webkit_web_view_send_message_to_page_finish(WEBKIT_WEB_VIEW(source), res, &error);
+    if (!message) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            reply_begin(conn, CMD_ERROR);
+            g_string_append(conn->reply, ",\"error\":");
+            util_json_append_string(conn->reply, error->message);
+            reply_send(conn);
+        }
+        g_error_free(error);
+        return;
+    }
+
+    g_variant_get(webkit_user_message_get_parameters(message), "(bs)", &success, &value);
+    reply_begin(conn, success ? CMD_SUCCESS : CMD_ERROR);
+    g_string_append(conn->reply, success ? ",\"eval\":" : ",\"error\":");
+    util_json_append_string(conn->reply, value);
+    reply_send(conn);
+
+    g_free(value);
+    g_object_unref(message);
+}
+
+static void on_reply_written(GObject *stream, GAsyncResult *res, Conn *conn)
+{
+    GError *error = NULL;
+
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), res, NULL, &error)) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            control.conns = g_list_remove(control.conns, conn);
+            conn_free(conn);
+        }
+        g_error_free(error);
+        return;
+    }
+    read_next(conn);
+}
+
+/**
+ * Returns the client of the tab given by its number or "-" for the current.
+ */
+static Client *request_client(const char *tab)
+{
+    char *end;
+    gint64 num;
+
+    if (!strcmp(tab, "-")) {
+        return vb_get_current_client();
+    }
+    num = g_ascii_strtoll(tab, &end, 10);
+    if (*end || num < 1 || num > G_MAXINT) {
+        return NULL;
+    }
+    return vb_get_client_for_tab(num - 1);
+}
+
+static void reply_begin(Conn *conn, VbCmdResult result)
+{
+    g_string_assign(conn->reply, "{\"id\":");
+    util_json_append_string(conn->reply, conn->id);
+    g_string_append_printf(conn->reply, ",\"result\":%d,\"messages\":[%s]",
+            result, conn->messages->str);
+}
+
+/**
+ * Write the reply and read the next request once it is written.
+ */
+static void reply_send(Conn *conn)
+{
+    g_string_append(conn->reply, "}\n");
+    g_output_stream_write_all_async(conn->out, conn->reply->str, conn->reply->len,
+            G_PRIORITY_DEFAULT, conn->cancellable,
+            (GAsyncReadyCallback)on_reply_written, conn);
+}
+
+static void read_next(Conn *conn)
+{
+    g_clear_pointer(&conn->id, g_free);
+    conn->c = NULL;
+    g_string_truncate(conn->messages, 0);
+    g_data_input_stream_read_line_async(conn->in, G_PRIORITY_DEFAULT,
+            conn->cancellable, (GAsyncReadyCallback)on_read_line, conn);
+}
+
+static void conn_free(Conn *conn)
+{
+    /* pending callbacks see the cancelled error and leave the conn alone */
+    g_cancellable_cancel(conn->cancellable);
+    g_io_stream_close(G_IO_STREAM(conn->conn), NULL, NULL);
+    g_object_unref(conn->cancellable);
+    g_object_unref(conn->in);
+    g_object_unref(conn->conn);
+    g_string_free(conn->reply, TRUE);
+    g_string_free(conn->messages, TRUE);
+    g_free(conn->id);
+    g_slice_free(Conn, conn);
+}
@@ -0,0 +1,468 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Directory listings for the filename completion. A directory is read by a
+ * GFileEnumerator on the worker threads of gio, which gives the type of each
+ * entry along with its name, so no extra stat is needed. The listing is kept
+ * until a GFileMonitor reports a change of the directory, and the names are
+ * streamed into the completion store while the directory is read. Listings
+ * of directories that can't be monitored are dropped once they are read.
+ */
+#include <gio/gio.h>
+#include <string.h>
+
+#include "completion.h"
+#include "dircache.h"
+#include "trace.h"
+#include "util.h"
+
+/* number of entries read from the enumerator at once */
+#define BATCH_SIZE      64
+/* number of listings kept before a read one is dropped */
+#define MAX_LISTINGS    32
+
+typedef struct {
+    int             ref;
+    char            *path;          /* expanded directory path */
+    GPtrArray       *names;         /* entry names, directories end in '/' */
+    gboolean        complete;       /* all entries are read */
+    GFileMonitor    *monitor;
+    GCancellable    *cancellable;
+} Listing;
+
+/* A filename completion waiting for the entries of a listing. */
+typedef struct {
+    Client                  *c;
+    GListStore              *store;
+    Listing                 *listing;
+    char                    *dirname;   /* directory part of the input as typed */
+    char                    *basename;  /* prefix the entry names must match */
+    guint                   seen;       /* number of listing names looked at */
+    CompletionUpdateFunc    func;
+} Request;
+
+static struct {
+    GHashTable  *listings;  /* path -> Listing* */
+    GHashTable  *requests;  /* Client* -> Request* */
+} dircache;
+
+static Listing *listing_get(const char *path);
+static void listing_drop(Listing *listing);
+static void listing_unref(Listing *listing);
+static void on_monitor_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other, GFileMonitorEvent event, Listing *listing);
+static void on_enumerate(GObject *source, GAsyncResult *res, gpointer data);
+static void on_next_files(GObject *source, GAsyncResult *res, gpointer data);
+static void listing_finish(Listing *listing);
+static void listing_notify(Listing *listing);
+static gboolean request_add(Request *req);
+static void request_free(Request *req);
+static int item_compare(gconstpointer a, gconstpointer b, gpointer data);
+static int item_ptr_compare(gconstpointer a, gconstpointer b);
+
+
+/**
+ * Fills the store with the filenames matching the input. Returns TRUE if the
+ * directory was read before and matching names were found. If the directory
+ * is still read, the matching names are added to the store when they arrive
+ * and func is called after each batch.
+ */
+gboolean dircache_fill_completion(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc func)
+{
+    Request *req;
+    Listing *listing;
+    gboolean found;
+    const char *last_slash;
+    char *real_dirname;
+
+    req        = g_slice_new0(Request);
+    last_slash = strrchr(input, '/');
+
+    req->basename = g_strdup(last_slash ? last_slash + 1 : input);
+    req->dirname  = g_strndup(input, last_slash ? last_slash + 1 - input : 0);
+    real_dirname  = util_expand(
+        *req->dirname ? req->dirname : ".",
+        UTIL_EXP_TILDE|UTIL_EXP_DOLLAR
+    );
+    listing = listing_get(real_dirname);
+    g_free(real_dirname);
+
+    req->store   = g_object_ref(store);
+    req->listing = listing;
+    listing->ref++;
+    found = request_add(req);
+
+    if (listing->complete) {
+        /* Drop a former request of the client that is still waiting. */
+        if (dircache.requests) {
+            g_hash_table_remove(dircache.requests, c);
+        }
+        request_free(req);
+
+        return found;
+    }
+
+    req->c    = c;
+    req->func = func;
+
+    if (!dircache.requests) {
+        dircache.requests = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)request_free);
+    }
+    g_hash_table_replace(dircache.requests, c, req);
+
+    return FALSE;
+}
+
+/**
+ * Drops the waiting filename completion of the client.
+ */
+void dircache_client_remove(Client *c)
+{
+    if (dircache.requests) {
+        g_hash_table_remove(dircache.requests, c);
+    }
+}
+
+/**
+ * Stops reading directories and frees all listings.
+ */
+void dircache_cleanup(void)
+{
+    if (dircache.requests) {
+        g_hash_table_destroy(dircache.requests);
+        dircache.requests = NULL;
+    }
+    if (dircache.listings) {
+        g_hash_table_destroy(dircache.listings);
+        dircache.listings = NULL;
+    }
+}
+
+/**
+ * Returns the listing for the path and starts to read the directory if there
+ * is none yet.
+ */
+static Listing *listing_get(const char *path)
+{
+    GHashTableIter iter;
+    Listing *listing;
+    GFile *file;
+
+    if (!dircache.listings) {
+        dircache.listings = g_hash_table_new_full(g_str_hash, g_str_equal,
+                NULL, (GDestroyNotify)listing_drop);
+    }
+    listing = g_hash_table_lookup(dircache.listings, path);
+    if (listing) {
+        return listing;
+    }
+
+    /* Make room by dropping a listing that is read completely. */
+    if (g_hash_table_size(dircache.listings) >= MAX_LISTINGS) {
+        g_hash_table_iter_init(&iter, dircache.listings);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&listing)) {
+            if (listing->complete) {
+                g_hash_table_iter_remove(&iter);
+                break;
+            }
+        }
+    }
+
+    listing              = g_slice_new0(Listing);
+    listing->ref         = 1;
+    listing->path        = g_strdup(path);
+    listing->names       = g_ptr_array_new_with_free_func(g_free);
+    listing->cancellable = g_cancellable_new();
+    g_hash_table_insert(dircache.listings, listing->path, listing);
+
+    file = g_file_new_for_path(path);
+    /* Without a monitor the listing can't be kept. */
+    listing->monitor = g_file_monitor_directory(file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+    if (listing->monitor) {
+        g_signal_connect(listing->monitor, "changed", G_CALLBACK(on_monitor_changed), listing);
+    }
+
+    trace_async_begin("dircache", GPOINTER_TO_SIZE(listing));
+    /* The enumeration holds its own reference. */
+    listing->ref++;
+    g_file_enumerate_children_async(file,
+            G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+            G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT, listing->cancellable,
+            on_enumerate, listing);
+    g_object_unref(file);
+
+    return listing;
+}
+
+/**
+ * Removes the listing from the cache. Called by the hash table.
+ */
+static void listing_drop(Listing *listing)
+{
+    if (listing->monitor) {
+        g_signal_handlers_disconnect_by_func(listing->monitor,
+                G_CALLBACK(on_monitor_changed), listing);
+        g_file_monitor_cancel(listing->monitor);
+        g_clear_object(&listing->monitor);
+    }
+    /* Stop reading if no completion waits for the entries anymore. */
+    if (listing->ref == 2 && !listing->complete) {
+        g_cancellable_cancel(listing->cancellable);
+    }
+    listing_unref(listing);
+}
+
+static void listing_unref(Listing *listing)
+{
+    if (--listing->ref) {
+        return;
+    }
+    g_object_unref(listing->cancellable);
+    g_ptr_array_unref(listing->names);
+    g_free(listing->path);
+    g_slice_free(Listing, listing);
+}
+
+/**
+ * Drops the listing if a directory entry was added, removed or renamed. The
+ * next completion reads the directory again.
+ */
+static void on_monitor_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other, GFileMonitorEvent event, Listing *listing)
+{
+    switch (event) {
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+        case G_FILE_MONITOR_EVENT_RENAMED:
+        case G_FILE_MONITOR_EVENT_UNMOUNTED:
+            g_hash_table_remove(dircache.listings, listing->path);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void on_enumerate(GObject *source, GAsyncResult *res, gpointer data)
+{
+    Listing *listing = (Listing*)data;
+    GFileEnumerator *enumerator;
+
+    enumerator = g_file_enumerate_children_finish(G_FILE(source), res, NULL);
+    if (!enumerator) {
+        /* Can't open directory, likely bad user input */
+        listing_finish(listing);
+        listing_unref(listing);
+        return;
+    }
+
+    g_file_enumerator_next_files_async(enumerator, BATCH_SIZE,
+            G_PRIORITY_DEFAULT, listing->cancellable, on_next_files, listing);
+}
+
+static void on_next_files(GObject *source, GAsyncResult *res, gpointer data)
+{
+    GFileEnumerator *enumerator = G_FILE_ENUMERATOR(source);
+    Listing *listing = (Listing*)data;
+    GError *error    = NULL;
+    GList *infos, *l;
+
+    infos = g_file_enumerator_next_files_finish(enumerator, res, &error);
+    if (error && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free(error);
+        trace_async_end("dircache", GPOINTER_TO_SIZE(listing));
+        g_object_unref(enumerator);
+        listing_unref(listing);
+        return;
+    }
+    g_clear_error(&error);
+
+    trace_begin("dircache batch");
+    for (l = infos; l; l = l->next) {
+        GFileInfo *info  = G_FILE_INFO(l->data);
+        const char *name = g_file_info_get_name(info);
+
+        if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+            g_ptr_array_add(listing->names, g_strconcat(name, "/", NULL));
+        } else {
+            g_ptr_array_add(listing->names, g_strdup(name));
+        }
+    }
+    trace_end("dircache batch");
+
+    if (!infos) {
+        /* All entries are read or the directory can't be read further. */
+        listing_finish(listing);
+        g_file_enumerator_close_async(enumerator, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+        g_object_unref(enumerator);
+        listing_unref(listing);
+        return;
+    }
+
+    g_list_free_full(infos, g_object_unref);
+    listing_notify(listing);
+
+    g_file_enumerator_next_files_async(enumerator, BATCH_SIZE,
+            G_PRIORITY_DEFAULT, listing->cancellable, on_next_files, listing);
+}
+
+/**
+ * Marks the listing as read and hands the last names to the waiting
+ * completions. A listing without monitor is dropped from the cache, as it
+ * would not be read again after a change of the directory.
+ */
+static void listing_finish(Listing *listing)
+{
+    trace_async_end("dircache", GPOINTER_TO_SIZE(listing));
+    listing->complete = TRUE;
+    listing_notify(listing);
+
+    if (!listing->monitor && dircache.listings
+        && g_hash_table_lookup(dircache.listings, listing->path) == listing) {
+        g_hash_table_remove(dircache.listings, listing->path);
+    }
+}
+
+/**
+ * Adds the names read since the last call to the waiting completions of the
+ * listing and calls their callback. The completions are dropped once the
+ * directory is read.
+ */
+static void listing_notify(Listing *listing)
+{
+    GHashTableIter iter;
+    GSList *notify = NULL, *l;
+    Request *req;
+
+    if (!dircache.requests) {
+        return;
+    }
+
+    g_hash_table_iter_init(&iter, dircache.requests);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&req)) {
+        if (req->listing != listing) {
+            continue;
+        }
+        if (request_add(req) || listing->complete) {
+            notify = g_slist_prepend(notify, req);
+        }
+    }
+
+    for (l = notify; l; l = l->next) {
+        req = (Request*)l->data;
+        req->func(req->c, req->store, listing->complete);
+        if (listing->complete) {
+            g_hash_table_remove(dircache.requests, req->c);
+        }
+    }
+    g_slist_free(notify);
+}
+
+/**
+ * Adds the names of the listing not seen yet by the request that match the
+ * typed prefix to its store. The new items are sorted and merged into the
+ * sorted store by a single splice, so the store emits one items-changed per
+ * batch. Returns TRUE if names were added.
+ */
+static gboolean request_add(Request *req)
+{
+    GListModel *model = G_LIST_MODEL(req->store);
+    GPtrArray *items, *merged;
+    CompletionItem *old;
+    const char *name;
+    char *result;
+    guint n, lo, hi, mid, i, j;
+
+    items = g_ptr_array_new_with_free_func(g_object_unref);
+    for (; req->seen < req->listing->names->len; req->seen++) {
+        name = g_ptr_array_index(req->listing->names, req->seen);
+        if (g_str_has_prefix(name, req->basename)) {
+            result = g_strconcat(req->dirname, name, NULL);
+            g_ptr_array_add(items, completion_item_new(result, NULL));
+            g_free(result);
+        }
+    }
+    if (!items->len) {
+        g_ptr_array_unref(items);
+        return FALSE;
+    }
+    g_ptr_array_sort(items, item_ptr_compare);
+
+    /* Only the stored items after the first new one have to be replaced. */
+    n = g_list_model_get_n_items(model);
+    for (lo = 0, hi = n; lo < hi;) {
+        mid = lo + (hi - lo) / 2;
+        old = g_list_model_get_item(model, mid);
+        if (item_compare(old, g_ptr_array_index(items, 0), NULL) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+        g_object_unref(old);
+    }
+
+    merged = g_ptr_array_new_full(n - lo + items->len, g_object_unref);
+    old    = lo < n ? g_list_model_get_item(model, lo) : NULL;
+    for (i = lo, j = 0; old || j < items->len;) {
+        if (old && (j >= items->len
+            || item_compare(old, g_ptr_array_index(items, j), NULL) <= 0)) {
+            g_ptr_array_add(merged, old);
+            old = ++i < n ? g_list_model_get_item(model, i) : NULL;
+        } else {
+            g_ptr_array_add(merged, g_object_ref(g_ptr_array_index(items, j++)));
+        }
+    }
+    g_list_store_splice(req->store, lo, n - lo, merged->pdata, merged->len);
+
+    g_ptr_array_unref(merged);
+    g_ptr_array_unref(items);
+
+    return TRUE;
+}
+
+static void request_free(Request *req)
+{
+    if (req->store) {
+        g_object_unref(req->store);
+    }
+    if (req->listing) {
+        listing_unref(req->listing);
+    }
+    g_free(req->dirname);
+    g_free(req->basename);
+    g_slice_free(Request, req);
+}
+
+static int item_compare(gconstpointer a, gconstpointer b, gpointer data)
+{
+    return g_strcmp0(
+        completion_item_get_first(COMPLETION_ITEM((gpointer)a)),
+        completion_item_get_first(COMPLETION_ITEM((gpointer)b))
+    );
+}
+
+static int item_ptr_compare(gconstpointer a, gconstpointer b)
+{
+    return item_compare(*(gconstpointer*)a, *(gconstpointer*)b, NULL);
+}
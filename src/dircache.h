@@ -0,0 +1,33 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _DIRCACHE_H
+#define _DIRCACHE_H
+
+#include <gio/gio.h>
+
+#include "completion.h"
+#include "main.h"
+
+gboolean dircache_fill_completion(Client *c, GListStore *store,
+        const char *input, CompletionUpdateFunc func);
+void dircache_client_remove(Client *c);
+void dircache_cleanup(void);
+
+#endif /* end of include guard: _DIRCACHE_H */
@@ -0,0 +1,782 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <signal.h>
+#include <webkit/webkit.h>
+
+#include "config.h"
+#include "main.h"
+#include "autocmd.h"
+#include "download.h"
+
+extern struct Vimb vb;
+
+typedef enum {
+    DOWNLOAD_QUEUED,
+    DOWNLOAD_RUNNING,
+    DOWNLOAD_FINISHED,
+    DOWNLOAD_FAILED,
+    DOWNLOAD_CANCELLED,
+} DownloadStatus;
+
+/* A download written by WebKit or by the external download-command together
+ * with its throughput statistics. */
+typedef struct {
+    guint           id;
+    Client          *c;             /* NULL if the tab was closed */
+    WebKitDownload  *download;      /* NULL if the download is done */
+    char            *uri;
+    char            *destination;   /* file uri, set if the download is done */
+    char            *error;
+    DownloadStatus  status;
+    guint64         received;       /* bytes received so far */
+    guint64         sampled;        /* bytes received at the last sample */
+    gint64          sampled_at;     /* monotonic time of the last sample */
+    gdouble         rate;           /* moving average of bytes per second */
+    /* only used for downloads by the download-command */
+    gboolean        external;
+    char            **argv;
+    char            **envp;
+    GSubprocess     *proc;          /* NULL if the command is not running */
+    GCancellable    *cancellable;
+    guint           attempts;       /* number of times the command was run */
+    guint           retry;          /* timeout source of the next attempt */
+} Download;
+
+static struct {
+    GQueue  all;        /* Download in order of their start */
+    guint   done;       /* number of downloads in all that are done */
+    guint   next_id;
+    guint   timer;      /* samples the running downloads */
+    GQueue  waiting;    /* external downloads that wait for a free slot */
+    guint   running;    /* number of running external downloads */
+} dm = {G_QUEUE_INIT, 0, 1, 0, G_QUEUE_INIT, 0};
+
+static const char *status_names[] = {"queued", "running", "finished", "failed", "cancelled"};
+
+static gboolean on_decide_destination(WebKitDownload *download,
+        gchar *suggested_filename, Download *d);
+static void on_failed(WebKitDownload *download, GError *error, Download *d);
+static void on_finished(WebKitDownload *download, Download *d);
+static void on_received_data(WebKitDownload *download, guint64 data_length,
+        Download *d);
+static gboolean on_refresh(gpointer data);
+static void sample(Download *d, gint64 now);
+static gint64 eta(Download *d);
+static void external_dispatch(void);
+static void external_start(Download *d);
+static void on_external_exited(GSubprocess *proc, GAsyncResult *res, Download *d);
+static gboolean on_external_retry(gpointer data);
+static void external_cancel(Download *d);
+static void external_failed(Download *d, DownloadStatus status, const char *error);
+static char *download_name(Download *d);
+static Download *download_new(Client *c, const char *uri);
+static Download *download_find(guint id);
+static gboolean download_is_done(Download *d);
+static void download_done(Download *d);
+static void download_free(Download *d);
+static void history_trim(void);
+
+
+/**
+ * Let the download manager take care of a download that is written by
+ * WebKit on behalf of the client.
+ */
+void download_add(Client *c, WebKitDownload *download)
+{
+    Download *d;
+
+    d = download_new(c, webkit_uri_request_get_uri(webkit_download_get_request(download)));
+    d->download   = g_object_ref(download);
+    d->status     = DOWNLOAD_RUNNING;
+    d->sampled_at = g_get_monotonic_time();
+
+    g_signal_connect(download, "decide-destination", G_CALLBACK(on_decide_destination), d);
+    g_signal_connect(download, "failed", G_CALLBACK(on_failed), d);
+    g_signal_connect(download, "finished", G_CALLBACK(on_finished), d);
+    g_signal_connect(download, "received-data", G_CALLBACK(on_received_data), d);
+
+    /* All running downloads share the same timer, so the statusbar is not
+     * refreshed for every received chunk of data. */
+    if (!dm.timer) {
+        dm.timer = g_timeout_add(DOWNLOAD_REFRESH_INTERVAL, on_refresh, NULL);
+    }
+
+    /* to reflect the correct download count */
+    vb_statusbar_update(c);
+}
+
+/**
+ * Queue the download of the uri by the download-command. At most
+ * DOWNLOAD_JOBS_MAX commands are run at the same time.
+ */
+gboolean download_add_external(Client *c, const char *uri)
+{
+    Download *d;
+    char *cmd, **argv;
+    GError *error = NULL;
+
+    cmd = g_strdup_printf(c->config.settings.download_command, uri);
+    if (!g_shell_parse_argv(cmd, NULL, &argv, &error)) {
+        g_warning("Could not parse download-command '%s': %s", cmd, error->message);
+        vb_echo(c, MSG_ERROR, TRUE, "Could not start download");
+        g_error_free(error);
+        g_free(cmd);
+        return FALSE;
+    }
+    g_free(cmd);
+
+    d           = download_new(c, uri);
+    d->external = TRUE;
+    d->argv     = argv;
+    d->status   = DOWNLOAD_QUEUED;
+    /* Take the environment now, $VIMB_URI changes with the next page. */
+    d->envp     = g_environ_setenv(g_get_environ(), "VIMB_DOWNLOAD_PATH",
+            c->config.settings.download_path, TRUE);
+
+    g_queue_push_tail(&dm.waiting, d);
+    external_dispatch();
+    if (d->status == DOWNLOAD_QUEUED) {
+        vb_echo(c, MSG_NORMAL, FALSE, "Download queued");
+    }
+    vb_statusbar_update(c);
+
+    return TRUE;
+}
+
+/**
+ * Sums up the downloads of the client. The rate is given in bytes per second
+ * and eta is the highest remaining time in seconds of all downloads or -1 if
+ * this is not known.
+ */
+void download_client_stats(Client *c, guint *count, guint *queued,
+        guint64 *rate, gint64 *eta_max)
+{
+    Download *d;
+
+    *count   = 0;
+    *queued  = 0;
+    *rate    = 0;
+    *eta_max = -1;
+    for (GList *l = c->state.downloads; l; l = l->next) {
+        d = l->data;
+        if (d->status == DOWNLOAD_QUEUED) {
+            *queued += 1;
+            continue;
+        }
+        *count   += 1;
+        *rate    += (guint64)d->rate;
+        *eta_max  = MAX(*eta_max, eta(d));
+    }
+}
+
+/**
+ * Called if the tab of the client is closed. Downloads that are not done are
+ * handed over to another tab. If this was the last one, the downloads are
+ * cancelled, only running download commands are left alone.
+ */
+void download_client_remove(Client *c)
+{
+    Client *heir = NULL;
+    Download *d;
+
+    /* Placeholders have no settings to run the downloads with. */
+    for (Client *o = vb.clients; o; o = o->next) {
+        if (o != c && !vb_tab_is_placeholder(o)) {
+            heir = o;
+            break;
+        }
+    }
+
+    for (GList *l = dm.all.head; l; l = l->next) {
+        d = l->data;
+        if (d->c != c) {
+            continue;
+        }
+        if (download_is_done(d)) {
+            d->c = NULL;
+        } else if (heir) {
+            d->c = heir;
+            heir->state.downloads = g_list_append(heir->state.downloads, d);
+        } else if (d->download) {
+            g_signal_handlers_disconnect_by_data(d->download, d);
+            webkit_download_cancel(d->download);
+            d->c = NULL;
+            if (d->status == DOWNLOAD_RUNNING) {
+                d->status = DOWNLOAD_CANCELLED;
+            }
+            download_done(d);
+        } else if (d->status == DOWNLOAD_QUEUED) {
+            d->c = NULL;
+            external_cancel(d);
+        } else {
+            d->c = NULL;
+        }
+    }
+    g_list_free(c->state.downloads);
+    c->state.downloads = NULL;
+
+    history_trim();
+    if (heir) {
+        vb_statusbar_update(heir);
+    }
+}
+
+/**
+ * Cancel the queued or running download with given id.
+ */
+gboolean download_cancel(guint id)
+{
+    Download *d = download_find(id);
+
+    if (!d || download_is_done(d)) {
+        return FALSE;
+    }
+    if (d->external) {
+        external_cancel(d);
+        history_trim();
+    } else {
+        webkit_download_cancel(d->download);
+    }
+
+    return TRUE;
+}
+
+/**
+ * Start the failed or cancelled download with given id again. The download
+ * is written to the same destination as before.
+ */
+gboolean download_retry(Client *c, guint id)
+{
+    Download *d = download_find(id);
+    WebKitDownload *download;
+
+    if (!d || !download_is_done(d) || d->status == DOWNLOAD_FINISHED) {
+        return FALSE;
+    }
+
+    /* Prefer the tab the download was started from. */
+    if (d->c) {
+        c = d->c;
+    }
+
+    if (d->external) {
+        g_clear_pointer(&d->error, g_free);
+        d->c        = c;
+        d->status   = DOWNLOAD_QUEUED;
+        d->attempts = 0;
+        dm.done--;
+        c->state.downloads = g_list_append(c->state.downloads, d);
+        g_queue_push_tail(&dm.waiting, d);
+        external_dispatch();
+        vb_statusbar_update(c);
+
+        return TRUE;
+    }
+
+    if (c->webview) {
+        download = webkit_web_view_download_uri(c->webview, d->uri);
+    } else {
+        download = webkit_network_session_download_uri(vb.session, d->uri);
+    }
+    if (d->destination) {
+        webkit_download_set_allow_overwrite(download, TRUE);
+        webkit_download_set_destination(download, d->destination);
+    }
+    g_object_unref(download);
+
+    /* The new download replaces the failed one in the listing. */
+    g_queue_remove(&dm.all, d);
+    dm.done--;
+    download_free(d);
+
+    return TRUE;
+}
+
+/**
+ * Show the running and the latest finished downloads.
+ */
+void download_list(Client *c)
+{
+    GString *str;
+    Download *d;
+    char *name, *rate;
+    gint64 remaining;
+
+    str = g_string_new("-- Downloads --");
+    for (GList *l = dm.all.head; l; l = l->next) {
+        d    = l->data;
+        name = download_name(d);
+        g_string_append_printf(str, "\n%3u %-9s ", d->id, status_names[d->status]);
+        if (d->status == DOWNLOAD_RUNNING && d->download) {
+            rate = g_format_size((guint64)d->rate);
+            g_string_append_printf(str, "%3u%% %s/s ",
+                    (guint)(webkit_download_get_estimated_progress(d->download) * 100),
+                    rate);
+            if ((remaining = eta(d)) >= 0) {
+                g_string_append_printf(str, "ETA %" G_GINT64_FORMAT "s ", remaining);
+            }
+            g_free(rate);
+        } else if (d->external && d->attempts > 1) {
+            g_string_append_printf(str, "attempt %u ", d->attempts);
+        }
+        g_string_append(str, name);
+        if (d->status == DOWNLOAD_FAILED && d->error) {
+            g_string_append_printf(str, " (%s)", d->error);
+        }
+        g_free(name);
+    }
+
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", str->str);
+    g_string_free(str, TRUE);
+}
+
+void download_cleanup(void)
+{
+    Download *d;
+
+    if (dm.timer) {
+        g_source_remove(dm.timer);
+        dm.timer = 0;
+    }
+    g_queue_clear(&dm.waiting);
+    while ((d = g_queue_pop_head(&dm.all))) {
+        if (d->download) {
+            g_signal_handlers_disconnect_by_data(d->download, d);
+        }
+        /* The running download commands are left alone, only the wait for
+         * them is cancelled. */
+        if (d->cancellable) {
+            g_cancellable_cancel(d->cancellable);
+        }
+        download_free(d);
+    }
+    dm.done    = 0;
+    dm.running = 0;
+}
+
+/**
+ * Callback for the webkit download decide destination signal.
+ * This signal is emitted after response is received to decide a destination
+ * URI for the download.
+ */
+static gboolean on_decide_destination(WebKitDownload *download,
+        gchar *suggested_filename, Download *d)
+{
+    if (webkit_download_get_destination(download)) {
+        return TRUE;
+    }
+
+    return vb_download_set_destination(d->c, download, suggested_filename, NULL);
+}
+
+/**
+ * Callback for the webkit download failed signal.
+ * This signal is emitted when an error occurs during the download operation.
+ */
+static void on_failed(WebKitDownload *download, GError *error, Download *d)
+{
+    char *name;
+
+    if (g_error_matches(error, WEBKIT_DOWNLOAD_ERROR, WEBKIT_DOWNLOAD_ERROR_CANCELLED_BY_USER)) {
+        d->status = DOWNLOAD_CANCELLED;
+    } else {
+        d->status = DOWNLOAD_FAILED;
+    }
+    d->error = g_strdup(error->message);
+
+#ifdef FEATURE_AUTOCMD
+    autocmd_run(d->c, AU_DOWNLOAD_FAILED, d->uri, NULL);
+#endif
+
+    name = download_name(d);
+    vb_echo(d->c, MSG_ERROR, FALSE, "Download of %s failed (%s)", name, error->message);
+    g_free(name);
+}
+
+/**
+ * Callback for the webkit download finished signal.
+ * This signal is emitted when download finishes successfully or due to an
+ * error. In case of errors “failed” signal is emitted before this one.
+ */
+static void on_finished(WebKitDownload *download, Download *d)
+{
+    Client *c = d->c;
+    char *name;
+
+#ifdef FEATURE_AUTOCMD
+    autocmd_run(c, AU_DOWNLOAD_FINISHED, d->uri, NULL);
+#endif
+
+    /* Failed downloads were reported in on_failed() already. */
+    if (d->status == DOWNLOAD_RUNNING) {
+        d->status = DOWNLOAD_FINISHED;
+        name      = download_name(d);
+        vb_echo(c, MSG_NORMAL, FALSE, "Download of %s finished", name);
+        g_free(name);
+    }
+
+    download_done(d);
+    history_trim();
+}
+
+/**
+ * Callback for the webkit download received-data signal. This is called for
+ * every chunk written to the destination, so only the bytes are counted here
+ * and the statistics are updated by the shared timer.
+ */
+static void on_received_data(WebKitDownload *download, guint64 data_length,
+        Download *d)
+{
+    d->received += data_length;
+}
+
+/**
+ * Takes a throughput sample of all running downloads and refreshes the
+ * statusbar of the clients they belong to.
+ */
+static gboolean on_refresh(gpointer data)
+{
+    GSList *clients = NULL;
+    gint64 now = g_get_monotonic_time();
+    Download *d;
+
+    for (GList *l = dm.all.head; l; l = l->next) {
+        d = l->data;
+        if (d->status != DOWNLOAD_RUNNING || !d->download) {
+            continue;
+        }
+        sample(d, now);
+        if (!g_slist_find(clients, d->c)) {
+            clients = g_slist_prepend(clients, d->c);
+        }
+    }
+
+    if (!clients) {
+        dm.timer = 0;
+        return G_SOURCE_REMOVE;
+    }
+    for (GSList *l = clients; l; l = l->next) {
+        vb_statusbar_update(l->data);
+    }
+    g_slist_free(clients);
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Update the exponentially weighted moving average of the download rate.
+ */
+static void sample(Download *d, gint64 now)
+{
+    gdouble elapsed, current;
+
+    elapsed = (gdouble)(now - d->sampled_at) / G_USEC_PER_SEC;
+    if (elapsed <= 0) {
+        return;
+    }
+    current = (d->received - d->sampled) / elapsed;
+
+    /* Take the first sample as it is, so that the average has not to climb
+     * up from zero. */
+    if (d->rate == 0.0) {
+        d->rate = current;
+    } else {
+        d->rate = DOWNLOAD_RATE_WEIGHT * current + (1.0 - DOWNLOAD_RATE_WEIGHT) * d->rate;
+    }
+    d->sampled    = d->received;
+    d->sampled_at = now;
+}
+
+/**
+ * Returns the remaining time of the download in seconds or -1 if the size
+ * of the download or the rate is not known.
+ */
+static gint64 eta(Download *d)
+{
+    WebKitURIResponse *response;
+    guint64 total;
+
+    if (!d->download || d->rate < 1.0
+        || !(response = webkit_download_get_response(d->download))) {
+        return -1;
+    }
+    total = webkit_uri_response_get_content_length(response);
+    if (total <= d->received) {
+        return -1;
+    }
+
+    return (gint64)((total - d->received) / d->rate);
+}
+
+/**
+ * Start waiting download commands as long as there are free slots.
+ */
+static void external_dispatch(void)
+{
+    Download *d;
+
+    while (dm.running < DOWNLOAD_JOBS_MAX && (d = g_queue_pop_head(&dm.waiting))) {
+        external_start(d);
+    }
+}
+
+static void external_start(Download *d)
+{
+    GSubprocessLauncher *launcher;
+    GError *error = NULL;
+
+    launcher = g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_NONE);
+    g_subprocess_launcher_set_environ(launcher, d->envp);
+    d->proc = g_subprocess_launcher_spawnv(launcher, (const char * const *)d->argv, &error);
+    g_object_unref(launcher);
+
+    if (!d->proc) {
+        g_warning("Can't run '%s': %s", d->argv[0], error->message);
+        /* Don't retry a command that can't be run at all. */
+        external_failed(d, DOWNLOAD_FAILED, error->message);
+        g_error_free(error);
+        return;
+    }
+
+    d->status      = DOWNLOAD_RUNNING;
+    d->cancellable = g_cancellable_new();
+    d->attempts++;
+    dm.running++;
+
+    if (d->c && d->attempts == 1) {
+        vb_echo(d->c, MSG_NORMAL, FALSE, "Download started");
+    }
+    g_subprocess_wait_check_async(d->proc, d->cancellable,
+            (GAsyncReadyCallback)on_external_exited, d);
+}
+
+/**
+ * Called when the download command exited. Failed commands are run again up
+ * to DOWNLOAD_RETRY_MAX times with a doubled delay before each attempt.
+ */
+static void on_external_exited(GSubprocess *proc, GAsyncResult *res, Download *d)
+{
+    GError *error = NULL;
+    Client *c;
+    char *name;
+    guint delay;
+
+    if (!g_subprocess_wait_check_finish(proc, res, &error)
+        && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        /* The download manager is cleaned up, d is already freed. */
+        g_error_free(error);
+        return;
+    }
+
+    dm.running--;
+    g_clear_object(&d->proc);
+    g_clear_object(&d->cancellable);
+    c = d->c;
+
+    if (!error) {
+        d->status = DOWNLOAD_FINISHED;
+        if (c) {
+#ifdef FEATURE_AUTOCMD
+            autocmd_run(c, AU_DOWNLOAD_FINISHED, d->uri, NULL);
+#endif
+            name = download_name(d);
+            vb_echo(c, MSG_NORMAL, FALSE, "Download of %s finished", name);
+            g_free(name);
+        }
+        download_done(d);
+    } else if (d->status == DOWNLOAD_CANCELLED) {
+        external_failed(d, DOWNLOAD_CANCELLED, NULL);
+    } else if (d->attempts <= DOWNLOAD_RETRY_MAX) {
+        delay     = DOWNLOAD_RETRY_DELAY << (d->attempts - 1);
+        d->status = DOWNLOAD_QUEUED;
+        d->retry  = g_timeout_add_seconds(delay, on_external_retry, d);
+        if (c) {
+            vb_echo(c, MSG_ERROR, FALSE, "Download failed (%s), retry in %us",
+                    error->message, delay);
+        }
+    } else {
+        external_failed(d, DOWNLOAD_FAILED, error->message);
+    }
+    g_clear_error(&error);
+
+    history_trim();
+    external_dispatch();
+    if (c) {
+        vb_statusbar_update(c);
+    }
+}
+
+static gboolean on_external_retry(gpointer data)
+{
+    Download *d = data;
+
+    d->retry = 0;
+    g_queue_push_tail(&dm.waiting, d);
+    external_dispatch();
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Cancel a download command. A running command is terminated and the
+ * download is done once the command exited.
+ */
+static void external_cancel(Download *d)
+{
+    if (d->proc) {
+        d->status = DOWNLOAD_CANCELLED;
+        g_subprocess_send_signal(d->proc, SIGTERM);
+        return;
+    }
+
+    if (d->retry) {
+        g_source_remove(d->retry);
+        d->retry = 0;
+    } else {
+        g_queue_remove(&dm.waiting, d);
+    }
+    external_failed(d, DOWNLOAD_CANCELLED, NULL);
+}
+
+/**
+ * Mark the download command as failed or cancelled and report this.
+ */
+static void external_failed(Download *d, DownloadStatus status, const char *error)
+{
+    char *name;
+
+    d->status = status;
+    d->error  = g_strdup(error);
+    if (d->c) {
+#ifdef FEATURE_AUTOCMD
+        autocmd_run(d->c, AU_DOWNLOAD_FAILED, d->uri, NULL);
+#endif
+        if (error) {
+            name = download_name(d);
+            vb_echo(d->c, MSG_ERROR, FALSE, "Download of %s failed (%s)", name, error);
+            g_free(name);
+        }
+    }
+    download_done(d);
+}
+
+/**
+ * Returns the basename of the destination or the uri if the destination is
+ * not known yet. Returned string must be freed.
+ */
+static char *download_name(Download *d)
+{
+    const char *destination;
+    char *filename, *name;
+
+    destination = d->download ? webkit_download_get_destination(d->download) : d->destination;
+    if (destination && (filename = g_filename_from_uri(destination, NULL, NULL))) {
+        name = g_path_get_basename(filename);
+        g_free(filename);
+
+        return name;
+    }
+
+    return g_strdup(d->uri);
+}
+
+static Download *download_new(Client *c, const char *uri)
+{
+    Download *d = g_slice_new0(Download);
+
+    d->id  = dm.next_id++;
+    d->c   = c;
+    d->uri = g_strdup(uri);
+
+    g_queue_push_tail(&dm.all, d);
+    c->state.downloads = g_list_append(c->state.downloads, d);
+
+    return d;
+}
+
+static Download *download_find(guint id)
+{
+    for (GList *l = dm.all.head; l; l = l->next) {
+        if (((Download*)l->data)->id == id) {
+            return l->data;
+        }
+    }
+    return NULL;
+}
+
+static gboolean download_is_done(Download *d)
+{
+    return d->status >= DOWNLOAD_FINISHED && !d->download && !d->proc;
+}
+
+/**
+ * Release the webkit download and keep the entry for the listing.
+ */
+static void download_done(Download *d)
+{
+    if (d->download) {
+        d->destination = g_strdup(webkit_download_get_destination(d->download));
+        g_signal_handlers_disconnect_by_data(d->download, d);
+        g_clear_object(&d->download);
+    }
+    d->rate = 0;
+    dm.done++;
+
+    if (d->c) {
+        d->c->state.downloads = g_list_remove(d->c->state.downloads, d);
+        /* to reflect the correct download count */
+        vb_statusbar_update(d->c);
+    }
+}
+
+static void download_free(Download *d)
+{
+    if (d->retry) {
+        g_source_remove(d->retry);
+    }
+    g_clear_object(&d->download);
+    g_clear_object(&d->proc);
+    g_clear_object(&d->cancellable);
+    g_strfreev(d->argv);
+    g_strfreev(d->envp);
+    g_free(d->uri);
+    g_free(d->destination);
+    g_free(d->error);
+    g_slice_free(Download, d);
+}
+
+/**
+ * Drop the oldest done downloads if there are more than DOWNLOAD_HISTORY_MAX.
+ */
+static void history_trim(void)
+{
+    GList *l, *next;
+
+    for (l = dm.all.head; l && dm.done > DOWNLOAD_HISTORY_MAX; l = next) {
+        next = l->next;
+        if (download_is_done(l->data)) {
+            download_free(l->data);
+            g_queue_delete_link(&dm.all, l);
+            dm.done--;
+        }
+    }
+}
@@ -25,25 +25,32 @@
 #include <jsc/jsc.h>
 #include <webkit/webkit.h>
 #include <string.h>
-#include <sys/wait.h>
 
 #include "ascii.h"
+#include "async.h"
 #include "bookmark.h"
+#include "budget.h"
 #include "command.h"
 #include "completion.h"
 #include "config.h"
+#include "dircache.h"
+#include "download.h"
 #include "ex.h"
 #include "handler.h"
 #include "hints.h"
 #include "history.h"
 #include "main.h"
 #include "map.h"
+#include "perf.h"
 #include "setting.h"
 #include "shortcut.h"
+#include "site.h"
+#include "trace.h"
 #include "util.h"
 #include "ext-proxy.h"
 #include "autocmd.h"
 #include "util.h"
+#include "user-content.h"
 
 typedef enum {
 #ifdef FEATURE_AUTOCMD
@@ -53,8 +60,11 @@ typedef enum {
     EX_BMA,
     EX_BMR,
     EX_EVAL,
+    EX_FILTERSTATS,
+    EX_FILTERUPDATE,
     EX_HARDCOPY,
     EX_CLEARDATA,
+    EX_DOWNLOADS,
     EX_CMAP,
     EX_CNOREMAP,
     EX_HANDADD,
@@ -65,9 +75,11 @@ typedef enum {
     EX_CUNMAP,
     EX_IUNMAP,
     EX_INOREMAP,
+    EX_MEMSTAT,
     EX_NUNMAP,
     EX_NORMAL,
     EX_OPEN,
+    EX_PERF,
 #ifdef FEATURE_QUEUE
     EX_QCLEAR,
     EX_QPOP,
@@ -84,13 +96,17 @@ typedef enum {
     EX_SET,
     EX_SHELLCMD,
     EX_SHELLEX,
+    EX_SITEADD,
+    EX_SITEREM,
     EX_SOURCE,
     EX_TABOPEN,
     EX_TABCLOSE,
+    EX_TABDISCARD,
     EX_TABNEXT,
     EX_TABPREV,
     EX_TABFIRST,
     EX_TABLAST,
+    EX_TRACE,
 } ExCode;
 
 typedef enum {
@@ -129,6 +145,36 @@ static struct {
     Phase phase; /* current parsing phase */
 } info = {'\0', PHASE_START};
 
+/* A shell command started by :shellcmd or :shellex. */
+typedef struct {
+    Client              *c;
+    ExCode              code;
+    char                **argv;
+    GSubprocessLauncher *launcher;
+    GSubprocess         *proc;
+    GCancellable        *cancellable;
+    GDataInputStream    *out_stream;
+    GDataInputStream    *err_stream;
+    GString             *out;       /* collected stdout for :shellcmd */
+    GString             *err;       /* collected stderr */
+    guint               pending;    /* outstanding reads and wait */
+    guint               echo_id;    /* timeout to show the collected stdout */
+    gboolean            failed;     /* an ex command from :shellex failed */
+} ShellJob;
+
+/* A shell command waiting for the current selection of the page. */
+typedef struct {
+    ExCode   code;
+    gboolean bang;
+    char     *cmd;
+} ShellRequest;
+
+static struct {
+    GList  *running;
+    guint  count;       /* number of running jobs */
+    GQueue waiting;     /* jobs waiting for a free slot */
+} shell = {NULL, 0, G_QUEUE_INIT};
+
 static void input_activate(Client *c);
 static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist);
 static gboolean parse_count(const char **input, ExArg *arg);
@@ -149,12 +195,16 @@ static VbCmdResult ex_eval(Client *c, const ExArg *arg);
 static void on_eval_script_finished_usermessage(GObject *source_object,
         GAsyncResult *result, gpointer user_data);
 static VbCmdResult ex_cleardata(Client *c, const ExArg *arg);
+static VbCmdResult ex_downloads(Client *c, const ExArg *arg);
+static VbCmdResult ex_filter(Client *c, const ExArg *arg);
 static VbCmdResult ex_hardcopy(Client *c, const ExArg *arg);
 static void print_failed_cb(WebKitPrintOperation* op, GError *err, Client *c);
 static VbCmdResult ex_map(Client *c, const ExArg *arg);
 static VbCmdResult ex_unmap(Client *c, const ExArg *arg);
+static VbCmdResult ex_memstat(Client *c, const ExArg *arg);
 static VbCmdResult ex_normal(Client *c, const ExArg *arg);
 static VbCmdResult ex_open(Client *c, const ExArg *arg);
+static VbCmdResult ex_perf(Client *c, const ExArg *arg);
 #ifdef FEATURE_QUEUE
 static VbCmdResult ex_queue(Client *c, const ExArg *arg);
 #endif
@@ -165,14 +215,28 @@ static VbCmdResult ex_save(Client *c, const ExArg *arg);
 static VbCmdResult ex_set(Client *c, const ExArg *arg);
 static VbCmdResult ex_shellcmd(Client *c, const ExArg *arg);
 static VbCmdResult ex_shellex(Client *c, const ExArg *arg);
+static void shell_request(Client *c, const ExArg *arg);
+static void shell_request_run(Client *c, const char *selection, gpointer data);
+static void shell_request_free(gpointer data);
+static gboolean shell_job_new(Client *c, ExCode code, const char *cmd);
+static gboolean shell_job_start(ShellJob *job);
+static void on_shell_job_stdout(GDataInputStream *stream, GAsyncResult *res, ShellJob *job);
+static void on_shell_job_stderr(GDataInputStream *stream, GAsyncResult *res, ShellJob *job);
+static char *shell_job_read_line(GDataInputStream *stream, GAsyncResult *res);
+static gboolean on_shell_job_echo(gpointer data);
+static void on_shell_job_exited(GSubprocess *proc, GAsyncResult *res, ShellJob *job);
+static void shell_job_done(ShellJob *job);
+static void shell_job_free(ShellJob *job);
+static gboolean shell_job_client_alive(ShellJob *job);
 static VbCmdResult ex_shortcut(Client *c, const ExArg *arg);
+static VbCmdResult ex_site(Client *c, const ExArg *arg);
 static VbCmdResult ex_source(Client *c, const ExArg *arg);
 static VbCmdResult ex_tabcmd(Client *c, const ExArg *arg);
 static VbCmdResult ex_handlers(Client *c, const ExArg *arg);
-
-static void update_current_selection_env_var(Client *c);
+static VbCmdResult ex_trace(Client *c, const ExArg *arg);
 
 static gboolean complete(Client *c, short direction);
+static void complete_update(Client *c, GListStore *store, gboolean done);
 static void completion_select(Client *c, char *match);
 static gboolean history(Client *c, gboolean prev);
 static void history_rewind(void);
@@ -195,18 +259,23 @@ static ExInfo commands[] = {
     {"cnoremap",         EX_CNOREMAP,    ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"cunmap",           EX_CUNMAP,      ex_unmap,      EX_FLAG_LHS},
     {"cleardata",        EX_CLEARDATA,   ex_cleardata,  EX_FLAG_LHS|EX_FLAG_RHS},
+    {"downloads",        EX_DOWNLOADS,   ex_downloads,  EX_FLAG_RHS},
     {"hardcopy",         EX_HARDCOPY,    ex_hardcopy,   EX_FLAG_NONE},
     {"handler-add",      EX_HANDADD,     ex_handlers,   EX_FLAG_RHS},
     {"handler-remove",   EX_HANDREM,     ex_handlers,   EX_FLAG_RHS},
     {"eval",             EX_EVAL,        ex_eval,       EX_FLAG_CMD|EX_FLAG_BANG},
+    {"filter-stats",     EX_FILTERSTATS, ex_filter,     EX_FLAG_NONE},
+    {"filter-update",    EX_FILTERUPDATE,ex_filter,     EX_FLAG_NONE},
     {"imap",             EX_IMAP,        ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"inoremap",         EX_INOREMAP,    ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"iunmap",           EX_IUNMAP,      ex_unmap,      EX_FLAG_LHS},
+    {"memstat",          EX_MEMSTAT,     ex_memstat,    EX_FLAG_NONE},
     {"nmap",             EX_NMAP,        ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"nnoremap",         EX_NNOREMAP,    ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"normal",           EX_NORMAL,      ex_normal,     EX_FLAG_BANG|EX_FLAG_CMD},
     {"nunmap",           EX_NUNMAP,      ex_unmap,      EX_FLAG_LHS},
     {"open",             EX_OPEN,        ex_open,       EX_FLAG_CMD},
+    {"perf",             EX_PERF,        ex_perf,       EX_FLAG_NONE},
     {"quit",             EX_QUIT,        ex_quit,       EX_FLAG_NONE|EX_FLAG_BANG},
     {"quitall",          EX_QUITALL,     ex_quitall,    EX_FLAG_NONE|EX_FLAG_BANG},
 #ifdef FEATURE_QUEUE
@@ -223,14 +292,18 @@ static ExInfo commands[] = {
     {"shortcut-add",     EX_SCA,         ex_shortcut,   EX_FLAG_RHS},
     {"shortcut-default", EX_SCD,         ex_shortcut,   EX_FLAG_RHS},
     {"shortcut-remove",  EX_SCR,         ex_shortcut,   EX_FLAG_RHS},
+    {"site-add",         EX_SITEADD,     ex_site,       EX_FLAG_RHS},
+    {"site-remove",      EX_SITEREM,     ex_site,       EX_FLAG_RHS},
     {"source",           EX_SOURCE,      ex_source,     EX_FLAG_RHS|EX_FLAG_EXP},
     {"tabopen",          EX_TABOPEN,     ex_open,       EX_FLAG_CMD},
     {"tabclose",         EX_TABCLOSE,    ex_tabcmd,     EX_FLAG_NONE},
+    {"tabdiscard",       EX_TABDISCARD,  ex_tabcmd,     EX_FLAG_NONE},
     {"tabnext",          EX_TABNEXT,     ex_tabcmd,     EX_FLAG_NONE},
     {"tabprev",          EX_TABPREV,     ex_tabcmd,     EX_FLAG_NONE},
     {"tabprevious",      EX_TABPREV,     ex_tabcmd,     EX_FLAG_NONE},
     {"tabfirst",         EX_TABFIRST,    ex_tabcmd,     EX_FLAG_NONE},
     {"tablast",          EX_TABLAST,     ex_tabcmd,     EX_FLAG_NONE},
+    {"trace",            EX_TRACE,       ex_trace,      EX_FLAG_RHS|EX_FLAG_EXP},
 };
 
 static struct {
@@ -238,6 +311,7 @@ static struct {
     char  *prefix;  /* completion prefix like :, ? and / */
     char  *current; /* holds the current written input box content */
     char  *token;   /* initial filter content */
+    short direction; /* direction of the completion that is started */
 } excomp;
 
 static struct {
@@ -266,7 +340,7 @@ void ex_leave(Client *c)
 {
     completion_clean(c);
     hints_clear(c);
-    if (c->config.incsearch) {
+    if (c->config.settings.incsearch) {
         command_search(c, &((Arg){0, NULL}), FALSE);
     }
 }
@@ -447,6 +521,9 @@ void ex_input_changed(Client *c, const char *text)
 {
     GtkTextBuffer *buffer = c->buffer;
 
+    /* The running completion source matches an outdated input. */
+    completion_source_cancel(c);
+
     /* GTK4: Defer buffer modification to avoid iterator invalidation warning.
      * ex_input_changed() is called from the "changed" signal handler of
      * GtkTextBuffer. Modifying the buffer in the changed handler invalidates
@@ -464,7 +541,7 @@ void ex_input_changed(Client *c, const char *text)
             break;
         case '/': /* fall through */
         case '?':
-            if (c->config.incsearch) {
+            if (c->config.settings.incsearch) {
                 command_search(c, &((Arg){*text == '/' ? 1 : -1, (char*)text + 1}), FALSE);
             }
             break;
@@ -986,6 +1063,49 @@ static VbCmdResult ex_cleardata(Client *c, const ExArg *arg)
     return result;
 }
 
+/**
+ * Lists the downloads or cancels or retries the download with the id given
+ * like ':downloads cancel 3'.
+ */
+static VbCmdResult ex_downloads(Client *c, const ExArg *arg)
+{
+    char **parts;
+    guint64 id;
+    gboolean res = FALSE;
+
+    if (!arg->rhs->len) {
+        download_list(c);
+
+        return CMD_SUCCESS | CMD_KEEPINPUT;
+    }
+
+    parts = g_strsplit(arg->rhs->str, " ", 2);
+    if (parts[1]
+        && g_ascii_string_to_unsigned(g_strstrip(parts[1]), 10, 1, G_MAXUINT, &id, NULL)) {
+        if (!strcmp(parts[0], "cancel")) {
+            res = download_cancel((guint)id);
+        } else if (!strcmp(parts[0], "retry")) {
+            res = download_retry(c, (guint)id);
+        }
+    }
+    g_strfreev(parts);
+
+    return res ? CMD_SUCCESS : CMD_ERROR;
+}
+
+/**
+ * Compile the content filters or show information about the loaded ones.
+ */
+static VbCmdResult ex_filter(Client *c, const ExArg *arg)
+{
+    if (arg->code == EX_FILTERUPDATE) {
+        return user_content_filter_update(c) ? CMD_SUCCESS | CMD_KEEPINPUT : CMD_ERROR | CMD_KEEPINPUT;
+    }
+
+    user_content_filter_stats(c);
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
 /**
  * Opens the gtk print dialog.
  */
@@ -1045,6 +1165,16 @@ static VbCmdResult ex_unmap(Client *c, const ExArg *arg)
     return CMD_SUCCESS;
 }
 
+/**
+ * Show the resource budget and the memory usage.
+ */
+static VbCmdResult ex_memstat(Client *c, const ExArg *arg)
+{
+    budget_stats(c);
+
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
 static VbCmdResult ex_normal(Client *c, const ExArg *arg)
 {
     vb_enter(c, 'n');
@@ -1064,6 +1194,16 @@ static VbCmdResult ex_open(Client *c, const ExArg *arg)
     return vb_load_uri(c, &((Arg){TARGET_CURRENT, arg->rhs->str})) ? CMD_SUCCESS :CMD_ERROR;
 }
 
+/**
+ * Show the percentiles of the recorded page load times.
+ */
+static VbCmdResult ex_perf(Client *c, const ExArg *arg)
+{
+    perf_report(c);
+
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
 #ifdef FEATURE_QUEUE
 static VbCmdResult ex_queue(Client *c, const ExArg *arg)
 {
@@ -1169,90 +1309,353 @@ static VbCmdResult ex_set(Client *c, const ExArg *arg)
 
 static VbCmdResult ex_shellcmd(Client *c, const ExArg *arg)
 {
-    int status;
-    char *stdOut = NULL, *stdErr = NULL;
-    VbCmdResult res;
-    GError *error = NULL;
+    if (!*arg->rhs->str) {
+        return CMD_ERROR;
+    }
+
+    /* the commands success depends not on the return code of the called
+     * shell command, spawn errors are echoed when the command is run */
+    shell_request(c, arg);
+
+    return arg->bang ? CMD_SUCCESS : CMD_SUCCESS | CMD_KEEPINPUT;
+}
 
+static VbCmdResult ex_shellex(Client *c, const ExArg *arg)
+{
     if (!*arg->rhs->str) {
         return CMD_ERROR;
     }
 
-    update_current_selection_env_var(c);
+    shell_request(c, arg);
 
-    if (arg->bang) {
-        if (!g_spawn_command_line_async(arg->rhs->str, &error)) {
-            g_warning("Can't run '%s': %s", arg->rhs->str, error->message);
-            g_clear_error(&error);
-            res = CMD_ERROR | CMD_KEEPINPUT;
-        } else {
-            res = CMD_SUCCESS;
+    return CMD_SUCCESS;
+}
+
+/**
+ * Fetch the current selection of the page and run the shell command with
+ * VIMB_SELECTION set once it has arrived.
+ */
+static void shell_request(Client *c, const ExArg *arg)
+{
+    ShellRequest *req = g_slice_new(ShellRequest);
+
+    req->code = arg->code;
+    req->bang = arg->bang;
+    req->cmd  = g_strdup(arg->rhs->str);
+
+    async_eval(c, "getSelection().toString();", shell_request_run, req, shell_request_free);
+}
+
+static void shell_request_run(Client *c, const char *selection, gpointer data)
+{
+    ShellRequest *req = (ShellRequest*)data;
+    GError *error = NULL;
+
+    g_setenv("VIMB_SELECTION", selection ? selection : "", TRUE);
+
+    if (req->code == EX_SHELLCMD && req->bang) {
+        if (!g_spawn_command_line_async(req->cmd, &error)) {
+            vb_echo(c, MSG_ERROR, TRUE, "Can't run '%s': %s", req->cmd, error->message);
+            g_error_free(error);
         }
     } else {
-        if (!g_spawn_command_line_sync(arg->rhs->str, &stdOut, &stdErr, &status, &error)) {
-            g_warning("Can't run '%s': %s", arg->rhs->str, error->message);
-            g_clear_error(&error);
-            res = CMD_ERROR | CMD_KEEPINPUT;
-        } else {
-            /* the commands success depends not on the return code of the
-             * called shell command, so we know the result already here */
-            res = CMD_SUCCESS | CMD_KEEPINPUT;
+        shell_job_new(c, req->code, req->cmd);
+    }
+}
+
+static void shell_request_free(gpointer data)
+{
+    ShellRequest *req = (ShellRequest*)data;
+
+    g_free(req->cmd);
+    g_slice_free(ShellRequest, req);
+}
+
+/**
+ * Cancel all the running and waiting shell commands started by :shellcmd or
+ * :shellex for given client.
+ *
+ * Returns the number of cancelled commands.
+ */
+guint ex_shell_cancel(Client *c)
+{
+    GList *l, *next;
+    ShellJob *job;
+    guint count = 0;
+
+    for (l = shell.waiting.head; l; l = next) {
+        next = l->next;
+        job  = l->data;
+        if (job->c == c) {
+            g_queue_delete_link(&shell.waiting, l);
+            shell_job_free(job);
+            count++;
+        }
+    }
+    for (l = shell.running; l; l = l->next) {
+        job = l->data;
+        if (job->c == c && !g_cancellable_is_cancelled(job->cancellable)) {
+            g_subprocess_force_exit(job->proc);
+            g_cancellable_cancel(job->cancellable);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Prepare a new asynchronous shell command. The command is started at once
+ * or, if there are already SHELL_JOBS_MAX commands running, queued to be
+ * started when another one has finished.
+ */
+static gboolean shell_job_new(Client *c, ExCode code, const char *cmd)
+{
+    ShellJob *job;
+    char **argv;
+    GError *error = NULL;
+
+    if (!g_shell_parse_argv(cmd, NULL, &argv, &error)) {
+        vb_echo(c, MSG_ERROR, TRUE, "Can't run '%s': %s", cmd, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    job              = g_slice_new0(ShellJob);
+    job->c           = c;
+    job->code        = code;
+    job->argv        = argv;
+    job->cancellable = g_cancellable_new();
+    /* The launcher takes a copy of the current environment, so that
+     * VIMB_SELECTION and the like are those from the time the command was
+     * issued even if the job is started later. */
+    job->launcher    = g_subprocess_launcher_new(
+            G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_PIPE);
+
+    if (shell.count >= SHELL_JOBS_MAX) {
+        g_queue_push_tail(&shell.waiting, job);
+        vb_echo(c, MSG_NORMAL, FALSE, "Shell command queued (%u waiting)", shell.waiting.length);
+        return TRUE;
+    }
+
+    return shell_job_start(job);
+}
+
+/**
+ * Spawn the process for given job and start to read its output.
+ */
+static gboolean shell_job_start(ShellJob *job)
+{
+    GError *error = NULL;
+
+    job->proc = g_subprocess_launcher_spawnv(job->launcher,
+            (const char * const *)job->argv, &error);
+    if (!job->proc) {
+        g_warning("Can't run '%s': %s", job->argv[0], error->message);
+        if (shell_job_client_alive(job)) {
+            vb_echo(job->c, MSG_ERROR, TRUE, "Can't run '%s': %s", job->argv[0], error->message);
+        }
+        g_error_free(error);
+        shell_job_free(job);
+        return FALSE;
+    }
+
+    job->out        = g_string_new(NULL);
+    job->err        = g_string_new(NULL);
+    job->out_stream = g_data_input_stream_new(g_subprocess_get_stdout_pipe(job->proc));
+    job->err_stream = g_data_input_stream_new(g_subprocess_get_stderr_pipe(job->proc));
+    job->pending    = 3;
+
+    shell.running = g_list_prepend(shell.running, job);
+    shell.count++;
+
+    g_data_input_stream_read_line_async(job->out_stream, G_PRIORITY_DEFAULT,
+            job->cancellable, (GAsyncReadyCallback)on_shell_job_stdout, job);
+    g_data_input_stream_read_line_async(job->err_stream, G_PRIORITY_DEFAULT,
+            job->cancellable, (GAsyncReadyCallback)on_shell_job_stderr, job);
+    g_subprocess_wait_async(job->proc, NULL,
+            (GAsyncReadyCallback)on_shell_job_exited, job);
+
+    return TRUE;
+}
+
+/**
+ * Called for each line the command wrote to stdout. For :shellex the line
+ * is run as ex command, for :shellcmd the output collected so far is shown
+ * at most every SHELL_ECHO_INTERVAL milliseconds.
+ */
+static void on_shell_job_stdout(GDataInputStream *stream, GAsyncResult *res, ShellJob *job)
+{
+    char *line;
+
+    line = shell_job_read_line(stream, res);
+    if (!line) {
+        /* Show the complete output without waiting for the timeout. */
+        if (job->echo_id) {
+            g_source_remove(job->echo_id);
+            on_shell_job_echo(job);
         }
+        shell_job_done(job);
+        return;
+    }
 
-        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-            vb_echo(c, MSG_NORMAL, FALSE, "%s", stdOut);
+    if (shell_job_client_alive(job) && !job->failed) {
+        if (job->code == EX_SHELLEX) {
+            if (*line && !(ex_run_string(job->c, line, FALSE) & CMD_SUCCESS)) {
+                /* Don't run further lines after the first failed one. */
+                job->failed = TRUE;
+            }
         } else {
-            vb_echo(c, MSG_ERROR, TRUE, "[%d] %s", WEXITSTATUS(status), stdErr);
+            if (job->out->len) {
+                g_string_append_c(job->out, '\n');
+            }
+            g_string_append(job->out, line);
+            if (!job->echo_id) {
+                job->echo_id = g_timeout_add(SHELL_ECHO_INTERVAL, on_shell_job_echo, job);
+            }
         }
+    }
+    g_free(line);
+
+    g_data_input_stream_read_line_async(stream, G_PRIORITY_DEFAULT,
+            job->cancellable, (GAsyncReadyCallback)on_shell_job_stdout, job);
+}
 
-        g_free(stdOut);
-        g_free(stdErr);
+static void on_shell_job_stderr(GDataInputStream *stream, GAsyncResult *res, ShellJob *job)
+{
+    char *line;
+
+    line = shell_job_read_line(stream, res);
+    if (!line) {
+        shell_job_done(job);
+        return;
     }
 
-    return res;
+    if (job->err->len) {
+        g_string_append_c(job->err, '\n');
+    }
+    g_string_append(job->err, line);
+    g_free(line);
+
+    g_data_input_stream_read_line_async(stream, G_PRIORITY_DEFAULT,
+            job->cancellable, (GAsyncReadyCallback)on_shell_job_stderr, job);
 }
 
-static VbCmdResult ex_shellex(Client *c, const ExArg *arg)
+/**
+ * Finish reading a line of the command output. Invalid UTF-8 is replaced
+ * instead of taking it for the end of the output.
+ *
+ * Returns NULL at the end of the stream or if the stream could not be read.
+ */
+static char *shell_job_read_line(GDataInputStream *stream, GAsyncResult *res)
 {
-    int status;
-    char *stdOut = NULL, *stdErr = NULL, *ex_line = NULL;
-    VbCmdResult res;
     GError *error = NULL;
+    char *line, *valid;
 
-    if (!*arg->rhs->str) {
-        return CMD_ERROR;
+    line = g_data_input_stream_read_line_finish(stream, res, NULL, &error);
+    if (!line) {
+        if (error) {
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_warning("Can't read output of shell command: %s", error->message);
+            }
+            g_error_free(error);
+        }
+        return NULL;
     }
 
-    update_current_selection_env_var(c);
+    valid = g_utf8_make_valid(line, -1);
+    g_free(line);
 
-    if (!g_spawn_command_line_sync(arg->rhs->str, &stdOut, &stdErr, &status, &error)) {
-        g_warning("Can't run '%s': %s", arg->rhs->str, error->message);
-        g_clear_error(&error);
-        res = CMD_ERROR | CMD_KEEPINPUT;
-    } else {
-        /* the commands success depends not on the return code of the
-         * called shell command, so we know the result already here */
-        res = CMD_SUCCESS;
+    return valid;
+}
+
+/**
+ * Show the stdout of a :shellcmd collected so far.
+ */
+static gboolean on_shell_job_echo(gpointer data)
+{
+    ShellJob *job = (ShellJob*)data;
+
+    job->echo_id = 0;
+    if (shell_job_client_alive(job)) {
+        vb_echo(job->c, MSG_NORMAL, FALSE, "%s", job->out->str);
     }
 
-    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-        /* Read line by line stdOut and execute it */
-        ex_line = strtok(stdOut, "\n");
-        while (ex_line) {
-            res = ex_run_string(c, ex_line, false);
-            if (!(res & CMD_SUCCESS)) {
-                break;
-            }
-            ex_line = strtok(NULL, "\n");
+    return G_SOURCE_REMOVE;
+}
+
+static void on_shell_job_exited(GSubprocess *proc, GAsyncResult *res, ShellJob *job)
+{
+    g_subprocess_wait_finish(proc, res, NULL);
+    shell_job_done(job);
+}
+
+/**
+ * Called when the output streams are read and the process has exited. This
+ * reports errors of the command and starts the next waiting job.
+ */
+static void shell_job_done(ShellJob *job)
+{
+    int status;
+
+    if (--job->pending) {
+        return;
+    }
+
+    if (shell_job_client_alive(job)) {
+        if (g_cancellable_is_cancelled(job->cancellable)) {
+            vb_echo(job->c, MSG_NORMAL, TRUE, "Shell command cancelled");
+        } else if (g_subprocess_get_if_exited(job->proc)
+                && (status = g_subprocess_get_exit_status(job->proc))) {
+            vb_echo(job->c, MSG_ERROR, TRUE, "[%d] %s", status, job->err->str);
+        } else if (!g_subprocess_get_if_exited(job->proc)) {
+            vb_echo(job->c, MSG_ERROR, TRUE, "%s", job->err->str);
         }
-    } else {
-        vb_echo(c, MSG_ERROR, TRUE, "[%d] %s", WEXITSTATUS(status), stdErr);
     }
 
-    g_free(stdOut);
-    g_free(stdErr);
+    shell.running = g_list_remove(shell.running, job);
+    shell.count--;
+    shell_job_free(job);
 
-    return res;
+    /* start the next waiting jobs */
+    while (shell.count < SHELL_JOBS_MAX && (job = g_queue_pop_head(&shell.waiting))) {
+        shell_job_start(job);
+    }
+}
+
+static void shell_job_free(ShellJob *job)
+{
+    if (job->echo_id) {
+        g_source_remove(job->echo_id);
+    }
+    g_strfreev(job->argv);
+    g_clear_object(&job->launcher);
+    g_clear_object(&job->proc);
+    g_clear_object(&job->cancellable);
+    g_clear_object(&job->out_stream);
+    g_clear_object(&job->err_stream);
+    if (job->out) {
+        g_string_free(job->out, TRUE);
+    }
+    if (job->err) {
+        g_string_free(job->err, TRUE);
+    }
+    g_slice_free(ShellJob, job);
+}
+
+/**
+ * Check if the client that started the job was not closed in the meantime.
+ */
+static gboolean shell_job_client_alive(ShellJob *job)
+{
+    Client *c;
+
+    for (c = vb.clients; c; c = c->next) {
+        if (c == job->c) {
+            return TRUE;
+        }
+    }
+    return FALSE;
 }
 
 static VbCmdResult ex_handlers(Client *c, const ExArg *arg)
@@ -1279,6 +1682,44 @@ static VbCmdResult ex_handlers(Client *c, const ExArg *arg)
     return res ? CMD_SUCCESS : CMD_ERROR;
 }
 
+/**
+ * Drops the recorded trace events by ':trace start' or writes the events
+ * since then to a file by ':trace stop {file}'.
+ */
+static VbCmdResult ex_trace(Client *c, const ExArg *arg)
+{
+    GError *error = NULL;
+    const char *file;
+
+    if (!strcmp(arg->rhs->str, "start")) {
+        trace_start();
+        vb_echo(c, MSG_NORMAL, FALSE, "Trace started");
+
+        return CMD_SUCCESS | CMD_KEEPINPUT;
+    }
+
+    if (!g_str_has_prefix(arg->rhs->str, "stop ")) {
+        return CMD_ERROR;
+    }
+    file = arg->rhs->str + 5;
+    while (*file == ' ') {
+        file++;
+    }
+    if (!*file) {
+        return CMD_ERROR;
+    }
+
+    if (!trace_stop(file, &error)) {
+        vb_echo(c, MSG_ERROR, TRUE, "Could not write trace: %s", error->message);
+        g_error_free(error);
+
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+    vb_echo(c, MSG_NORMAL, FALSE, "Trace written to %s", file);
+
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
 static VbCmdResult ex_shortcut(Client *c, const ExArg *arg)
 {
     gchar *uri;
@@ -1319,13 +1760,48 @@ static VbCmdResult ex_shortcut(Client *c, const ExArg *arg)
     return success ? CMD_SUCCESS : CMD_ERROR;
 }
 
+/**
+ * Add a setting to the profile of a host by ':site-add {host} {name}={value}'
+ * or remove the profile by ':site-remove {host}'.
+ */
+static VbCmdResult ex_site(Client *c, const ExArg *arg)
+{
+    char *name, *value;
+    gboolean success = FALSE;
+
+    g_strstrip(arg->rhs->str);
+    if (!*arg->rhs->str) {
+        return CMD_ERROR;
+    }
+
+    switch (arg->code) {
+        case EX_SITEADD:
+            if ((name = strpbrk(arg->rhs->str, " \t")) && (value = strchr(name, '='))) {
+                *name++ = '\0'; /* devide host and setting */
+                *value++ = '\0';
+                success = site_add(c, arg->rhs->str, g_strstrip(name), value);
+            }
+            break;
+
+        case EX_SITEREM:
+            success = site_remove(arg->rhs->str);
+            break;
+
+        default:
+            break;
+    }
+
+    return success ? CMD_SUCCESS : CMD_ERROR;
+}
+
 static VbCmdResult ex_source(Client *c, const ExArg *arg)
 {
     return ex_run_file(c, arg->rhs->str);
 }
 
 /**
- * Handle tab management commands: tabclose, tabnext, tabprev, tabfirst, tablast
+ * Handle tab management commands: tabclose, tabdiscard, tabnext, tabprev,
+ * tabfirst, tablast
  */
 static VbCmdResult ex_tabcmd(Client *c, const ExArg *arg)
 {
@@ -1334,6 +1810,10 @@ static VbCmdResult ex_tabcmd(Client *c, const ExArg *arg)
             vb_tab_close(c);
             return CMD_SUCCESS;
 
+        case EX_TABDISCARD:
+            vb_echo(c, MSG_NORMAL, FALSE, "%u tabs discarded", vb_tab_discard_all());
+            return CMD_SUCCESS|CMD_KEEPINPUT;
+
         case EX_TABNEXT:
             vb_tab_next();
             return CMD_SUCCESS;
@@ -1355,19 +1835,6 @@ static VbCmdResult ex_tabcmd(Client *c, const ExArg *arg)
     }
 }
 
-static void update_current_selection_env_var(Client *c)
-{
-    char *selection = NULL;
-
-    selection = ext_proxy_get_current_selection(c);
-    if (selection) {
-        g_setenv("VIMB_SELECTION", selection, TRUE);
-        g_free(selection);
-    } else {
-        g_setenv("VIMB_SELECTION", "", TRUE);
-    }
-}
-
 /**
  * Manage the generation and stepping through completions.
  * This function prepared some prefix and suffix string that are required to
@@ -1389,9 +1856,9 @@ static gboolean complete(Client *c, short direction)
     char *input;            /* input read from inputbox */
     const char *in;         /* pointer to input that we move */
     gboolean found = FALSE;
-    gboolean sort  = TRUE;
     GListStore *store;
 
+    trace_begin("complete");
     input = vb_input_get_text(c);
     /* if completion was already started move to the next/prev item */
     if (c->mode->flags & FLAG_COMPLETION) {
@@ -1402,6 +1869,7 @@ static gboolean complete(Client *c, short direction)
                 completion_select(c, excomp.token);
             }
             g_free(input);
+            trace_end("complete");
 
             return TRUE;
         }
@@ -1411,6 +1879,9 @@ static gboolean complete(Client *c, short direction)
         completion_clean(c);
     }
 
+    /* Stop filling the store of a former completion. */
+    completion_source_cancel(c);
+    excomp.direction = direction;
     store = completion_store_new();
 
     in = (const char*)input;
@@ -1461,11 +1932,10 @@ static gboolean complete(Client *c, short direction)
                 case EX_TABOPEN:
                 case EX_QPUSH:
                 case EX_QUNSHIFT:
-                    sort = FALSE;
                     if (*token == '!') {
-                        found = bookmark_fill_completion(store, token + 1);
+                        bookmark_fill_completion_async(c, store, token + 1, complete_update);
                     } else {
-                        found = history_fill_completion(store, HISTORY_URL, token);
+                        history_fill_completion_async(c, store, HISTORY_URL, token, complete_update);
                     }
                     break;
 
@@ -1474,12 +1944,11 @@ static gboolean complete(Client *c, short direction)
                     break;
 
                 case EX_BMA:
-                    found = bookmark_fill_tag_completion(store, token);
+                    bookmark_fill_tag_completion_async(c, store, token, complete_update);
                     break;
 
                 case EX_BMR:
-                    sort  = FALSE;
-                    found = bookmark_fill_completion(store, token);
+                    bookmark_fill_completion_async(c, store, token, complete_update);
                     break;
 
                 case EX_SCR: /* Fallthrough */
@@ -1493,7 +1962,7 @@ static gboolean complete(Client *c, short direction)
 
                 case EX_SAVE: /* Fallthrough */
                 case EX_SOURCE:
-                    found = util_filename_fill_completion(store, token);
+                    found = dircache_fill_completion(c, store, token, complete_update);
                     break;
 
 #ifdef FEATURE_AUTOCMD
@@ -1526,29 +1995,55 @@ static gboolean complete(Client *c, short direction)
         }
         free_cmdarg(arg);
     } else if (*in == '/' || *in == '?') {
-        if (history_fill_completion(store, HISTORY_SEARCH, in + 1)) {
-            OVERWRITE_STRING(excomp.token, in + 1);
-            OVERWRITE_NSTRING(excomp.prefix, in, 1);
-            found = TRUE;
-            sort  = FALSE;
-        }
-    }
-
-    /* if the input could be parsed and the list store could be filled */
-    if (sort) {
-        g_list_store_sort(store, completion_item_compare, NULL);
+        OVERWRITE_STRING(excomp.token, in + 1);
+        OVERWRITE_NSTRING(excomp.prefix, in, 1);
+        history_fill_completion_async(c, store, HISTORY_SEARCH, in + 1, complete_update);
     }
 
+    /* if the input could be parsed and the list store could be filled,
+     * sources running in the background show their items by
+     * complete_update() */
     if (found) {
+        g_list_store_sort(store, completion_item_compare, NULL);
         completion_create(c, store, completion_select, direction < 0);
     } else {
         g_object_unref(store);
     }
 
     g_free(input);
+    trace_end("complete");
     return TRUE;
 }
 
+/**
+ * Called by completion sources running in the background and by the
+ * directory cache if items were added to the store after the completion was
+ * started. The completion is shown once it's clear that there is more than
+ * one match, as long as the input has not been changed since.
+ */
+static void complete_update(Client *c, GListStore *store, gboolean done)
+{
+    char *input, *expected;
+    guint n_items;
+
+    /* The list view shows the new items by itself. */
+    if (c->mode->flags & FLAG_COMPLETION) {
+        return;
+    }
+
+    n_items = g_list_model_get_n_items(G_LIST_MODEL(store));
+    if (n_items > 1 || (done && n_items == 1)) {
+        input    = vb_input_get_text(c);
+        expected = g_strconcat(excomp.prefix, excomp.token, NULL);
+        if (c->mode->id == 'c' && !strcmp(input, expected)) {
+            completion_create(c, g_object_ref(store), completion_select,
+                    excomp.direction < 0);
+        }
+        g_free(expected);
+        g_free(input);
+    }
+}
+
 /**
  * Callback called from the completion if a item is selected to write the
  * matched item according with previously saved prefix and command name to the
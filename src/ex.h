@@ -30,5 +30,6 @@ void ex_input_changed(Client *c, const char *text);
 gboolean ex_fill_completion(GListStore *store, const char *input);
 VbCmdResult ex_run_file(Client *c, const char *filename);
 VbCmdResult ex_run_string(Client *c, const char *input, gboolean enable_history);
+guint ex_shell_cancel(Client *c);
 
 #endif /* end of include guard: _EX_H */
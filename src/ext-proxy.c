@@ -19,16 +19,24 @@
 
 #include <gio/gio.h>
 #include <glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
 
 #include "ext-proxy.h"
 #include "main.h"
+#include "trace.h"
 #include "webextension/ext-main.h"
 
 /* WebKitGTK 6.0: D-Bus infrastructure completely removed.
  * All IPC now uses WebKitUserMessage API. */
 
+static void header_init_data_update(void);
+
 extern struct Vimb vb;
 
+/* Maps each client to the header rules compiled from its header setting. */
+static GHashTable *header_rules = NULL;
+
 /**
  * Initialize web extension communication.
  * WebKitGTK 6.0: D-Bus has been replaced with WebKitUserMessage.
@@ -51,6 +59,7 @@ void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback)
 {
     WebKitUserMessage *message;
 
+    trace_instant("ext_proxy_eval_script");
     if (callback) {
         /* With callback - wait for response */
         message = webkit_user_message_new("EvalJs", g_variant_new("(s)", js));
@@ -62,6 +71,20 @@ void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback)
     }
 }
 
+/**
+ * Evaluate JavaScript like ext_proxy_eval_script() but with own user data for
+ * the callback, which gets the "(bs)" reply of the webextension.
+ */
+void ext_proxy_eval_script_full(Client *c, const char *js, GCancellable *cancellable,
+        GAsyncReadyCallback callback, gpointer data)
+{
+    WebKitUserMessage *message;
+
+    trace_instant("ext_proxy_eval_script");
+    message = webkit_user_message_new("EvalJs", g_variant_new("(s)", js));
+    webkit_web_view_send_message_to_page(c->webview, message, cancellable, callback, data);
+}
+
 /* Data structure for synchronous evaluation */
 typedef struct {
     GVariant *result;
@@ -96,7 +119,9 @@ static void on_sync_eval_finished(GObject *source_object, GAsyncResult *result,
 /**
  * Evaluate JavaScript synchronously using WebKitUserMessage.
  * WebKitGTK 6.0: Replaces D-Bus EvalJs method.
- * Uses GLib main loop iteration to wait for the async result.
+ * Uses GLib main loop iteration to wait for the async result. This is only
+ * used by the hint key handling, whose result decides how the current key is
+ * handled. Other commands use async_eval() and continue in a continuation.
  */
 GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
 {
@@ -106,6 +131,7 @@ GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
 
     g_return_val_if_fail(c != NULL && c->webview != NULL, NULL);
 
+    trace_begin("ext_proxy_eval_script_sync");
     message = webkit_user_message_new("EvalJs", g_variant_new("(s)", js));
     webkit_web_view_send_message_to_page(c->webview, message, NULL,
         on_sync_eval_finished, &data);
@@ -115,6 +141,7 @@ GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
     while (!data.done) {
         g_main_context_iteration(context, TRUE);
     }
+    trace_end("ext_proxy_eval_script_sync");
 
     return data.result;
 }
@@ -148,14 +175,128 @@ void ext_proxy_focus_input(Client *c)
     webkit_web_view_send_message_to_page(c->webview, message, NULL, NULL, NULL);
 }
 
+/**
+ * Compile the header setting into the rules used by the webextension.
+ *
+ * The elements of the list have the form [host:]name[=[value]]. The rules
+ * are grouped by the lowercased host, rules without host are stored with
+ * the empty string as key. A missing value means that the header is removed
+ * from the request. Returns a floating reference.
+ */
+GVariant *ext_proxy_compile_header_rules(const char *headers)
+{
+    GHashTable *params, *hosts;
+    GHashTableIter iter;
+    GVariantBuilder builder;
+    GVariantBuilder *actions;
+    const char *param, *value, *sep;
+    char *host;
+
+    hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)g_variant_builder_unref);
+
+    if (headers && *headers) {
+        params = soup_header_parse_param_list(headers);
+        g_hash_table_iter_init(&iter, params);
+        while (g_hash_table_iter_next(&iter, (gpointer*)&param, (gpointer*)&value)) {
+            /* Header names can't contain ':' so it's save to use this as
+             * separator between the host and the header name. */
+            if ((sep = strchr(param, ':'))) {
+                host  = g_ascii_strdown(param, sep - param);
+                param = sep + 1;
+            } else {
+                host = g_strdup("");
+            }
+            if (!*param) {
+                g_free(host);
+                continue;
+            }
+            if (!(actions = g_hash_table_lookup(hosts, host))) {
+                actions = g_variant_builder_new(G_VARIANT_TYPE("a(sms)"));
+                g_hash_table_insert(hosts, host, actions);
+            } else {
+                g_free(host);
+            }
+            g_variant_builder_add(actions, "(sms)", param, value);
+        }
+        soup_header_free_param_list(params);
+    }
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE(VB_HEADER_RULES_TYPE));
+    g_hash_table_iter_init(&iter, hosts);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&host, (gpointer*)&actions)) {
+        g_variant_builder_add(&builder, "{sa(sms)}", host, actions);
+    }
+    g_hash_table_destroy(hosts);
+
+    return g_variant_builder_end(&builder);
+}
+
 /**
  * Set headers using WebKitUserMessage.
  * WebKitGTK 6.0: Replaces D-Bus SetHeaderSetting method.
+ *
+ * The rules are compiled once here and sent to the webextension, that only
+ * has to lookup the actions for the host of each request.
  */
 void ext_proxy_set_header(Client *c, const char *headers)
 {
-    /* Headers are now set via WebKitWebContext, not per-page.
-     * This function is deprecated but kept for compatibility. */
+    WebKitUserMessage *message;
+    GVariant *rules;
+
+    rules = g_variant_ref_sink(ext_proxy_compile_header_rules(headers));
+
+    if (!header_rules) {
+        header_rules = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)g_variant_unref);
+    }
+    g_hash_table_insert(header_rules, c, g_variant_ref(rules));
+    header_init_data_update();
+
+    if (c->webview) {
+        message = webkit_user_message_new("SetHeaderSetting", g_variant_new("(@" VB_HEADER_RULES_TYPE ")", rules));
+        webkit_web_view_send_message_to_page(c->webview, message, NULL, NULL, NULL);
+    }
+
+    g_variant_unref(rules);
+}
+
+/**
+ * Forget the header rules of a client that is closed.
+ */
+void ext_proxy_client_remove(Client *c)
+{
+    if (header_rules && g_hash_table_remove(header_rules, c)) {
+        header_init_data_update();
+        if (!g_hash_table_size(header_rules)) {
+            g_clear_pointer(&header_rules, g_hash_table_destroy);
+        }
+    }
+}
+
+/**
+ * Web processes started later on get the rules of all tabs keyed by page id
+ * with the initialization data, because messages can't reach a page before
+ * its process runs.
+ */
+static void header_init_data_update(void)
+{
+    GVariantBuilder builder;
+    GHashTableIter iter;
+    GVariant *rules;
+    Client *c;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE(VB_PAGE_HEADER_RULES_TYPE));
+    if (header_rules) {
+        g_hash_table_iter_init(&iter, header_rules);
+        while (g_hash_table_iter_next(&iter, (gpointer*)&c, (gpointer*)&rules)) {
+            if (c->webview && g_variant_n_children(rules)) {
+                g_variant_builder_add(&builder, "{t@" VB_HEADER_RULES_TYPE "}", c->page_id, rules);
+            }
+        }
+    }
+    webkit_web_context_set_web_process_extensions_initialization_user_data(
+            vb.webcontext, g_variant_new("(@" VB_PAGE_HEADER_RULES_TYPE ")", g_variant_builder_end(&builder)));
 }
 
 /**
@@ -186,36 +327,4 @@ void ext_proxy_unlock_input(Client *c, const char *element_id)
     webkit_web_view_send_message_to_page(c->webview, message, NULL, NULL, NULL);
 }
 
-/**
- * Returns the current selection if there is one as newly allocates string.
- *
- * Result must be freed by caller with g_free.
- */
-char *ext_proxy_get_current_selection(Client *c)
-{
-    char *selection, *js;
-    gboolean success;
-    GVariant *jsreturn;
-
-    js       = g_strdup_printf("getSelection().toString();");
-    jsreturn = ext_proxy_eval_script_sync(c, js);
-    g_free(js);
-
-    if (jsreturn == NULL) {
-        g_warning("cannot get current selection: failed to evaluate js");
-        return NULL;
-    }
-
-    g_variant_get(jsreturn, "(bs)", &success, &selection);
-    g_variant_unref(jsreturn);
-
-    if (!success) {
-        g_warning("can not get current selection: %s", selection);
-        g_free(selection);
-        return NULL;
-    }
-
-    return selection;
-}
-
 /* WebKitGTK 6.0: All D-Bus functions removed - using WebKitUserMessage */
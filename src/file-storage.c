@@ -61,6 +61,24 @@ FileStorage *file_storage_new(const char *dir, const char *filename, gboolean re
     return storage;
 }
 
+/**
+ * Create a copy of the file storage that can be read on another thread. Data
+ * appended to the original read only storage later is not in the copy.
+ *
+ * The returned FileStorage must be freed by file_storage_free().
+ */
+FileStorage *file_storage_copy(FileStorage *storage)
+{
+    FileStorage *copy;
+
+    copy            = g_slice_new(FileStorage);
+    copy->readonly  = storage->readonly;
+    copy->file_path = g_strdup(storage->file_path);
+    copy->str       = storage->str ? g_string_new_len(storage->str->str, storage->str->len) : NULL;
+
+    return copy;
+}
+
 /**
  * Free memory for given file storage.
  */
@@ -24,6 +24,7 @@
 
 typedef struct filestorage FileStorage;
 FileStorage *file_storage_new(const char *dir, const char *filename, int mode);
+FileStorage *file_storage_copy(FileStorage *storage);
 void file_storage_free(FileStorage *storage);
 gboolean file_storage_append(FileStorage *storage, const char *format, ...);
 char **file_storage_get_lines(FileStorage *storage);
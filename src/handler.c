@@ -29,7 +29,7 @@ struct handler {
     GHashTable *table;  /* holds the protocol handlers */
 };
 
-static char *handler_lookup(Handler *h, const char *uri);
+static char *handler_lookup(Handler *h, const char *scheme);
 
 Handler *handler_new(void)
 {
@@ -61,12 +61,21 @@ gboolean handler_remove(Handler *h, const char *key)
 }
 
 gboolean handler_handle_uri(Handler *h, const char *uri)
+{
+    return handler_handle_scheme(h, g_uri_peek_scheme(uri), uri);
+}
+
+/**
+ * Like handler_handle_uri() for callers that have the lower case scheme of
+ * the uri at hand already.
+ */
+gboolean handler_handle_scheme(Handler *h, const char *scheme, const char *uri)
 {
     char *handler, *cmd;
     GError *error = NULL;
     gboolean res;
 
-    if (!(handler = handler_lookup(h, uri))) {
+    if (!(handler = handler_lookup(h, scheme))) {
         return FALSE;
     }
 
@@ -92,15 +101,11 @@ gboolean handler_fill_completion(Handler *h, GListStore *store, const char *inpu
     return found;
 }
 
-static char *handler_lookup(Handler *h, const char *uri)
+static char *handler_lookup(Handler *h, const char *scheme)
 {
-    char *p, *schema, *handler = NULL;
-
-    if ((p = strchr(uri, ':'))) {
-        schema  = g_strndup(uri, p - uri);
-        handler = g_hash_table_lookup(h->table, schema);
-        g_free(schema);
+    if (!scheme || !g_hash_table_size(h->table)) {
+        return NULL;
     }
 
-    return handler;
+    return g_hash_table_lookup(h->table, scheme);
 }
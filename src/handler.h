@@ -27,6 +27,7 @@ void handler_free(Handler *h);
 gboolean handler_add(Handler *h, const char *key, const char *cmd);
 gboolean handler_remove(Handler *h, const char *key);
 gboolean handler_handle_uri(Handler *h, const char *uri);
+gboolean handler_handle_scheme(Handler *h, const char *scheme, const char *uri);
 gboolean handler_fill_completion(Handler *h, GListStore *store, const char *input);
 
 #endif /* end of include guard: _HANDLERS_H */
@@ -172,9 +172,9 @@ void hints_create(Client *c, const char *input)
             (char[]){hints.mode, '\0'},
             hints.gmode ? "true" : "false",
             MAXIMUM_HINTS,
-            GET_CHAR(c, "hint-keys"),
-            GET_BOOL(c, "hint-follow-last") ? "true" : "false",
-            GET_BOOL(c, "hint-keys-same-length") ? "true" : "false"
+            c->config.settings.hint_keys,
+            c->config.settings.hint_follow_last ? "true" : "false",
+            c->config.settings.hint_keys_same_length ? "true" : "false"
         );
 
         call_hints_function(c, "init", jsargs, FALSE);
@@ -185,7 +185,7 @@ void hints_create(Client *c, const char *input)
         return;
     }
 
-    if (GET_BOOL(c, "hint-match-element")) {
+    if (c->config.settings.hint_match_element) {
         jsargs = g_strdup_printf("'%s'", *(input + hints.promptlen) ? input + hints.promptlen : "");
         call_hints_function(c, "filter", jsargs, FALSE);
         g_free(jsargs);
@@ -421,7 +421,7 @@ static gboolean hint_function_check_result(Client *c, GVariant *return_value)
                 break;
 
             case 'x':
-                map_handle_string(c, GET_CHAR(c, "x-hint-command"), TRUE);
+                map_handle_string(c, c->config.settings.x_hint_command, TRUE);
                 break;
 
             case 'y':
@@ -461,7 +461,7 @@ static void fire_timeout(Client *c, gboolean on)
     }
 
     if (on) {
-        millis = GET_INT(c, "hint-timeout");
+        millis = c->config.settings.hint_timeout;
         if (millis) {
             hints.timeout_id = g_timeout_add(millis, (GSourceFunc)fire_cb, c);
         }
@@ -26,6 +26,7 @@
 #include "config.h"
 #include "history.h"
 #include "main.h"
+#include "trace.h"
 #include "util.h"
 #include "file-storage.h"
 
@@ -35,6 +36,18 @@ typedef struct {
     char *second;
 } History;
 
+/* History to match on a worker thread. */
+typedef struct {
+    FileStorage *storage;   /* copy of the history storage */
+    HistoryType type;
+    guint       max;
+} HistoryQuery;
+
+static gboolean fill_completion(GList *src, HistoryType type, const char *input,
+        CompletionAddFunc add, gpointer target);
+static void query_run(const char *input, HistoryQuery *query,
+        CompletionAddFunc add, gpointer target);
+static void query_free(HistoryQuery *query);
 static gboolean history_item_contains_all_tags(History *item, char **query, guint qlen);
 static void free_history(History *item);
 static History *line_to_history(const char *uri, const char *title);
@@ -95,53 +108,37 @@ void history_cleanup(void)
 
 gboolean history_fill_completion(GListStore *store, HistoryType type, const char *input)
 {
-    char **parts;
-    unsigned int len;
-    gboolean found = FALSE;
-    GList *src = NULL;
-    History *item;
-
-    src = load(HIST_STORAGE(type));
-    src = g_list_reverse(src);
-    if (!input || !*input) {
-        /* without any tags return all items */
-        for (GList *l = src; l; l = l->next) {
-            item = l->data;
-            CompletionItem *ci = completion_item_new(item->first, item->second);
-            g_list_store_append(store, ci);
-            g_object_unref(ci);
-            found = TRUE;
-        }
-    } else if (HISTORY_URL == type) {
-        parts = g_strsplit(input, " ", 0);
-        len   = g_strv_length(parts);
+    gboolean found;
+    GList *src;
 
-        for (GList *l = src; l; l = l->next) {
-            item = l->data;
-            if (history_item_contains_all_tags(item, parts, len)) {
-                CompletionItem *ci = completion_item_new(item->first, item->second);
-                g_list_store_append(store, ci);
-                g_object_unref(ci);
-                found = TRUE;
-            }
-        }
-        g_strfreev(parts);
-    } else {
-        for (GList *l = src; l; l = l->next) {
-            item = l->data;
-            if (g_str_has_prefix(item->first, input)) {
-                CompletionItem *ci = completion_item_new(item->first, item->second);
-                g_list_store_append(store, ci);
-                g_object_unref(ci);
-                found = TRUE;
-            }
-        }
-    }
+    trace_begin("history_fill_completion");
+    src   = load(HIST_STORAGE(type));
+    found = fill_completion(src, type, input, completion_store_add, store);
     g_list_free_full(src, (GDestroyNotify)free_history);
+    trace_end("history_fill_completion");
 
     return found;
 }
 
+/**
+ * Fills the store like history_fill_completion() but reads and matches the
+ * history on a worker thread. The store is filled in chunks and update is
+ * called for each of them.
+ */
+void history_fill_completion_async(Client *c, GListStore *store, HistoryType type,
+        const char *input, CompletionUpdateFunc update)
+{
+    HistoryQuery *query = g_slice_new(HistoryQuery);
+
+    /* Work on a copy so that entries added meanwhile don't matter. */
+    query->storage = file_storage_copy(HIST_STORAGE(type));
+    query->type    = type;
+    query->max     = vb.config.history_max;
+
+    completion_source_start(c, store, input, (CompletionSourceFunc)query_run,
+            query, (GDestroyNotify)query_free, update);
+}
+
 /**
  * Retrieves the list of matching history items.
  * The list must be freed.
@@ -181,6 +178,61 @@ GList *history_get_list(VbInputType type, const char *query)
     return result;
 }
 
+/**
+ * Adds the items of src matching the input. The items are added from the
+ * newest to the oldest until the add function refuses further items.
+ */
+static gboolean fill_completion(GList *src, HistoryType type, const char *input,
+        CompletionAddFunc add, gpointer target)
+{
+    char **parts = NULL;
+    unsigned int len = 0;
+    gboolean found = FALSE;
+    History *item;
+
+    if (input && *input && HISTORY_URL == type) {
+        parts = g_strsplit(input, " ", 0);
+        len   = g_strv_length(parts);
+    }
+
+    for (GList *l = g_list_last(src); l; l = l->prev) {
+        item = l->data;
+        if (parts) {
+            if (!history_item_contains_all_tags(item, parts, len)) {
+                continue;
+            }
+        } else if (input && *input && !g_str_has_prefix(item->first, input)) {
+            continue;
+        }
+        found = TRUE;
+        if (!add(target, item->first, item->second)) {
+            break;
+        }
+    }
+    g_strfreev(parts);
+
+    return found;
+}
+
+static void query_run(const char *input, HistoryQuery *query,
+        CompletionAddFunc add, gpointer target)
+{
+    char **lines;
+    GList *src;
+
+    lines = file_storage_get_lines(query->storage);
+    src   = util_strv_to_unique_list(lines, (Util_Content_Func)line_to_history, query->max);
+    fill_completion(src, query->type, input, add, target);
+    g_list_free_full(src, (GDestroyNotify)free_history);
+    g_strfreev(lines);
+}
+
+static void query_free(HistoryQuery *query)
+{
+    file_storage_free(query->storage);
+    g_slice_free(HistoryQuery, query);
+}
+
 /**
  * Checks if the given array of tags are all found in history item.
  */
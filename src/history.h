@@ -22,6 +22,7 @@
 
 #include <glib.h>
 
+#include "completion.h"
 #include "main.h"
 
 typedef enum {
@@ -35,6 +36,8 @@ typedef enum {
 void history_add(Client *c, HistoryType type, const char *value, const char *additional);
 void history_cleanup(void);
 gboolean history_fill_completion(GListStore *store, HistoryType type, const char *input);
+void history_fill_completion_async(Client *c, GListStore *store, HistoryType type,
+        const char *input, CompletionUpdateFunc update);
 GList *history_get_list(VbInputType type, const char *query);
 
 #endif /* end of include guard: _HISTORY_H */
@@ -22,6 +22,7 @@
 #include <string.h>
 
 #include "ascii.h"
+#include "async.h"
 #include "command.h"
 #include "config.h"
 #include "input.h"
@@ -36,8 +37,11 @@ typedef struct {
     unsigned long element_map_key;
 } ElementEditorData;
 
+static void input_editor_spawn(Client *c, const char *result, gpointer data);
 static void input_editor_formfiller(const char *text, Client *c, gpointer data);
 
+static unsigned long element_map_key = 0;
+
 /**
  * Function called when vimb enters the input mode.
  */
@@ -111,63 +115,50 @@ VbResult input_keypress(Client *c, int key)
 
 VbResult input_open_editor(Client *c)
 {
-    static unsigned long element_map_key = 0;
-    char *element_id = NULL;
-    char *text = NULL, *id = NULL;
-    gboolean success;
-    GVariant *jsreturn;
-    GVariant *idreturn;
-    ElementEditorData *data = NULL;
-    VbResult result = RESULT_ERROR;
-
     g_assert(c);
 
-    /* get the selected input element */
-    jsreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.value");
-    if (!jsreturn) {
-        return RESULT_ERROR;
-    }
-    g_variant_get(jsreturn, "(bs)", &success, &text);
-    g_variant_unref(jsreturn);
+    /* get the id and the value of the selected input element at once, the
+     * editor is spawned when the result arrives */
+    async_eval(c, "vimb_input_mode_element.id + '\\n' + vimb_input_mode_element.value;",
+        input_editor_spawn, NULL, NULL);
 
-    if (!success || !text) {
-        g_free(text);
-        return RESULT_ERROR;
-    }
+    return RESULT_COMPLETE;
+}
 
-    idreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.id");
-    if (!idreturn) {
-        g_free(text);
-        return RESULT_ERROR;
+/**
+ * Spawns the editor for the input element value given as "id\nvalue".
+ */
+static void input_editor_spawn(Client *c, const char *result, gpointer data)
+{
+    char *element_id = NULL;
+    const char *text;
+    ElementEditorData *editor;
+
+    if (!result || !(text = strchr(result, '\n'))) {
+        return;
     }
-    g_variant_get(idreturn, "(bs)", &success, &id);
-    g_variant_unref(idreturn);
 
     /* Special case: the input element does not have an id assigned to it */
-    if (!success || !*id) {
+    if (text == result) {
         char *js_command = g_strdup_printf(JS_SET_EDITOR_MAP_ELEMENT, ++element_map_key);
         ext_proxy_eval_script(c, js_command, NULL);
         g_free(js_command);
     } else {
-        element_id = g_strdup(id);
+        element_id = g_strndup(result, text - result);
     }
+    text++;
 
-    data                    = g_slice_new0(ElementEditorData);
-    data->element_id        = element_id;
-    data->element_map_key   = element_map_key;
+    editor                  = g_slice_new0(ElementEditorData);
+    editor->element_id      = element_id;
+    editor->element_map_key = element_map_key;
 
-    if (command_spawn_editor(c, &((Arg){0, text}), input_editor_formfiller, data)) {
+    if (command_spawn_editor(c, &((Arg){0, (char*)text}), input_editor_formfiller, editor)) {
         /* disable the active element */
         ext_proxy_lock_input(c, element_id);
-        result = RESULT_COMPLETE;
     } else {
         g_free(element_id);
-        g_slice_free(ElementEditorData, data);
+        g_slice_free(ElementEditorData, editor);
     }
-
-    g_free(text);
-    g_free(id);
-    return result;
 }
 
 static void input_editor_formfiller(const char *text, Client *c, gpointer data)
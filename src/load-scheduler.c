@@ -0,0 +1,225 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+
+#include "config.h"
+#include "main.h"
+#include "load-scheduler.h"
+
+extern struct Vimb vb;
+
+/* A load of a tab that waits for a free slot. */
+typedef struct {
+    Client  *c;
+    char    *uri;
+} LoadJob;
+
+static struct {
+    GQueue  waiting;    /* LoadJob in order of their request */
+    GSList  *running;   /* clients whose scheduled load is not finished */
+    guint   dispatch;   /* idle source to start waiting loads */
+} ls = {G_QUEUE_INIT, NULL, 0};
+
+static gboolean dispatch(gpointer data);
+static void dispatch_schedule(void);
+static GList *job_find(Client *c);
+static void job_start(GList *link);
+static void job_free(LoadJob *job);
+static void statusbar_update(void);
+
+
+/**
+ * Request to load the uri into the tab of the client. The load is started
+ * from the main loop, the visible tab at once and all other tabs as soon as
+ * less than LOAD_JOBS_MAX scheduled loads are running.
+ */
+void load_scheduler_request(Client *c, const char *uri)
+{
+    GList *link;
+    LoadJob *job;
+
+    /* The tab shows the uri, also in the session, while it waits. */
+    if (c->state.uri != uri) {
+        g_free(c->state.uri);
+        c->state.uri = g_strdup(uri);
+    }
+
+    /* A newer request for the same tab replaces the waiting one. */
+    if ((link = job_find(c))) {
+        job = link->data;
+        g_free(job->uri);
+        job->uri = g_strdup(uri);
+    } else {
+        job      = g_slice_new(LoadJob);
+        job->c   = c;
+        job->uri = g_strdup(uri);
+        g_queue_push_tail(&ls.waiting, job);
+    }
+
+    dispatch_schedule();
+}
+
+/**
+ * Start the waiting load of the client immediately. Called if the tab
+ * becomes the visible one.
+ */
+void load_scheduler_activate(Client *c)
+{
+    GList *link;
+
+    if ((link = job_find(c))) {
+        job_start(link);
+        statusbar_update();
+    }
+}
+
+/**
+ * Called if the load of the client is finished or failed to free the slot
+ * for the next waiting load.
+ */
+void load_scheduler_finished(Client *c)
+{
+    GSList *link;
+
+    if ((link = g_slist_find(ls.running, c))) {
+        ls.running = g_slist_delete_link(ls.running, link);
+        dispatch_schedule();
+    }
+}
+
+/**
+ * Forget about all loads of the client, used if the tab is closed.
+ */
+void load_scheduler_remove(Client *c)
+{
+    GList *link;
+
+    if ((link = job_find(c))) {
+        job_free(link->data);
+        g_queue_delete_link(&ls.waiting, link);
+    }
+    load_scheduler_finished(c);
+}
+
+/**
+ * Check if the client has a load waiting for a free slot.
+ */
+gboolean load_scheduler_is_queued(Client *c)
+{
+    return job_find(c) != NULL;
+}
+
+/**
+ * Returns the number of loads waiting for a free slot.
+ */
+guint load_scheduler_queued(void)
+{
+    return g_queue_get_length(&ls.waiting);
+}
+
+void load_scheduler_cleanup(void)
+{
+    if (ls.dispatch) {
+        g_source_remove(ls.dispatch);
+        ls.dispatch = 0;
+    }
+    g_queue_clear_full(&ls.waiting, (GDestroyNotify)job_free);
+    g_slist_free(ls.running);
+    ls.running = NULL;
+}
+
+/**
+ * Start the waiting loads. The visible tab gets priority and is started even
+ * if all the slots are in use.
+ */
+static gboolean dispatch(gpointer data)
+{
+    Client *current;
+    GList *link;
+
+    ls.dispatch = 0;
+
+    current = vb_get_current_client();
+    if (current && (link = job_find(current))) {
+        job_start(link);
+    }
+    while (g_slist_length(ls.running) < LOAD_JOBS_MAX && ls.waiting.head) {
+        job_start(ls.waiting.head);
+    }
+    statusbar_update();
+
+    return G_SOURCE_REMOVE;
+}
+
+static void dispatch_schedule(void)
+{
+    if (!ls.dispatch) {
+        ls.dispatch = g_idle_add(dispatch, NULL);
+    }
+}
+
+static GList *job_find(Client *c)
+{
+    for (GList *l = ls.waiting.head; l; l = l->next) {
+        if (((LoadJob*)l->data)->c == c) {
+            return l;
+        }
+    }
+    return NULL;
+}
+
+static void job_start(GList *link)
+{
+    LoadJob *job = link->data;
+    Client *c    = job->c;
+
+    g_queue_delete_link(&ls.waiting, link);
+    if (c->webview) {
+        webkit_web_view_load_uri(c->webview, job->uri);
+        if (!g_slist_find(ls.running, c)) {
+            ls.running = g_slist_prepend(ls.running, c);
+        }
+    } else {
+        /* A discarded tab loads the uri once it is restored, this does not
+         * take a slot. */
+        g_free(c->state.uri);
+        c->state.uri = g_strdup(job->uri);
+        vb_tab_load_on_restore(c);
+    }
+    job_free(job);
+}
+
+static void job_free(LoadJob *job)
+{
+    g_free(job->uri);
+    g_slice_free(LoadJob, job);
+}
+
+/**
+ * Show the changed queue depth in the statusbar of the visible tab.
+ */
+static void statusbar_update(void)
+{
+    Client *c = vb_get_current_client();
+
+    if (c) {
+        vb_statusbar_update(c);
+    }
+}
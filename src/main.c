@@ -28,6 +28,7 @@
 /* #endif */
 #include <libsoup/soup.h>
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -38,22 +39,36 @@
 
 #include "../version.h"
 #include "ascii.h"
+#include "async.h"
+#include "bench-load.h"
+#include "budget.h"
 #include "command.h"
 #include "completion.h"
+#include "control.h"
+#include "dircache.h"
+#include "download.h"
 #include "ex.h"
 #include "ext-proxy.h"
 #include "handler.h"
 #include "history.h"
 #include "input.h"
+#include "load-scheduler.h"
 #include "main.h"
 #include "map.h"
+#include "nav.h"
 #include "normal.h"
+#include "perf.h"
+#include "server.h"
+#include "session.h"
 #include "setting.h"
 #include "shortcut.h"
+#include "site.h"
+#include "trace.h"
 #include "util.h"
 #include "autocmd.h"
 #include "file-storage.h"
 #include "context-menu.h"
+#include "user-content.h"
 #include "webextension/ext-main.h"
 
 static void client_destroy(Client *c);
@@ -74,16 +89,8 @@ static void on_webctx_download_started(WebKitNetworkSession *session,
         WebKitDownload *download, gpointer user_data);
 /* WebKitGTK 6.0: initialize-web-extensions signal removed - callback no longer needed */
 /* static void on_webctx_init_web_extension(WebKitWebContext *webctx, gpointer data); */
-static gboolean on_webdownload_decide_destination(WebKitDownload *download,
-        gchar *suggested_filename, Client *c);
 static void on_webdownload_response_received(WebKitDownload *download,
         GParamSpec *ps, Client *c);
-static void spawn_download_command(Client *c, WebKitURIResponse *response);
-static void on_webdownload_failed(WebKitDownload *download,
-        GError *error, Client *c);
-static void on_webdownload_finished(WebKitDownload *download, Client *c);
-static void on_webdownload_received_data(WebKitDownload *download,
-        guint64 data_length, Client *c);
 static void on_webview_close(WebKitWebView *webview, Client *c);
 static WebKitWebView *on_webview_create(WebKitWebView *webview,
         WebKitNavigationAction *navact, Client *c);
@@ -94,6 +101,8 @@ static void decide_new_window_action(Client *c, WebKitPolicyDecision *dec);
 static void decide_response(Client *c, WebKitPolicyDecision *dec);
 static void on_webview_load_changed(WebKitWebView *webview,
         WebKitLoadEvent event, Client *c);
+static gboolean on_webview_load_failed(WebKitWebView *webview,
+        WebKitLoadEvent event, char *uri, GError *error, Client *c);
 static void on_webview_mouse_target_changed(WebKitWebView *webview,
         WebKitHitTestResult *result, guint modifiers, Client *c);
 static void on_webview_notify_estimated_load_progress(WebKitWebView *webview,
@@ -121,14 +130,16 @@ static void update_urlbar(Client *c);
 static void set_statusbar_style(Client *c, StatusType type);
 static void set_title(Client *c, const char *title);
 static void spawn_new_instance(const char *uri);
+static void open_new_window(Client *c, const char *uri);
 #ifdef FREE_ON_QUIT
 static void vimb_cleanup(void);
 #endif
 static void vimb_setup(void);
 static WebKitWebView *webview_new(Client *c, WebKitWebView *webview);
-static void on_found_text(WebKitFindController *finder, guint count, Client *c);
-static void on_failed_to_find_text(WebKitFindController *finder, Client *c);
+static void on_counted_matches(WebKitFindController *finder, guint count, Client *c);
 static gboolean on_user_message_received(WebKitWebView *webview, WebKitUserMessage *message, Client *c);
+static void on_permission_dialog_response(GtkDialog *dialog, gint response_id,
+        WebKitPermissionRequest *request);
 static gboolean on_permission_request(WebKitWebView *webview,
         WebKitPermissionRequest *request, Client *c);
 /* GTK4: Scroll handling changed - GdkEvent is opaque, may need event controller */
@@ -146,6 +157,20 @@ static void create_main_window(void);
 static void on_notebook_switch_page(GtkNotebook *notebook, GtkWidget *page,
         guint page_num, gpointer user_data);
 static void update_tab_label(Client *c);
+static Client *tab_new(WebKitWebView *related, gboolean activate);
+static Client *tab_create(void);
+static int tab_append(Client *c);
+static void tab_init(Client *c);
+static void tab_activate(Client *c);
+static void tab_add_placeholder(Client *c);
+static void client_attach_webview(Client *c, WebKitWebView *related);
+static gboolean tab_discardable(Client *c);
+static void tab_restore(Client *c);
+static WebKitBackForwardListItem *tab_restore_webview(Client *c);
+static void tab_discard_clear(Client *c);
+static gboolean on_tab_discard_timeout(gpointer data);
+static void on_low_memory_warning(GMemoryMonitor *monitor,
+        GMemoryMonitorWarningLevel level, gpointer data);
 static gboolean on_main_window_delete_event(GtkWidget *window, gpointer data);
 static void on_main_window_destroy(GtkWidget *window, gpointer data);
 
@@ -154,9 +179,19 @@ struct Vimb vb;
 /* GTK4: Use GMainLoop instead of gtk_main */
 static GMainLoop *main_loop = NULL;
 
+/* Triggers for the discarding of hidden tabs. */
+static struct {
+    guint           timer;
+    GMemoryMonitor  *monitor;
+} tab_discarding;
+
+/* Set while placeholder tabs are added to not create their webviews. */
+static gboolean tab_restore_blocked = FALSE;
+
 /* Signal handler for graceful shutdown on CTRL-C */
 static gboolean signal_handler_cb(gpointer user_data)
 {
+    session_flush();
     if (main_loop && g_main_loop_is_running(main_loop)) {
         g_main_loop_quit(main_loop);
     }
@@ -172,7 +207,7 @@ gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
 {
     char *download_path, *dir, *file, *uri, *basename = NULL;
 
-    download_path = GET_CHAR(c, "download-path");
+    download_path = c->config.settings.download_path;
 
     if (!suggested_filename || !*suggested_filename) {
         const char *download_uri;
@@ -268,17 +303,17 @@ void vb_echo(Client *c, MessageType type, gboolean hide, const char *error, ...)
 {
     char *buffer;
     va_list args;
-    /* Don't write to input box in case this is focused, might be the user is
-     * typing in it. */
-    if (gtk_widget_is_focus(GTK_WIDGET(c->input))) {
-        return;
-    }
 
     va_start(args, error);
     buffer = g_strdup_vprintf(error, args);
     va_end(args);
 
-    input_print(c, type, hide, buffer);
+    control_echo(c, type, buffer);
+    /* Don't write to input box in case this is focused, might be the user is
+     * typing in it. */
+    if (!gtk_widget_is_focus(GTK_WIDGET(c->input))) {
+        input_print(c, type, hide, buffer);
+    }
     g_free(buffer);
 }
 
@@ -295,6 +330,7 @@ void vb_echo_force(Client *c, MessageType type, gboolean hide, const char *error
     buffer = g_strdup_vprintf(error, args);
     va_end(args);
 
+    control_echo(c, type, buffer);
     input_print(c, type, hide, buffer);
     g_free(buffer);
 }
@@ -391,7 +427,7 @@ char *vb_input_get_text(Client *c)
 void vb_input_set_text(Client *c, const char *text)
 {
     gtk_text_buffer_set_text(c->buffer, text, -1);
-    if (c->config.input_autohide) {
+    if (c->config.settings.input_autohide) {
         gtk_widget_set_visible(GTK_WIDGET(c->input), *text != '\0');
     }
 }
@@ -431,11 +467,22 @@ gboolean vb_load_uri(Client *c, const Arg *arg)
     char *uri = NULL, *rp, *path = NULL;
     struct stat st;
 
+    /* A discarded tab needs its webview and settings back, the page shown
+     * before is not loaded if it's replaced by the uri anyway. */
+    if (!c->webview) {
+        if (arg->i == TARGET_CURRENT) {
+            c->state.discard.load = FALSE;
+            tab_restore_webview(c);
+        } else {
+            tab_restore(c);
+        }
+    }
+
     if (arg->s) {
         path = g_strstrip(arg->s);
     }
     if (!path || !*path) {
-        path = GET_CHAR(c, "home-page");
+        path = c->config.settings.home_page;
     }
 
     /* If path contains :// but no space we open it direct. This is required
@@ -458,7 +505,9 @@ gboolean vb_load_uri(Client *c, const Arg *arg)
     }
 
     if (arg->i == TARGET_CURRENT) {
-        /* Load the uri into the browser instance. */
+        /* Load the uri into the browser instance, this supersedes a
+         * scheduled load of the tab. */
+        load_scheduler_remove(c);
         webkit_web_view_load_uri(c->webview, uri);
         set_title(c, uri);
     } else if (arg->i == TARGET_NEW) {
@@ -471,14 +520,14 @@ gboolean vb_load_uri(Client *c, const Arg *arg)
         /* Open in a new tab */
         Client *newclient = vb_tab_new(c, uri);
         if (newclient) {
-            webkit_web_view_load_uri(newclient->webview, uri);
+            load_scheduler_request(newclient, uri);
             set_title(newclient, uri);
         }
 #endif
     } else { /* TARGET_RELATED */
         Client *newclient = client_new(c->webview);
         /* Load the uri into the new client. */
-        webkit_web_view_load_uri(newclient->webview, uri);
+        load_scheduler_request(newclient, uri);
         set_title(c, uri);
     }
     g_free(uri);
@@ -550,7 +599,7 @@ VbResult vb_mode_handle_key(Client *c, int key)
  */
 void vb_modelabel_update(Client *c, const char *label)
 {
-    if (c->config.input_autohide) {
+    if (c->config.settings.input_autohide) {
         /* if the inputbox is potentially not shown write mode into statusbar */
         gtk_label_set_text(GTK_LABEL(c->statusbar.mode), label);
     } else {
@@ -595,6 +644,9 @@ gboolean vb_quit_all(gboolean force)
         }
     }
 
+    /* Keep the tabs in the session before they are closed one by one. */
+    session_flush();
+
     /* Build a list of all clients to quit */
     for (c = vb.clients; c; c = c->next) {
         clients_to_quit = g_slist_prepend(clients_to_quit, c);
@@ -667,51 +719,42 @@ const char *vb_register_get(Client *c, char buf)
 
 static void statusbar_update_downloads(Client *c, GString *status)
 {
-    GList *list;
-    guint list_length, remaining_max = 0;
-    gdouble progress, elapsed, total, remaining;
-    WebKitDownload *download;
+    guint count, queued;
+    guint64 rate;
+    gint64 eta;
+    char *size;
 
     g_assert(c);
     g_assert(status);
 
-    if (c->state.downloads) {
-        list_length = g_list_length(c->state.downloads);
-        g_assert(list_length);
-
-        /* get highest ETA value of all downloads based on each download's
-         * current progress fraction and time elapsed */
-        for (list = c->state.downloads; list != NULL; list = list->next) {
-            download = (WebKitDownload *)list->data;
-            g_assert(download);
-
-            progress = webkit_download_get_estimated_progress(download);
-
-            /* avoid dividing by zero */
-            if (progress == 0.0) {
-                continue;
-            }
-
-            elapsed = webkit_download_get_elapsed_time(download);
-            total = (1.0 / progress) * elapsed;
-            remaining = total - elapsed;
-
-            remaining_max = MAX(remaining, remaining_max);
+    download_client_stats(c, &count, &queued, &rate, &eta);
+    if (count) {
+        g_string_append_printf(status, " %u %s", count, count == 1 ? "dnld" : "dnlds");
+        /* download commands don't report their rate */
+        if (rate) {
+            size = g_format_size(rate);
+            g_string_append_printf(status, " %s/s", size);
+            g_free(size);
         }
-
-        g_string_append_printf(status, " %d %s (ETA %us)",
-                list_length, list_length == 1? "dnld" : "dnlds", remaining_max);
+        if (eta >= 0) {
+            g_string_append_printf(status, " (ETA %" G_GINT64_FORMAT "s)", eta);
+        }
+    }
+    if (queued) {
+        g_string_append_printf(status, " [DQ:%u]", queued);
     }
 }
 
 void vb_statusbar_update(Client *c)
 {
     GString *status;
+    guint queued;
 
-    if (!gtk_widget_get_visible(GTK_WIDGET(c->statusbar.box))) {
+    if (vb_tab_is_placeholder(c) || !gtk_widget_get_visible(GTK_WIDGET(c->statusbar.box))) {
         return;
     }
 
+    trace_begin("vb_statusbar_update");
     status = g_string_new("");
 
     /* show the number of matches search results */
@@ -744,6 +787,11 @@ void vb_statusbar_update(Client *c)
 #endif
     }
 
+    /* show the number of tabs waiting to be loaded */
+    if ((queued = load_scheduler_queued())) {
+        g_string_append_printf(status, " [Q:%u]", queued);
+    }
+
     statusbar_update_downloads(c, status);
 
     /* These architectures have different kinds of issues with scroll
@@ -754,7 +802,7 @@ void vb_statusbar_update(Client *c)
 #endif
 
 #ifdef STATUS_VARAIBLE_SHOW
-    if (c->config.statusbar_show_settings) {
+    if (c->config.settings.status_bar_show_settings) {
         g_string_append_printf(status, STATUS_VARAIBLE_SHOW);
     }
 #endif
@@ -772,6 +820,7 @@ void vb_statusbar_update(Client *c)
 
     gtk_label_set_text(GTK_LABEL(c->statusbar.right), status->str);
     g_string_free(status, TRUE);
+    trace_end("vb_statusbar_update");
 }
 
 /**
@@ -850,9 +899,7 @@ __attribute__((used)) static void client_destroy(Client *c)
         vb.clients = c->next;
     }
 
-    if (c->state.search.last_query) {
-        g_free(c->state.search.last_query);
-    }
+    command_search_cleanup(c);
     if (c->state.hit_test_result) {
         g_object_unref(c->state.hit_test_result);
     }
@@ -870,6 +917,15 @@ __attribute__((used)) static void client_destroy(Client *c)
 #ifdef FEATURE_AUTOCMD
     autocmd_cleanup(c);
 #endif
+    tab_discard_clear(c);
+    load_scheduler_remove(c);
+    download_client_remove(c);
+    perf_client_remove(c);
+    async_client_cancel(c);
+    site_client_remove(c);
+    dircache_client_remove(c);
+    nav_client_remove(c);
+    ext_proxy_client_remove(c);
     handler_free(c->handler);
     shortcut_free(c->config.shortcuts);
 
@@ -890,8 +946,7 @@ __attribute__((used)) static void client_destroy(Client *c)
  */
 static Client *client_new(WebKitWebView *webview)
 {
-    /* Use the new tab-based client creation */
-    return vb_tab_new(NULL, NULL);
+    return tab_new(webview, TRUE);
 }
 
 /**
@@ -1249,6 +1304,26 @@ static void spawn_new_instance(const char *uri)
     g_free(cmd);
 }
 
+/**
+ * Open the uri of a link or script of the client as new window according to
+ * the new-window setting. Tabs are related to the webview of the client and
+ * share its web process and caches.
+ */
+static void open_new_window(Client *c, const char *uri)
+{
+#ifndef FEATURE_NO_TABS
+    Client *new;
+
+    if (c->config.new_window != NEW_WINDOW_PROCESS) {
+        new = tab_new(c->webview, c->config.new_window == NEW_WINDOW_TAB);
+        load_scheduler_request(new, uri);
+        set_title(new, uri);
+        return;
+    }
+#endif
+    spawn_new_instance(uri);
+}
+
 /**
  * Callback for the network session download-started signal (WebKitGTK 6.0).
  * Signal moved from WebKitWebContext to WebKitNetworkSession.
@@ -1276,9 +1351,10 @@ static void on_webctx_download_started(WebKitNetworkSession *session,
         }
     }
 
-    /* Fallback to first client if webview not found or download has no webview */
+    /* Fallback to first client with settings if webview not found or
+     * download has no webview */
     if (!c) {
-        c = vb.clients;
+        for (c = vb.clients; c && vb_tab_is_placeholder(c); c = c->next);
     }
 
     if (!c) {
@@ -1291,18 +1367,10 @@ static void on_webctx_download_started(WebKitNetworkSession *session,
     autocmd_run(c, AU_DOWNLOAD_STARTED, uri, NULL);
 #endif
 
-    if (GET_BOOL(c, "download-use-external")) {
+    if (c->config.settings.download_use_external) {
         g_signal_connect(download, "notify::response", G_CALLBACK(on_webdownload_response_received), c);
     } else {
-        g_signal_connect(download, "decide-destination", G_CALLBACK(on_webdownload_decide_destination), c);
-        g_signal_connect(download, "failed", G_CALLBACK(on_webdownload_failed), c);
-        g_signal_connect(download, "finished", G_CALLBACK(on_webdownload_finished), c);
-        g_signal_connect(download, "received-data", G_CALLBACK(on_webdownload_received_data), c);
-
-        c->state.downloads = g_list_append(c->state.downloads, download);
-
-        /* to reflect the correct download count */
-        vb_statusbar_update(c);
+        download_add(c, download);
     }
 }
 
@@ -1333,175 +1401,14 @@ static void on_webctx_init_web_extension(WebKitWebContext *webctx, gpointer data
 }
 #endif
 
-/**
- * Callback for the webkit download decide destination signal.
- * This signal is emitted after response is received to decide a destination
- * URI for the download.
- */
-static gboolean on_webdownload_decide_destination(WebKitDownload *download,
-        gchar *suggested_filename, Client *c)
-{
-    if (webkit_download_get_destination(download)) {
-        return TRUE;
-    }
-
-    return vb_download_set_destination(c, download, suggested_filename, NULL);
-}
-
 static void on_webdownload_response_received(WebKitDownload *download,
         GParamSpec *ps, Client *c)
 {
-    spawn_download_command(c, webkit_download_get_response(download));
+    download_add_external(c,
+            webkit_uri_response_get_uri(webkit_download_get_response(download)));
     webkit_download_cancel(download);
 }
 
-static void spawn_download_command(Client *c, WebKitURIResponse *response)
-{
-    char *cmd;
-    char **argv, **envp;
-    int argc;
-    GError *error = NULL;
-
-    cmd = g_strdup_printf(GET_CHAR(c, "download-command"),
-            webkit_uri_response_get_uri(response));
-
-    if (!g_shell_parse_argv(cmd, &argc, &argv, &error)) {
-        g_warning("Could not parse download-command '%s': %s",
-                cmd,
-                error->message);
-        g_error_free(error);
-        g_free(cmd);
-        return;
-    }
-
-    envp = g_get_environ();
-    envp = g_environ_setenv(envp, "VIMB_DOWNLOAD_PATH",
-            GET_CHAR(c, "download-path"), TRUE);
-
-    if (g_spawn_async(NULL, argv, envp, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error)) {
-        vb_echo(c, MSG_NORMAL, FALSE, "Download started");
-    } else {
-        vb_echo(c, MSG_ERROR, TRUE, "Could not start download");
-        g_warning("%s", error->message);
-        g_clear_error(&error);
-    }
-    g_free(cmd);
-    g_strfreev(envp);
-    g_strfreev(argv);
-}
-
-/**
- * Callback for the webkit download failed signal.
- * This signal is emitted when an error occurs during the download operation.
- */
-static void on_webdownload_failed(WebKitDownload *download,
-               GError *error, Client *c)
-{
-    gchar *destination = NULL, *filename = NULL, *basename = NULL;
-
-    g_assert(download);
-    g_assert(error);
-    g_assert(c);
-
-#ifdef FEATURE_AUTOCMD
-    const char *uri = webkit_uri_request_get_uri(webkit_download_get_request(download));
-    autocmd_run(c, AU_DOWNLOAD_FAILED, uri, NULL);
-#endif
-
-    /* get the failed download's destination uri */
-    g_object_get(download, "destination", &destination, NULL);
-    g_assert(destination);
-
-    /* filename from uri */
-    if (destination) {
-        filename = g_filename_from_uri(destination, NULL, NULL);
-        g_free(destination);
-    }
-
-    /* basename from filename */
-    if (filename) {
-        basename = g_path_get_basename(filename);
-        g_free(filename);
-    }
-
-    /* report the error to the user */
-    if (basename) {
-        vb_echo(c, MSG_ERROR, FALSE, "Download of %s failed (%s)", basename, error->message);
-        g_free(basename);
-    }
-}
-
-/**
- * Callback for the webkit download finished signal.
- * This signal is emitted when download finishes successfully or due to an
- * error. In case of errors “failed” signal is emitted before this one.
- */
-static void on_webdownload_finished(WebKitDownload *download, Client *c)
-{
-    gchar *destination = NULL, *filename = NULL, *basename = NULL;
-
-    g_assert(download);
-    g_assert(c);
-
-#ifdef FEATURE_AUTOCMD
-    const char *uri = webkit_uri_request_get_uri(webkit_download_get_request(download));
-    autocmd_run(c, AU_DOWNLOAD_FINISHED, uri, NULL);
-#endif
-
-    c->state.downloads = g_list_remove(c->state.downloads, download);
-
-    /* to reflect the correct download count */
-    vb_statusbar_update(c);
-
-    /* get the finished downloads destination uri */
-    g_object_get(download, "destination", &destination, NULL);
-    g_assert(destination);
-
-    /* filename from uri */
-    if (destination) {
-        filename = g_filename_from_uri(destination, NULL, NULL);
-        g_free(destination);
-    }
-
-    if (filename) {
-        /* basename from filename */
-        basename = g_path_get_basename(filename);
-
-        if (basename) {
-            /* Only report to the user if the downloaded file exists, so the
-             * download was successful. Otherwise, this is a failed download
-             * finished signal and it was reported to the user in
-             * on_webdownload_failed() already. */
-            if (g_file_test(filename, G_FILE_TEST_EXISTS)) {
-                vb_echo(c, MSG_NORMAL, FALSE, "Download of %s finished", basename);
-            }
-
-            g_free(basename);
-        }
-
-        g_free(filename);
-    }
-}
-
-/**
- * Callback for the webkit download received-data signal.
- * This signal is emitted after response is received, every time new data has
- * been written to the destination. It's useful to know the progress of the
- * download operation.
- */
-static void on_webdownload_received_data(WebKitDownload *download,
-        guint64 data_length, Client *c)
-{
-    /* rate limit statusbar updates */
-    static gint64 statusbar_update_next = 0;
-
-    if (g_get_monotonic_time() > statusbar_update_next) {
-        statusbar_update_next = g_get_monotonic_time() + 1000000; /* 1 second */
-
-        vb_statusbar_update(c);
-    }
-}
-
 /**
  * Callback for the webview close signal.
  */
@@ -1519,23 +1426,24 @@ static WebKitWebView *on_webview_create(WebKitWebView *webview,
         WebKitNavigationAction *navact, Client *c)
 {
     WebKitURIRequest *req;
-    if (c->config.prevent_newwindow) {
+    if (c->config.settings.prevent_newwindow) {
         req = webkit_navigation_action_get_request(navact);
         vb_load_uri(c, &(Arg){TARGET_CURRENT, (char*)webkit_uri_request_get_uri(req)});
 
         return NULL;
     }
 
-#ifdef FEATURE_NO_TABS
+#ifndef FEATURE_NO_TABS
+    /* WebKit loads the request into the returned webview, which has to be
+     * related to the opener. */
+    if (c->config.new_window != NEW_WINDOW_PROCESS) {
+        return tab_new(webview, c->config.new_window == NEW_WINDOW_TAB)->webview;
+    }
+#endif
     req = webkit_navigation_action_get_request(navact);
     spawn_new_instance(webkit_uri_request_get_uri(req));
 
     return NULL;
-#else
-    Client *new = client_new(webview);
-
-    return new->webview;
-#endif
 }
 
 /**
@@ -1573,13 +1481,18 @@ static void decide_navigation_action(Client *c, WebKitPolicyDecision *dec)
     WebKitNavigationAction *a;
     WebKitURIRequest *req;
     const char *uri;
+    NavContext *nav;
 
     a   = webkit_navigation_policy_decision_get_navigation_action(WEBKIT_NAVIGATION_POLICY_DECISION(dec));
     req = webkit_navigation_action_get_request(a);
     uri = webkit_uri_request_get_uri(req);
+    /* Parse the uri once for all the handlers of this navigation. This may
+     * be the navigation of a subframe, so the context only becomes the one
+     * of the page if the main frame loads the uri. */
+    nav = nav_begin(c, uri);
 
     /* Try to handle with specific protocol handler. */
-    if (handler_handle_uri(c->handler, uri)) {
+    if (handler_handle_scheme(c->handler, nav->scheme, uri)) {
         webkit_policy_decision_ignore(dec);
         return;
     }
@@ -1596,7 +1509,7 @@ static void decide_navigation_action(Client *c, WebKitPolicyDecision *dec)
         /* Open in a new tab */
         vb_load_uri(c, &(Arg){TARGET_TAB, (char *)uri});
     }
-    /* Spawn new instance if the new win flag is set on the mode, or the
+    /* Open a new window if the new win flag is set on the mode, or the
      * navigation was triggered by CTRL-LeftMouse or MiddleMouse. */
     else if ((c->mode->flags & FLAG_NEW_WIN)
         || (webkit_navigation_action_get_navigation_type(a) == WEBKIT_NAVIGATION_TYPE_LINK_CLICKED
@@ -1606,7 +1519,7 @@ static void decide_navigation_action(Client *c, WebKitPolicyDecision *dec)
         c->mode->flags &= ~FLAG_NEW_WIN;
 
         webkit_policy_decision_ignore(dec);
-        spawn_new_instance(uri);
+        open_new_window(c, uri);
     } else {
 #ifdef FEATURE_QUEUE
         /* Push link target to queue on Shift-LeftMouse. */
@@ -1621,7 +1534,7 @@ static void decide_navigation_action(Client *c, WebKitPolicyDecision *dec)
 #endif
 #ifdef FEATURE_AUTOCMD
         if (strcmp(uri, "about:blank")) {
-            autocmd_run(c, AU_LOAD_STARTING, uri, NULL);
+            autocmd_run_nav(c, AU_LOAD_STARTING, nav);
         }
 #endif
         webkit_policy_decision_use(dec);
@@ -1642,16 +1555,15 @@ static void decide_new_window_action(Client *c, WebKitPolicyDecision *dec)
         case WEBKIT_NAVIGATION_TYPE_RELOAD:         /* fallthrough */
         case WEBKIT_NAVIGATION_TYPE_FORM_RESUBMITTED:
             /* This is triggered on link click for links with target="_blank".
-             * Maybe it should be configurable if the page is opened as tab or
-             * a new instance. Ignore opening new window if this was started
-             * without user gesture. */
+             * Ignore opening new window if this was started without user
+             * gesture. */
             if (webkit_navigation_action_is_user_gesture(a)) {
                 req = webkit_navigation_action_get_request(a);
-                if (c->config.prevent_newwindow) {
+                if (c->config.settings.prevent_newwindow) {
                     /* Load the uri into the browser instance. */
                     vb_load_uri(c, &(Arg){TARGET_CURRENT, (char*)webkit_uri_request_get_uri(req)});
                 } else {
-                    spawn_new_instance(webkit_uri_request_get_uri(req));
+                    open_new_window(c, webkit_uri_request_get_uri(req));
                 }
             }
             break;
@@ -1684,22 +1596,37 @@ static void on_webview_load_changed(WebKitWebView *webview,
         WebKitLoadEvent event, Client *c)
 {
     GTlsCertificateFlags tlsflags;
-    const char *raw_uri;
-    char *uri = NULL;
+    const char *uri = NULL;
+    NavContext *nav;
+    gint64 start;
 
-    raw_uri = webkit_web_view_get_uri(webview);
-    if (raw_uri) {
-        uri = util_sanitize_uri(raw_uri);
+    /* Held since the autocmds may start a new navigation. */
+    if ((nav = nav_get(c, webkit_web_view_get_uri(webview)))) {
+        nav_ref(nav);
+        uri = nav->display;
     }
 
+    trace_begin("on_webview_load_changed");
+    perf_load_changed(c, event, uri);
     switch (event) {
         case WEBKIT_LOAD_STARTED:
+            /* the load of each tab is shown as own async span */
+            trace_async_begin("load", (guint64)c->page_id);
+            /* Put the settings of the site on the webview. This is only done
+             * here, because the navigation policy is also decided for the
+             * loads of subframes, which must not change the settings of the
+             * page. */
+            site_apply(c, nav ? nav->host : NULL);
 #ifdef FEATURE_AUTOCMD
-            autocmd_run(c, AU_LOAD_STARTED, raw_uri, NULL);
+            start = g_get_monotonic_time();
+            autocmd_run_nav(c, AU_LOAD_STARTED, nav);
+            perf_handler_time(c, PERF_AUTOCMD, start);
 #endif
             /* update load progress in statusbar */
             c->state.progress = 0;
+            start = g_get_monotonic_time();
             vb_statusbar_update(c);
+            perf_handler_time(c, PERF_STATUSBAR, start);
             if (uri) {
                 set_title(c, uri);
             }
@@ -1716,9 +1643,11 @@ static void on_webview_load_changed(WebKitWebView *webview,
             break;
 
         case WEBKIT_LOAD_REDIRECTED:
+            trace_instant("load-redirected");
             break;
 
         case WEBKIT_LOAD_COMMITTED:
+            trace_instant("load-committed");
             /* In case of HTTP authentication request we ignore the focus
              * changes so that the input mode can be set for the
              * authentication request. If the authentication dialog is filled
@@ -1726,7 +1655,9 @@ static void on_webview_load_changed(WebKitWebView *webview,
              * right place to remove the flag. */
             c->mode->flags &= ~FLAG_IGNORE_FOCUS;
 #ifdef FEATURE_AUTOCMD
-            autocmd_run(c, AU_LOAD_COMMITTED, raw_uri, NULL);
+            start = g_get_monotonic_time();
+            autocmd_run_nav(c, AU_LOAD_COMMITTED, nav);
+            perf_handler_time(c, PERF_AUTOCMD, start);
 #endif
             /* save the current URI in register % */
             vb_register_add(c, '%', uri);
@@ -1741,8 +1672,11 @@ static void on_webview_load_changed(WebKitWebView *webview,
                 set_statusbar_style(c, STATUS_NORMAL);
             }
 
-            /* clear possible set marks */
-            marks_clear(c);
+            /* clear possible set marks, but keep them for a restored tab */
+            if (!c->state.discard.restoring) {
+                marks_clear(c);
+            }
+            session_save();
 
             /* Unset possible last search. Use commit==TRUE to clear inputbox
              * in case a link was fired from highlighted link. */
@@ -1751,23 +1685,41 @@ static void on_webview_load_changed(WebKitWebView *webview,
             break;
 
         case WEBKIT_LOAD_FINISHED:
+            trace_async_end("load", (guint64)c->page_id);
 #ifdef FEATURE_AUTOCMD
-            autocmd_run(c, AU_LOAD_FINISHED, raw_uri, NULL);
+            start = g_get_monotonic_time();
+            autocmd_run_nav(c, AU_LOAD_FINISHED, nav);
+            perf_handler_time(c, PERF_AUTOCMD, start);
 #endif
             c->state.progress = 100;
+            load_scheduler_finished(c);
+            /* Restore the scroll position of a discarded or restored tab. */
+            if (c->state.discard.restoring) {
+                if (c->state.discard.scroll_top) {
+                    char *js = g_strdup_printf("window.scroll(window.scrollX,%" G_GUINT64_FORMAT ");",
+                            c->state.discard.scroll_top);
+                    ext_proxy_eval_script(c, js, NULL);
+                    g_free(js);
+                }
+                c->state.discard.scroll_top = 0;
+                c->state.discard.restoring  = FALSE;
+            }
             if (uri
                 && regexec(&c->config.histignore_preg, uri, 0, NULL, 0)
 #ifdef FEATURE_HISTORY_WITHOUT_HOME_PAGE
-                && strcmp(uri, GET_CHAR(c, "home-page"))
+                && strcmp(uri, c->config.settings.home_page)
 #endif
             ) {
+                start = g_get_monotonic_time();
                 history_add(c, HISTORY_URL, uri, webkit_web_view_get_title(webview));
+                perf_handler_time(c, PERF_HISTORY, start);
             }
             break;
     }
+    trace_end("on_webview_load_changed");
 
-    if (uri) {
-        g_free(uri);
+    if (nav) {
+        nav_unref(nav);
     }
 }
 
@@ -1806,8 +1758,11 @@ static void on_webview_mouse_target_changed(WebKitWebView *webview,
 static void on_webview_notify_estimated_load_progress(WebKitWebView *webview,
         GParamSpec *spec, Client *c)
 {
+    gint64 start = g_get_monotonic_time();
+
     c->state.progress = webkit_web_view_get_estimated_load_progress(webview) * 100;
     vb_statusbar_update(c);
+    perf_handler_time(c, PERF_STATUSBAR, start);
     update_title(c);
 }
 
@@ -1830,11 +1785,14 @@ static void on_webview_notify_title(WebKitWebView *webview, GParamSpec *pspec, C
  */
 static void on_webview_notify_uri(WebKitWebView *webview, GParamSpec *pspec, Client *c)
 {
+    NavContext *nav;
+
     if (c->state.uri) {
         g_free(c->state.uri);
     }
 
-    c->state.uri = util_sanitize_uri(webkit_web_view_get_uri(c->webview));
+    nav          = nav_get(c, webkit_web_view_get_uri(c->webview));
+    c->state.uri = nav ? g_strdup(nav->display) : NULL;
 
     update_urlbar(c);
     g_setenv("VIMB_URI", c->state.uri, TRUE);
@@ -1849,6 +1807,17 @@ static void on_webview_ready_to_show(WebKitWebView *webview, Client *c)
     client_show(webview, c);
 }
 
+/**
+ * Record the failed load, the error page is still shown by WebKit.
+ */
+static gboolean on_webview_load_failed(WebKitWebView *webview,
+        WebKitLoadEvent event, char *uri, GError *error, Client *c)
+{
+    perf_load_failed(c, error);
+
+    return FALSE;
+}
+
 /**
  * Callback for the webview web-process-terminated signal (WebKitGTK 6.0).
  * Replaces web-process-crashed signal - now provides termination reason.
@@ -1873,6 +1842,9 @@ static void on_webview_web_process_terminated(WebKitWebView *webview,
     }
     vb_echo(c, MSG_ERROR, FALSE, "Webview %s on %s", reason_str,
             webkit_web_view_get_uri(webview));
+    /* The counts requested from the terminated process are not answered. */
+    command_search_reset_counts(c);
+    load_scheduler_finished(c);
 }
 
 /**
@@ -1950,9 +1922,7 @@ static void on_window_destroy(GtkWidget *window, Client *c)
         }
 
         /* Clean up client resources */
-        if (c->state.search.last_query) {
-            g_free(c->state.search.last_query);
-        }
+        command_search_cleanup(c);
         if (c->state.hit_test_result) {
             g_object_unref(c->state.hit_test_result);
         }
@@ -1970,6 +1940,15 @@ static void on_window_destroy(GtkWidget *window, Client *c)
 #ifdef FEATURE_AUTOCMD
         autocmd_cleanup(c);
 #endif
+        tab_discard_clear(c);
+        load_scheduler_remove(c);
+        download_client_remove(c);
+        perf_client_remove(c);
+        async_client_cancel(c);
+        site_client_remove(c);
+        dircache_client_remove(c);
+        nav_client_remove(c);
+        ext_proxy_client_remove(c);
         handler_free(c->handler);
         shortcut_free(c->config.shortcuts);
 
@@ -2113,8 +2092,23 @@ static void vimb_cleanup(void)
         client_destroy(vb.clients);
     }
 
+    if (tab_discarding.timer) {
+        g_source_remove(tab_discarding.timer);
+    }
+    g_clear_object(&tab_discarding.monitor);
+
     /* free memory of other components */
     util_cleanup();
+    user_content_cleanup();
+    session_cleanup();
+    load_scheduler_cleanup();
+    download_cleanup();
+    budget_cleanup();
+    perf_cleanup();
+    async_cleanup();
+    site_cleanup();
+    dircache_cleanup();
+    nav_cleanup();
 
     for (i = 0; i < STORAGE_LAST; i++) {
         file_storage_free(vb.storage[i]);
@@ -2158,7 +2152,9 @@ static void vimb_setup(void)
     dataPath = util_get_data_dir();
     if (!vb.incognito) {
         vb.files[FILES_CLOSED] = g_build_filename(dataPath, "closed", NULL);
+        vb.files[FILES_SESSION] = g_build_filename(dataPath, "session", NULL);
         vb.files[FILES_COOKIE] = g_build_filename(dataPath, "cookies.db", NULL);
+        vb.files[FILES_PERF] = g_build_filename(dataPath, "perf", NULL);
     }
     vb.files[FILES_BOOKMARK]   = g_build_filename(dataPath, "bookmark", NULL);
     vb.files[FILES_QUEUE]      = g_build_filename(dataPath, "queue", NULL);
@@ -2168,6 +2164,10 @@ static void vimb_setup(void)
     vb.storage[STORAGE_SEARCH]   = file_storage_new(dataPath, "search", vb.incognito);
     g_free(dataPath);
 
+    /* The memory pressure settings must be applied before the network
+     * session is created. */
+    budget_init();
+
     /* WebKitGTK 6.0: Use WebKitNetworkSession instead of WebKitWebsiteDataManager */
     if (vb.incognito) {
         vb.session = webkit_network_session_new_ephemeral();
@@ -2179,9 +2179,10 @@ static void vimb_setup(void)
         g_free(cache_dir);
     }
 
-    /* WebKitGTK 6.0: WebContext is now created without parameters */
-    vb.webcontext = webkit_web_context_new();
-    webkit_web_context_set_cache_model(vb.webcontext, WEBKIT_CACHE_MODEL_WEB_BROWSER);
+    vb.webcontext = budget_web_context_new();
+
+    /* Load the precompiled content filters. */
+    user_content_filter_init();
 
     /* WebKitGTK 6.0: initialize-web-extensions signal was removed.
      * Web process extensions are now initialized automatically when the directory is set.
@@ -2200,8 +2201,11 @@ static void vimb_setup(void)
     }
     g_free(extension_path);
 
-    /* WebKitGTK 6.0: Pass NULL as initialization data (D-Bus address no longer needed) */
-    GVariant *vdata = g_variant_new("(ms)", NULL);
+    /* WebKitGTK 6.0: D-Bus address no longer needed. The initialization data
+     * holds the header rules of the tabs, which are empty until the header
+     * setting is applied by ext_proxy_set_header(). */
+    GVariant *vdata = g_variant_new("(@" VB_PAGE_HEADER_RULES_TYPE ")",
+            g_variant_new_array(G_VARIANT_TYPE("{t" VB_HEADER_RULES_TYPE "}"), NULL, 0));
     webkit_web_context_set_web_process_extensions_initialization_user_data(vb.webcontext, vdata);
     webkit_web_context_set_web_process_extensions_directory(vb.webcontext, EXTENSIONDIR);
 
@@ -2242,6 +2246,14 @@ static void vimb_setup(void)
 
     /* Create the main window with notebook for tabs */
     create_main_window();
+
+    /* Discard hidden tabs after the tab-discard-timeout or if the system
+     * runs low on memory. */
+    tab_discarding.timer = g_timeout_add_seconds(TAB_DISCARD_INTERVAL,
+            on_tab_discard_timeout, NULL);
+    tab_discarding.monitor = g_memory_monitor_dup_default();
+    g_signal_connect(tab_discarding.monitor, "low-memory-warning",
+            G_CALLBACK(on_low_memory_warning), NULL);
 }
 
 /**
@@ -2322,35 +2334,56 @@ static void on_notebook_switch_page(GtkNotebook *notebook, GtkWidget *page,
         guint page_num, gpointer user_data)
 {
     Client *c;
-    Client *old_client;
 
     /* Find the client for this page */
     for (c = vb.clients; c; c = c->next) {
         if (c->tab_box == page) {
-            /* Update window title for this tab */
-            if (c->state.title) {
-                gtk_window_set_title(GTK_WINDOW(vb.main_window), c->state.title);
-            }
+            tab_activate(c);
+            break;
+        }
+    }
+}
 
-            /* Disconnect input buffer signal from all clients first */
-            for (old_client = vb.clients; old_client; old_client = old_client->next) {
-                g_signal_handlers_disconnect_by_func(vb.input_buffer,
-                        G_CALLBACK(on_textbuffer_changed), old_client);
-            }
+/**
+ * Make the client the active one after its tab was switched to.
+ */
+static void tab_activate(Client *c)
+{
+    Client *old_client;
 
-            /* Connect input buffer signal for current client */
-            g_signal_connect(vb.input_buffer, "changed",
-                    G_CALLBACK(on_textbuffer_changed), c);
+    /* Update window title for this tab */
+    if (c->state.title) {
+        gtk_window_set_title(GTK_WINDOW(vb.main_window), c->state.title);
+    }
 
-            /* Give focus to the webview of the new tab */
-            gtk_widget_grab_focus(GTK_WIDGET(c->webview));
+    /* Disconnect input buffer signal from all clients first */
+    for (old_client = vb.clients; old_client; old_client = old_client->next) {
+        g_signal_handlers_disconnect_by_func(vb.input_buffer,
+                G_CALLBACK(on_textbuffer_changed), old_client);
+    }
 
-            /* Update statusbar for the new tab */
-            vb_statusbar_update(c);
+    /* Connect input buffer signal for current client */
+    g_signal_connect(vb.input_buffer, "changed",
+            G_CALLBACK(on_textbuffer_changed), c);
 
-            break;
+    /* Recreate the webview if the tab was discarded or is a placeholder of
+     * a restored session. */
+    if (!c->webview) {
+        if (tab_restore_blocked) {
+            return;
         }
+        tab_restore(c);
     }
+    c->state.last_active = g_get_monotonic_time();
+    load_scheduler_activate(c);
+
+    /* Give focus to the webview of the new tab */
+    gtk_widget_grab_focus(GTK_WIDGET(c->webview));
+
+    /* Update statusbar for the new tab */
+    vb_statusbar_update(c);
+
+    session_save();
 }
 
 /**
@@ -2369,6 +2402,7 @@ static gboolean on_main_window_delete_event(GtkWidget *window, gpointer data)
             return TRUE; /* Prevent closing */
         }
     }
+    session_flush();
     return FALSE; /* Allow closing */
 }
 
@@ -2382,9 +2416,7 @@ static void on_main_window_destroy(GtkWidget *window, gpointer data)
         Client *c = vb.clients;
         vb.clients = c->next;
 
-        if (c->state.search.last_query) {
-            g_free(c->state.search.last_query);
-        }
+        command_search_cleanup(c);
         if (c->state.hit_test_result) {
             g_object_unref(c->state.hit_test_result);
         }
@@ -2401,6 +2433,15 @@ static void on_main_window_destroy(GtkWidget *window, gpointer data)
 #ifdef FEATURE_AUTOCMD
         autocmd_cleanup(c);
 #endif
+        tab_discard_clear(c);
+        load_scheduler_remove(c);
+        download_client_remove(c);
+        perf_client_remove(c);
+        async_client_cancel(c);
+        site_client_remove(c);
+        dircache_client_remove(c);
+        nav_client_remove(c);
+        ext_proxy_client_remove(c);
         handler_free(c->handler);
         shortcut_free(c->config.shortcuts);
         g_slice_free(Client, c);
@@ -2452,17 +2493,75 @@ static void update_tab_label(Client *c)
  * @return:  The new client or NULL on error.
  */
 Client *vb_tab_new(Client *related, const char *uri)
+{
+    return tab_new(related ? related->webview : NULL, TRUE);
+}
+
+/**
+ * Create a new tab whose webview shares the web process of the related
+ * webview if given. The tab is only switched to if activate is set.
+ */
+static Client *tab_new(WebKitWebView *related, gboolean activate)
 {
     Client *c;
-    GtkWidget *tab_label;
     int page_num;
 
+    c = tab_create();
+    client_attach_webview(c, related);
+    page_num = tab_append(c);
+    tab_init(c);
+
+    /* Switch to the new tab and focus its webview */
+    if (activate) {
+        gtk_notebook_set_current_page(GTK_NOTEBOOK(vb.notebook), page_num);
+        gtk_widget_grab_focus(GTK_WIDGET(c->webview));
+    }
+
+    session_save();
+
+    return c;
+}
+
+/**
+ * Create a tab without webview that shows the page of given uri or session
+ * state once it is activated. The session state is owned by the tab.
+ */
+Client *vb_tab_new_placeholder(const char *uri, const char *title,
+        WebKitWebViewSessionState *session)
+{
+    Client *c;
+
+    c = tab_create();
+    c->state.uri   = g_strdup(uri);
+    c->state.title = g_strdup(title ? title : uri);
+    c->state.discard.session = session;
+    tab_add_placeholder(c);
+
+    /* The first page added becomes the current one, but the webview is
+     * created when the tab is activated by the caller. */
+    tab_restore_blocked = TRUE;
+    tab_append(c);
+    tab_restore_blocked = FALSE;
+    update_tab_label(c);
+
+    return c;
+}
+
+/**
+ * Create the client of a new tab and its statusbar. The webview has to be
+ * added by client_attach_webview() or a placeholder.
+ */
+static Client *tab_create(void)
+{
+    Client *c;
+
     /* Create the client */
     c = g_slice_new0(Client);
     c->next = vb.clients;
     vb.clients = c;
 
     c->state.progress = 100;
+    c->state.last_active = g_get_monotonic_time();
     c->config.shortcuts = shortcut_new();
 
     completion_init(c);
@@ -2472,17 +2571,6 @@ Client *vb_tab_new(Client *related, const char *uri)
     autocmd_init(c);
 #endif
 
-    /* Create webview (related to existing if provided) */
-    c->webview = webview_new(c, related ? related->webview : NULL);
-    c->finder = webkit_web_view_get_find_controller(c->webview);
-    g_signal_connect(c->finder, "found-text", G_CALLBACK(on_found_text), c);
-    g_signal_connect(c->finder, "failed-to-find-text", G_CALLBACK(on_failed_to_find_text), c);
-    g_signal_connect(c->webview, "user-message-received", G_CALLBACK(on_user_message_received), c);
-
-    c->page_id = webkit_web_view_get_page_id(c->webview);
-    c->webview_id = (guint64)c->webview;
-    c->inspector = webkit_web_view_get_inspector(c->webview);
-
     /* Create tab content box (webview + statusbar) */
     c->tab_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
 
@@ -2503,9 +2591,7 @@ Client *vb_tab_new(Client *related, const char *uri)
     gtk_box_append(c->statusbar.box, c->statusbar.cmd);
     gtk_box_append(c->statusbar.box, c->statusbar.right);
 
-    /* Pack webview and statusbar into tab box */
-    gtk_box_append(GTK_BOX(c->tab_box), GTK_WIDGET(c->webview));
-    gtk_widget_set_vexpand(GTK_WIDGET(c->webview), TRUE);
+    /* Pack statusbar into tab box, the webview is prepended */
     gtk_box_append(GTK_BOX(c->tab_box), GTK_WIDGET(c->statusbar.box));
 
     /* Use shared inputbox and buffer */
@@ -2518,6 +2604,17 @@ Client *vb_tab_new(Client *related, const char *uri)
     gtk_widget_add_controller(c->tab_box, key_controller);
     g_signal_connect(key_controller, "key-pressed", G_CALLBACK(on_map_key_pressed), c);
 
+    return c;
+}
+
+/**
+ * Add the tab of the client to the notebook and return its page number.
+ */
+static int tab_append(Client *c)
+{
+    GtkWidget *tab_label;
+    int page_num;
+
     /* Create tab label */
     tab_label = gtk_label_new("New Tab");
     gtk_label_set_ellipsize(GTK_LABEL(tab_label), PANGO_ELLIPSIZE_END);
@@ -2527,6 +2624,15 @@ Client *vb_tab_new(Client *related, const char *uri)
     page_num = gtk_notebook_append_page(GTK_NOTEBOOK(vb.notebook), c->tab_box, tab_label);
     gtk_widget_set_visible(c->tab_box, TRUE);
 
+    return page_num;
+}
+
+/**
+ * Apply the settings and the config file to the client, which needs the
+ * webview to be attached already.
+ */
+static void tab_init(Client *c)
+{
     /* Initialize settings */
     setting_init(c);
 
@@ -2536,12 +2642,6 @@ Client *vb_tab_new(Client *related, const char *uri)
 
     /* Read config file */
     ex_run_file(c, vb.files[FILES_CONFIG]);
-
-    /* Switch to the new tab and focus its webview */
-    gtk_notebook_set_current_page(GTK_NOTEBOOK(vb.notebook), page_num);
-    gtk_widget_grab_focus(GTK_WIDGET(c->webview));
-
-    return c;
 }
 
 /**
@@ -2563,6 +2663,11 @@ void vb_tab_close(Client *c)
         return;
     }
 
+    /* Closing the last tab quits, so keep it in the session. */
+    if (vb_get_tab_count() == 1) {
+        session_flush();
+    }
+
     /* Write last URL to closed file */
     if (c->state.uri && vb.config.closed_max && vb.files[FILES_CLOSED]) {
         util_file_prepend_line(vb.files[FILES_CLOSED], c->state.uri, vb.config.closed_max);
@@ -2585,9 +2690,7 @@ void vb_tab_close(Client *c)
     }
 
     /* Clean up client resources */
-    if (c->state.search.last_query) {
-        g_free(c->state.search.last_query);
-    }
+    command_search_cleanup(c);
     if (c->state.hit_test_result) {
         g_object_unref(c->state.hit_test_result);
     }
@@ -2604,10 +2707,21 @@ void vb_tab_close(Client *c)
 #ifdef FEATURE_AUTOCMD
     autocmd_cleanup(c);
 #endif
+    tab_discard_clear(c);
+    load_scheduler_remove(c);
+    download_client_remove(c);
+    perf_client_remove(c);
+    async_client_cancel(c);
+    site_client_remove(c);
+    dircache_client_remove(c);
+    nav_client_remove(c);
+    ext_proxy_client_remove(c);
     handler_free(c->handler);
     shortcut_free(c->config.shortcuts);
     g_slice_free(Client, c);
 
+    session_save();
+
     /* If no more tabs, quit */
     if (gtk_notebook_get_n_pages(GTK_NOTEBOOK(vb.notebook)) == 0) {
         gtk_window_destroy(GTK_WINDOW(vb.main_window));
@@ -2665,8 +2779,86 @@ void vb_tab_goto(int n)
 
     n_pages = gtk_notebook_get_n_pages(GTK_NOTEBOOK(vb.notebook));
     if (n >= 0 && n < n_pages) {
-        gtk_notebook_set_current_page(GTK_NOTEBOOK(vb.notebook), n);
+        if (n == gtk_notebook_get_current_page(GTK_NOTEBOOK(vb.notebook))) {
+            /* There is no switch-page for the current page, but it could be
+             * a placeholder that needs to be activated. */
+            Client *c = vb_get_current_client();
+            if (c && !c->webview) {
+                tab_activate(c);
+            }
+        } else {
+            gtk_notebook_set_current_page(GTK_NOTEBOOK(vb.notebook), n);
+        }
+    }
+}
+
+/**
+ * Discard the webview of given hidden tab to free the memory and the web
+ * process bound to it. The back forward list, the scroll position and the
+ * title are kept to restore the tab once it is activated again.
+ * Returns TRUE if the tab was discarded.
+ */
+gboolean vb_tab_discard(Client *c)
+{
+    WebKitWebView *webview;
+
+    if (!tab_discardable(c)) {
+        return FALSE;
+    }
+
+    webview = c->webview;
+    c->state.discard.session  = webkit_web_view_get_session_state(webview);
+    c->state.discard.ucm      = g_object_ref(webkit_web_view_get_user_content_manager(webview));
+    c->state.discard.settings = g_object_ref(webkit_web_view_get_settings(webview));
+    c->state.discard.zoom     = webkit_web_view_get_zoom_level(webview);
+    c->state.discard.scroll_top = c->state.scroll_top;
+
+    tab_add_placeholder(c);
+
+    /* Unset the references before the webview is disposed, so that no
+     * callback will find a half destroyed view. */
+    c->webview   = NULL;
+    c->finder    = NULL;
+    c->inspector = NULL;
+    command_search_reset_counts(c);
+    if (c->state.hit_test_result) {
+        g_object_unref(c->state.hit_test_result);
+        c->state.hit_test_result = NULL;
+    }
+    /* The tab box holds the only reference so this destroys the webview. */
+    gtk_box_remove(GTK_BOX(c->tab_box), GTK_WIDGET(webview));
+
+    return TRUE;
+}
+
+/**
+ * Discard all the hidden tabs that are not busy.
+ * Returns the number of discarded tabs.
+ */
+guint vb_tab_discard_all(void)
+{
+    Client *c;
+    guint count = 0;
+
+    for (c = vb.clients; c; c = c->next) {
+        if (vb_tab_discard(c)) {
+            count++;
+        }
     }
+
+    return count;
+}
+
+/**
+ * Returns the user content manager of the client, which is also available
+ * if the tabs webview was discarded.
+ */
+WebKitUserContentManager *vb_get_user_content_manager(Client *c)
+{
+    if (c->webview) {
+        return webkit_web_view_get_user_content_manager(c->webview);
+    }
+    return c->state.discard.ucm;
 }
 
 /**
@@ -2695,6 +2887,26 @@ Client *vb_get_current_client(void)
     return vb.clients;
 }
 
+/**
+ * Get the client of the tab at the zero based position or NULL.
+ */
+Client *vb_get_client_for_tab(int page_num)
+{
+    GtkWidget *page;
+
+    if (!vb.notebook || page_num < 0
+        || !(page = gtk_notebook_get_nth_page(GTK_NOTEBOOK(vb.notebook), page_num))) {
+        return NULL;
+    }
+    for (Client *c = vb.clients; c; c = c->next) {
+        if (c->tab_box == page) {
+            return c;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * Get the number of open tabs.
  */
@@ -2719,23 +2931,27 @@ void vb_gui_style_update(Client *c, const char *setting_name_new, const char *se
     GString *style_sheet = g_string_new(GUI_STYLE_CSS_BASE);
     size_t i;
 
-    /* Mapping from vimb config setting name to css style sheet string */
-    static const char *setting_style_map[][2] = {
-        {"completion-css",              " #completion > row{%s}"},
-        {"completion-hover-css",        " #completion > row:hover{%s}"},
-        {"completion-selected-css",     " #completion > row:selected{%s}"},
-        {"input-css",                   " #input{%s}"},
-        {"input-error-css",             " #input.error{%s}"},
-        {"status-css",                  " #statusbar{%s}"},
-        {"status-ssl-css",              " #statusbar.secure{%s}"},
-        {"status-ssl-invalid-css",      " #statusbar.unsecure{%s}"},
-        {0, 0},
+    /* Mapping from vimb config setting name to css style sheet string and
+     * the setting value */
+    static const struct {
+        const char *name;
+        const char *css;
+        size_t     offset;
+    } setting_style_map[] = {
+        {"completion-css",          " #completion > row{%s}",           G_STRUCT_OFFSET(Settings, completion_css)},
+        {"completion-hover-css",    " #completion > row:hover{%s}",     G_STRUCT_OFFSET(Settings, completion_hover_css)},
+        {"completion-selected-css", " #completion > row:selected{%s}",  G_STRUCT_OFFSET(Settings, completion_selected_css)},
+        {"input-css",               " #input{%s}",                      G_STRUCT_OFFSET(Settings, input_css)},
+        {"input-error-css",         " #input.error{%s}",                G_STRUCT_OFFSET(Settings, input_error_css)},
+        {"status-css",              " #statusbar{%s}",                  G_STRUCT_OFFSET(Settings, status_css)},
+        {"status-ssl-css",          " #statusbar.secure{%s}",           G_STRUCT_OFFSET(Settings, status_ssl_css)},
+        {"status-ssl-invalid-css",  " #statusbar.unsecure{%s}",         G_STRUCT_OFFSET(Settings, status_ssl_invalid_css)},
     };
 
     /* For each supported style setting name */
-    for (i = 0; setting_style_map[i][0]; i++) {
-        const char *setting_name = setting_style_map[i][0];
-        const char *style_string = setting_style_map[i][1];
+    for (i = 0; i < LENGTH(setting_style_map); i++) {
+        const char *setting_name = setting_style_map[i].name;
+        const char *style_string = setting_style_map[i].css;
 
         /* If the current style setting name is the one to be updated,
          * append the given value with appropriate css wrapping to the
@@ -2748,18 +2964,19 @@ void vb_gui_style_update(Client *c, const char *setting_name_new, const char *se
         /* If the current style setting name is NOT the one being updated,
          * append the css string based on the current config setting. */
         else {
-            Setting* setting_value = (Setting*)g_hash_table_lookup(c->config.settings, setting_name);
-
-            /* If the current style setting name is not available via settings
-             * yet - this happens during setting_init() - cleanup and return.
-             * We are going to be called again. With the last setting_add(),
-             * all style setting names are available. */
-            if(!setting_value) {
+            const char *setting_value = G_STRUCT_MEMBER(char*, &c->config.settings,
+                    setting_style_map[i].offset);
+
+            /* If the current style setting is not set yet - this happens
+             * during setting_init() - cleanup and return. We are going to be
+             * called again. With the last style setting, all style settings
+             * are available. */
+            if (!setting_value) {
                 goto cleanup;
             }
 
-            if (strlen(setting_value->value.s)) {
-                g_string_append_printf(style_sheet, style_string, setting_value->value.s);
+            if (strlen(setting_value)) {
+                g_string_append_printf(style_sheet, style_string, setting_value);
             }
         }
     }
@@ -2803,13 +3020,190 @@ cleanup:
  * @webview:    Relates webview or NULL. If given a related webview is
  *              generated.
  */
+/**
+ * Create the webview of the client and pack it above the statusbar of the tab.
+ */
+static void client_attach_webview(Client *c, WebKitWebView *related)
+{
+    c->webview = webview_new(c, related);
+    c->finder = webkit_web_view_get_find_controller(c->webview);
+    g_signal_connect(c->finder, "counted-matches", G_CALLBACK(on_counted_matches), c);
+    g_signal_connect(c->webview, "user-message-received", G_CALLBACK(on_user_message_received), c);
+
+    c->page_id = webkit_web_view_get_page_id(c->webview);
+    c->webview_id = (guint64)c->webview;
+    c->inspector = webkit_web_view_get_inspector(c->webview);
+
+    gtk_box_prepend(GTK_BOX(c->tab_box), GTK_WIDGET(c->webview));
+    gtk_widget_set_vexpand(GTK_WIDGET(c->webview), TRUE);
+}
+
+/**
+ * Check if the tab could be discarded without the user losing anything.
+ */
+static gboolean tab_discardable(Client *c)
+{
+    return c->webview
+        && c != vb_get_current_client()
+        && c->mode->id == 'n'
+        && !c->state.downloads
+        && !c->state.is_fullscreen
+        && !load_scheduler_is_queued(c)
+        && !webkit_web_view_is_loading(c->webview)
+        && !webkit_web_view_is_playing_audio(c->webview);
+}
+
+/**
+ * Recreate the webview of a discarded tab and load the page shown before.
+ */
+static void tab_restore(Client *c)
+{
+    WebKitBackForwardListItem *item;
+
+    item = tab_restore_webview(c);
+
+    if (c->state.discard.load) {
+        /* A load requested while the tab was discarded replaces the page
+         * shown before. */
+        c->state.discard.load = FALSE;
+        webkit_web_view_load_uri(c->webview, c->state.uri);
+    } else if (item) {
+        /* Keep the marks and scroll position until the page is loaded. */
+        c->state.discard.restoring = TRUE;
+        webkit_web_view_go_to_back_forward_list_item(c->webview, item);
+    } else if (c->state.uri) {
+        c->state.discard.restoring = TRUE;
+        webkit_web_view_load_uri(c->webview, c->state.uri);
+    }
+}
+
+/**
+ * Recreate the webview of a discarded tab with its settings and history
+ * without loading a page.
+ *
+ * Returns the current item of the restored history or NULL.
+ */
+static WebKitBackForwardListItem *tab_restore_webview(Client *c)
+{
+    WebKitBackForwardListItem *item = NULL;
+    /* Placeholders of a restored session never had a webview and settings. */
+    gboolean init = !c->state.discard.ucm;
+
+    client_attach_webview(c, NULL);
+    gtk_box_remove(GTK_BOX(c->tab_box), c->state.discard.placeholder);
+    c->state.discard.placeholder = NULL;
+
+    if (init) {
+        tab_init(c);
+    } else {
+        webkit_web_view_set_zoom_level(c->webview, c->state.discard.zoom);
+        /* The new webview has another page id the header rules are kept
+         * for in the webextension. */
+        ext_proxy_set_header(c, c->config.settings.header);
+    }
+    if (c->state.discard.session) {
+        webkit_web_view_restore_session_state(c->webview, c->state.discard.session);
+        webkit_web_view_session_state_unref(c->state.discard.session);
+        c->state.discard.session = NULL;
+
+        item = webkit_back_forward_list_get_current_item(
+                webkit_web_view_get_back_forward_list(c->webview));
+    }
+
+    return item;
+}
+
+/**
+ * Check if the client is the placeholder of a restored session tab, that
+ * has neither webview nor settings and mode until it is restored.
+ */
+gboolean vb_tab_is_placeholder(Client *c)
+{
+    return !c->mode;
+}
+
+/**
+ * Load the uri of the discarded tab, which was set while it was discarded,
+ * once it is restored.
+ */
+void vb_tab_load_on_restore(Client *c)
+{
+    c->state.discard.load = TRUE;
+    if (c->state.discard.placeholder) {
+        gtk_label_set_text(GTK_LABEL(c->state.discard.placeholder), c->state.uri);
+    }
+}
+
+/**
+ * Show a label with the uri in place of the missing webview.
+ */
+static void tab_add_placeholder(Client *c)
+{
+    c->state.discard.placeholder = gtk_label_new(c->state.uri);
+    gtk_label_set_ellipsize(GTK_LABEL(c->state.discard.placeholder), PANGO_ELLIPSIZE_MIDDLE);
+    gtk_widget_set_vexpand(c->state.discard.placeholder, TRUE);
+    gtk_box_prepend(GTK_BOX(c->tab_box), c->state.discard.placeholder);
+}
+
+/**
+ * Free the data kept for a discarded tab.
+ */
+static void tab_discard_clear(Client *c)
+{
+    if (c->state.discard.session) {
+        webkit_web_view_session_state_unref(c->state.discard.session);
+        c->state.discard.session = NULL;
+    }
+    g_clear_object(&c->state.discard.ucm);
+    g_clear_object(&c->state.discard.settings);
+}
+
+/**
+ * Discard the tabs that where hidden longer than the tab-discard-timeout.
+ */
+static gboolean on_tab_discard_timeout(gpointer data)
+{
+    Client *c, *current;
+    gint64 now, timeout;
+
+    now     = g_get_monotonic_time();
+    timeout = (gint64)vb.config.tab_discard_timeout * G_USEC_PER_SEC;
+    current = vb_get_current_client();
+
+    for (c = vb.clients; c; c = c->next) {
+        /* The visible tab is not idle, this makes the time of the last
+         * activity available once the tab is left. */
+        if (c == current) {
+            c->state.last_active = now;
+        } else if (timeout && now - c->state.last_active > timeout) {
+            vb_tab_discard(c);
+        }
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Discard all hidden tabs if the system is low on memory.
+ */
+static void on_low_memory_warning(GMemoryMonitor *monitor,
+        GMemoryMonitorWarningLevel level, gpointer data)
+{
+    guint count = vb_tab_discard_all();
+
+    if (count) {
+        PRINT_DEBUG("low memory warning %d: discarded %u tabs", level, count);
+    }
+}
+
 static WebKitWebView *webview_new(Client *c, WebKitWebView *webview)
 {
     WebKitWebView *new;
     WebKitUserContentManager *ucm;
 
-    /* create a new webview */
-    ucm = webkit_user_content_manager_new();
+    /* create a new webview, a discarded tab brings its own content manager
+     * with the scripts, styles and filters already applied */
+    ucm = c->state.discard.ucm ? c->state.discard.ucm : webkit_user_content_manager_new();
     if (webview) {
         new = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
                     "network-session", vb.session,
@@ -2830,6 +3224,7 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview)
         "signal::create", G_CALLBACK(on_webview_create), c,
         "signal::decide-policy", G_CALLBACK(on_webview_decide_policy), c,
         "signal::load-changed", G_CALLBACK(on_webview_load_changed), c,
+        "signal::load-failed", G_CALLBACK(on_webview_load_failed), c,
         "signal::mouse-target-changed", G_CALLBACK(on_webview_mouse_target_changed), c,
         "signal::notify::estimated-load-progress", G_CALLBACK(on_webview_notify_estimated_load_progress), c,
         "signal::notify::title", G_CALLBACK(on_webview_notify_title), c,
@@ -2858,36 +3253,32 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview)
     gtk_widget_add_controller(GTK_WIDGET(new), GTK_EVENT_CONTROLLER(webview_key_controller));
     g_signal_connect(webview_key_controller, "key-pressed", G_CALLBACK(on_map_key_pressed), c);
 
+    if (c->state.discard.ucm) {
+        webkit_web_view_set_settings(new, c->state.discard.settings);
+        g_clear_object(&c->state.discard.settings);
+        g_clear_object(&c->state.discard.ucm);
+
+        return new;
+    }
+
     /* Setup script message handlers. */
     /* WebKitGTK 6.0: Third parameter specifies world name (NULL for default world) */
     webkit_user_content_manager_register_script_message_handler(ucm, "focus", NULL);
     webkit_user_content_manager_register_script_message_handler(ucm, "scroll", NULL);
     g_signal_connect(ucm, "script-message-received::focus", G_CALLBACK(on_script_message_focus), NULL);
     g_signal_connect(ucm, "script-message-received::scroll", G_CALLBACK(on_script_message_scroll), NULL);
+    perf_register_handler(ucm);
 
-    return new;
-}
-
-static void on_found_text(WebKitFindController *finder, guint count, Client *c)
-{
-    if (c->state.search.awaited_matches_updates <= 0) {
-        return;
-    }
+    user_content_add_filters(ucm);
 
-    c->state.search.matches = count;
-    c->state.search.awaited_matches_updates--;
-    vb_statusbar_update(c);
+    return new;
 }
 
-static void on_failed_to_find_text(WebKitFindController *finder, Client *c)
+static void on_counted_matches(WebKitFindController *finder, guint count, Client *c)
 {
-    if (c->state.search.awaited_matches_updates <= 0) {
-        return;
+    if (command_search_counted(c, count)) {
+        vb_statusbar_update(c);
     }
-
-    c->state.search.matches = 0;
-    c->state.search.awaited_matches_updates--;
-    vb_statusbar_update(c);
 }
 
 static gboolean on_user_message_received(WebKitWebView *webview, WebKitUserMessage *message, Client *c)
@@ -2930,21 +3321,29 @@ static gboolean on_user_message_received(WebKitWebView *webview, WebKitUserMessa
     return TRUE;
 }
 
-/* Helper callback to store dialog response */
-static void on_dialog_response(GtkDialog *dialog, gint response_id, gpointer user_data)
+/**
+ * Decide the permission request by the answer given in the dialog.
+ */
+static void on_permission_dialog_response(GtkDialog *dialog, gint response_id,
+        WebKitPermissionRequest *request)
 {
-    g_object_set_data(G_OBJECT(dialog), "response", GINT_TO_POINTER(response_id));
+    if (GTK_RESPONSE_YES == response_id) {
+        webkit_permission_request_allow(request);
+    } else {
+        webkit_permission_request_deny(request);
+    }
+    g_object_unref(request);
+    gtk_window_destroy(GTK_WINDOW(dialog));
 }
 
 static gboolean on_permission_request(WebKitWebView *webview,
         WebKitPermissionRequest *request, Client *c)
 {
     GtkWidget *dialog;
-    int result;
     char *msg = NULL;
 
     if (WEBKIT_IS_GEOLOCATION_PERMISSION_REQUEST(request)) {
-        char* geolocation_setting = GET_CHAR(c, "geolocation");
+        char* geolocation_setting = c->config.settings.geolocation;
         if (strcmp(geolocation_setting, "ask") == 0) {
             msg = "access your location";
         } else if (strcmp(geolocation_setting, "always") == 0) {
@@ -2961,7 +3360,7 @@ static gboolean on_permission_request(WebKitWebView *webview,
             msg = "access you webcam";
         }
     } else if (WEBKIT_IS_NOTIFICATION_PERMISSION_REQUEST(request)) {
-        char* notification_setting = GET_CHAR(c, "notification");
+        char* notification_setting = c->config.settings.notification;
         if (strcmp(notification_setting, "ask") == 0) {
             msg = "show notifications";
         } else if (strcmp(notification_setting, "always") == 0) {
@@ -2988,22 +3387,10 @@ static gboolean on_permission_request(WebKitWebView *webview,
     /* GTK4: Use gtk_widget_set_visible instead of gtk_widget_show */
     gtk_widget_set_visible(dialog, TRUE);
 
-    /* Create a simple event loop to wait for response */
-    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
-    g_signal_connect(dialog, "response", G_CALLBACK(on_dialog_response), NULL);
-    g_signal_connect_swapped(dialog, "response", G_CALLBACK(g_main_loop_quit), loop);
-    g_main_loop_run(loop);
-    g_main_loop_unref(loop);
-
-    /* Get the response (stored as data on the dialog) */
-    result = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(dialog), "response"));
-
-    if (GTK_RESPONSE_YES == result) {
-        webkit_permission_request_allow(request);
-    } else {
-        webkit_permission_request_deny(request);
-    }
-    gtk_window_destroy(GTK_WINDOW(dialog));
+    /* the request is decided when the dialog is answered, a reference keeps
+     * it alive until then */
+    g_signal_connect(dialog, "response", G_CALLBACK(on_permission_dialog_response),
+            g_object_ref(request));
 
     return TRUE;
 }
@@ -3020,7 +3407,7 @@ static gboolean on_scroll(GtkEventControllerScroll *controller, gdouble dx, gdou
     }
 
     /* Get scroll multiplier from config (default is 1) */
-    multiplier = (gdouble)c->config.scrollmultiplier;
+    multiplier = (gdouble)c->config.settings.scroll_multiplier;
 
     /* If multiplier is 1, allow normal scrolling */
     if (multiplier == 1.0) {
@@ -3065,8 +3452,7 @@ static void on_script_message_focus(WebKitUserContentManager *manager,
      * Since user scripts don't have easy access to the page ID,
      * we find the client by matching the UCM that sent the message. */
     for (c = vb.clients; c; c = c->next) {
-        WebKitUserContentManager *ucm = webkit_web_view_get_user_content_manager(c->webview);
-        if (ucm == manager) {
+        if (vb_get_user_content_manager(c) == manager) {
             break;
         }
     }
@@ -3084,9 +3470,28 @@ static void on_script_message_focus(WebKitUserContentManager *manager,
     }
 }
 
+/**
+ * Apply a scroll state of the form [max, percent, top] to the client.
+ * Returns TRUE if the displayed part of the state has changed.
+ */
+static gboolean scroll_state_set(Client *c, guint64 max, guint percent, guint64 top)
+{
+    gboolean changed;
+
+    changed = c->state.scroll_max != max || c->state.scroll_percent != percent;
+
+    c->state.scroll_max     = max;
+    c->state.scroll_percent = percent;
+    c->state.scroll_top     = top;
+
+    return changed;
+}
+
 /**
  * Callback for scroll position messages from injected JavaScript.
- * Updates the scroll percentage display in the statusbar.
+ * The script posts a compact [max, percent, top] array at most once per
+ * animation frame and only if the state has changed. The statusbar is only
+ * updated if the percent or the max has changed.
  */
 static void on_script_message_scroll(WebKitUserContentManager *manager,
         JSCValue *value, gpointer data)
@@ -3094,35 +3499,50 @@ static void on_script_message_scroll(WebKitUserContentManager *manager,
     JSCValue *max_val, *percent_val, *top_val;
     Client *c;
 
-    if (!jsc_value_is_object(value)) {
-        return;
-    }
-
-    /* Extract the scroll data from the JavaScript object */
-    max_val = jsc_value_object_get_property(value, "max");
-    percent_val = jsc_value_object_get_property(value, "percent");
-    top_val = jsc_value_object_get_property(value, "top");
-
-    if (!max_val || !percent_val || !top_val) {
+    if (!jsc_value_is_array(value)) {
         return;
     }
 
     /* Find the client for this webview
      * Since we don't have page_id in the message, we need to find it differently */
     for (c = vb.clients; c; c = c->next) {
-        WebKitUserContentManager *ucm = webkit_web_view_get_user_content_manager(
-            WEBKIT_WEB_VIEW(c->webview));
-        if (ucm == manager) {
-            /* Update scroll state */
-            c->state.scroll_max = jsc_value_to_double(max_val);
-            c->state.scroll_percent = jsc_value_to_int32(percent_val);
-            c->state.scroll_top = jsc_value_to_double(top_val);
-
-            /* Update the statusbar */
-            vb_statusbar_update(c);
+        if (vb_get_user_content_manager(c) == manager) {
             break;
         }
     }
+    if (!c) {
+        return;
+    }
+
+    max_val     = jsc_value_object_get_property_at_index(value, 0);
+    percent_val = jsc_value_object_get_property_at_index(value, 1);
+    top_val     = jsc_value_object_get_property_at_index(value, 2);
+
+    if (scroll_state_set(c,
+            jsc_value_to_double(max_val),
+            jsc_value_to_int32(percent_val),
+            jsc_value_to_double(top_val))) {
+        vb_statusbar_update(c);
+    }
+
+    g_object_unref(max_val);
+    g_object_unref(percent_val);
+    g_object_unref(top_val);
+}
+
+/**
+ * Apply a scroll state pulled from the page by vbScrollState() in the form
+ * "max percent top".
+ */
+void vb_scroll_state_update(Client *c, const char *state)
+{
+    guint64 max, top;
+    guint percent;
+
+    if (sscanf(state, "%" G_GUINT64_FORMAT " %u %" G_GUINT64_FORMAT, &max, &percent, &top) == 3
+        && scroll_state_set(c, max, percent, top)) {
+        vb_statusbar_update(c);
+    }
 }
 
 static gboolean profileOptionArgFunc(const gchar *option_name,
@@ -3148,19 +3568,27 @@ int main(int argc, char* argv[])
 #ifndef FEATURE_NO_XEMBED
     char *winid = NULL;
 #endif
-    gboolean ver = FALSE, buginfo = FALSE;
+    gboolean ver = FALSE, buginfo = FALSE, restore = FALSE, server = FALSE;
+    char *bench_file = NULL, *bench_report = NULL, *control_path = NULL;
+    int bench_jobs = 1;
 
     GOptionEntry opts[] = {
         {"cmd", 'C', 0, G_OPTION_ARG_CALLBACK, (GOptionArgFunc*)autocmdOptionArgFunc, "Ex command run before first page is loaded", NULL},
         {"config", 'c', 0, G_OPTION_ARG_FILENAME, &vb.configfile, "Custom configuration file", NULL},
+        {"control", 0, 0, G_OPTION_ARG_FILENAME, &control_path, "Run ex commands received on the unix socket FILE", "FILE"},
 #ifndef FEATURE_NO_XEMBED
         {"embed", 'e', 0, G_OPTION_ARG_STRING, &winid, "Reparents to window specified by xid", NULL},
 #endif
         {"incognito", 'i', 0, G_OPTION_ARG_NONE, &vb.incognito, "Run with user data read-only", NULL},
         {"profile", 'p', 0, G_OPTION_ARG_CALLBACK, (GOptionArgFunc*)profileOptionArgFunc, "Profile name", NULL},
+        {"restore", 'r', 0, G_OPTION_ARG_NONE, &restore, "Restore the tabs of the last session", NULL},
+        {"server", 0, 0, G_OPTION_ARG_NONE, &server, "Open the URI in a running instance or become that instance", NULL},
         {"version", 'v', 0, G_OPTION_ARG_NONE, &ver, "Print version", NULL},
         {"no-maximize", 0, 0, G_OPTION_ARG_NONE, &vb.no_maximize, "Do no attempt to maximize window", NULL},
         {"bug-info", 0, 0, G_OPTION_ARG_NONE, &buginfo, "Print used library versions", NULL},
+        {"bench-load", 0, 0, G_OPTION_ARG_FILENAME, &bench_file, "Load the URIs listed in FILE, write a report and quit", "FILE"},
+        {"bench-jobs", 0, 0, G_OPTION_ARG_INT, &bench_jobs, "Number of tabs used by --bench-load", "N"},
+        {"bench-report", 0, 0, G_OPTION_ARG_FILENAME, &bench_report, "Write the --bench-load report to FILE, as JSON if it ends in .json", "FILE"},
         {NULL}
     };
 
@@ -3178,6 +3606,13 @@ int main(int argc, char* argv[])
     }
     g_option_context_free(opt_context);
 
+    /* Hand the URI over to an instance running in server mode. This is done
+     * before GTK is initialized to keep such invocations short. */
+    if (server && !bench_file && !(argc > 1 && !strcmp(argv[argc - 1], "-"))
+        && server_forward(argc > 1 ? argv[argc - 1] : NULL, vb.cmdargs)) {
+        return EXIT_SUCCESS;
+    }
+
     /* initialize GTK+ */
     gtk_init();
 
@@ -3234,6 +3669,21 @@ int main(int argc, char* argv[])
 
     vimb_setup();
 
+    /* A benchmark must not replace the session of the user nor add its
+     * uris to the history or the perf log. The history is kept in memory
+     * only, so that its handler still takes part in the loads. */
+    if (bench_file) {
+        char *dir = g_path_get_dirname(file_storage_get_path(vb.storage[STORAGE_HISTORY]));
+
+        g_clear_pointer(&vb.files[FILES_SESSION], g_free);
+        g_clear_pointer(&vb.files[FILES_CLOSED], g_free);
+        g_clear_pointer(&vb.files[FILES_PERF], g_free);
+        file_storage_free(vb.storage[STORAGE_HISTORY]);
+        vb.storage[STORAGE_HISTORY] = file_storage_new(dir, "history", TRUE);
+        g_free(dir);
+        restore = FALSE;
+    }
+
 /* GTK4: XEmbed not supported */
 /* #ifndef FEATURE_NO_XEMBED */
 /*     if (winid) { */
@@ -3241,29 +3691,56 @@ int main(int argc, char* argv[])
 /*     } */
 /* #endif */
 
-    c = client_new(NULL);
-    client_show(NULL, c);
+    /* Restore the tabs of the last session, only the active tab is loaded. */
+    if (restore && argc <= 1 && session_restore()) {
+        c = vb_get_current_client();
+    } else {
+        restore = FALSE;
+        c = client_new(NULL);
+        client_show(NULL, c);
+    }
+
+    if (server && !bench_file && !server_start(&err)) {
+        fprintf(stderr, "can't start server: %s\n", err->message);
+        g_clear_error(&err);
+    }
+
+    if (control_path && !control_start(control_path, &err)) {
+        fprintf(stderr, "can't start control socket: %s\n", err->message);
+        g_clear_error(&err);
+    }
 
     /* process the --cmd if this was given */
     for (GSList *l = vb.cmdargs; l; l = l->next) {
         ex_run_string(c, l->data, false);
     }
-    if (argc <= 1) {
-        vb_load_uri(c, &(Arg){TARGET_CURRENT, NULL});
-    } else if (!strcmp(argv[argc - 1], "-")) {
-        /* read from stdin if uri is - */
-        read_from_stdin(c);
-    } else {
-        vb_load_uri(c, &(Arg){TARGET_CURRENT, argv[argc - 1]});
+    if (bench_file) {
+        if (!bench_load_start(c, bench_file, bench_jobs, bench_report, &err)) {
+            fprintf(stderr, "can't run benchmark: %s\n", err->message);
+            g_error_free(err);
+            return EXIT_FAILURE;
+        }
+    } else if (!restore) {
+        /* the restored tabs are already loading the pages of the session */
+        if (argc <= 1) {
+            vb_load_uri(c, &(Arg){TARGET_CURRENT, NULL});
+        } else if (!strcmp(argv[argc - 1], "-")) {
+            /* read from stdin if uri is - */
+            read_from_stdin(c);
+        } else {
+            vb_load_uri(c, &(Arg){TARGET_CURRENT, argv[argc - 1]});
+        }
     }
 
     /* GTK4: Use GMainLoop instead of gtk_main */
     main_loop = g_main_loop_new(NULL, FALSE);
     g_main_loop_run(main_loop);
     g_main_loop_unref(main_loop);
+    server_cleanup();
+    control_cleanup();
 #ifdef FREE_ON_QUIT
     vimb_cleanup();
 #endif
 
-    return EXIT_SUCCESS;
+    return bench_file ? bench_load_status() : EXIT_SUCCESS;
 }
@@ -37,9 +37,6 @@
 #define LENGTH(x) (sizeof x / sizeof x[0])
 #define OVERWRITE_STRING(t, s) {if (t) g_free(t); t = g_strdup(s);}
 #define OVERWRITE_NSTRING(t, s, l) {if (t) {g_free(t); t = NULL;} t = g_strndup(s, l);}
-#define GET_CHAR(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.s)
-#define GET_INT(c, n)   (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.i)
-#define GET_BOOL(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.b)
 
 
 #ifdef DEBUG
@@ -114,8 +111,10 @@ enum {
     FILES_CLOSED,
     FILES_CONFIG,
     FILES_COOKIE,
+    FILES_PERF,
     FILES_QUEUE,
     FILES_SCRIPT,
+    FILES_SESSION,
     FILES_USER_STYLE,
     FILES_LAST
 };
@@ -129,6 +128,13 @@ enum {
     STORAGE_LAST
 };
 
+/* where pages opened as new window by links or scripts are shown */
+typedef enum {
+    NEW_WINDOW_TAB,
+    NEW_WINDOW_BACKGROUND,
+    NEW_WINDOW_PROCESS,
+} NewWindowTarget;
+
 typedef enum {
     LINK_TYPE_NONE,
     LINK_TYPE_LINK,
@@ -150,20 +156,25 @@ struct Arg {
 };
 
 typedef int (*SettingFunction)(Client *c, const char *name, DataType type, void *value, void *data);
-typedef union {
-    gboolean b;
-    int      i;
-    char     *s;
-} SettingValue;
 
+/* Identifies a setting, one for each entry in setting-table.h. */
+typedef enum {
+#define SETTING(id, field, name, type, def, setter, flags, data) SET_##id,
+#include "setting-table.h"
+#undef SETTING
+    SET_COUNT
+} SettingId;
+
+#define SETTING_CTYPE_TYPE_BOOLEAN  gboolean
+#define SETTING_CTYPE_TYPE_INTEGER  int
+#define SETTING_CTYPE_TYPE_CHAR     char*
+
+/* The values of all settings of a client. */
 typedef struct {
-    const char      *name;
-    int             type;
-    SettingValue    value;
-    SettingFunction setter;
-    int             flags;
-    void            *data;  /* data given to the setter */
-} Setting;
+#define SETTING(id, field, name, type, def, setter, flags, data) SETTING_CTYPE_##type field;
+#include "setting-table.h"
+#undef SETTING
+} Settings;
 
 struct State {
     char                *uri;
@@ -192,13 +203,31 @@ struct State {
     guint               progress;
     WebKitHitTestResult *hit_test_result;
     gboolean            is_fullscreen;
+    gint64              last_active;        /* monotonic time the tab was visible the last time */
+
+    struct {
+        WebKitWebViewSessionState *session; /* back forward list of the destroyed webview */
+        WebKitUserContentManager  *ucm;     /* reused by the restored webview */
+        WebKitSettings            *settings;
+        double                    zoom;
+        guint64                   scroll_top; /* position to restore after load */
+        gboolean                  restoring;  /* keep marks and scroll position until loaded */
+        GtkWidget                 *placeholder; /* shown instead of the webview */
+        gboolean                  load;       /* load state.uri instead of the page shown before */
+    } discard;
 
     struct {
         gboolean    active;                  /* indicate if there is a active search */
         short       direction;               /* last direction 1 forward, -1 backward */
-        int         matches;                 /* number of matching search results */
-        int         awaited_matches_updates;
+        guint       matches;                 /* number of matching search results */
         char        *last_query;             /* last search query */
+        guint       max;                     /* match limit of the last search */
+        guint       generation;              /* increased with each search */
+        GQueue      counts;                  /* generations of the requested match counts */
+        guint       count_source;            /* idle source requesting the match count */
+        char        *pending;                /* incsearch query that waits for the delay */
+        short       pending_direction;
+        guint       pending_source;          /* timeout source starting the incsearch */
     } search;
     struct {
         guint64         pos;
@@ -256,18 +285,9 @@ struct Client {
     /* WebKitGTK 6.0: dbusproxy and dbusserver removed - using WebKitUserMessage */
     Handler             *handler;               /* the protocoll handlers */
     struct {
-        /* TODO split in global setting definitions and set values on a per
-         * client base. */
-        GHashTable              *settings;
-        guint                   scrollstep;
-        guint                   scrollmultiplier;
-        gboolean                input_autohide;
-        gboolean                incsearch;
-        gboolean                prevent_newwindow;
-        guint                   default_zoom;   /* default zoom level in percent */
+        Settings                settings;
+        NewWindowTarget         new_window;
         Shortcut                *shortcuts;
-        gboolean                statusbar_show_settings;
-        gboolean                smooth_scrolling;
         regex_t                 histignore_preg;
     } config;
     struct {
@@ -302,6 +322,7 @@ struct Vimb {
     struct {
         guint   history_max;
         guint   closed_max;
+        guint   tab_discard_timeout;  /* seconds until hidden tabs are discarded */
     } config;
     GtkCssProvider *style_provider;
     gboolean    no_maximize;
@@ -339,16 +360,25 @@ gboolean vb_quit_all(gboolean force);
 void vb_register_add(Client *c, char buf, const char *value);
 const char *vb_register_get(Client *c, char buf);
 void vb_statusbar_update(Client *c);
+void vb_scroll_state_update(Client *c, const char *state);
 void vb_statusbar_show_hover_url(Client *c, VbLinkType type, const char *uri);
 void vb_gui_style_update(Client *c, const char *name, const char *value);
 
 /* Tab management functions */
 Client *vb_tab_new(Client *related, const char *uri);
+Client *vb_tab_new_placeholder(const char *uri, const char *title,
+        WebKitWebViewSessionState *session);
 void vb_tab_close(Client *c);
 void vb_tab_next(void);
 void vb_tab_prev(void);
 void vb_tab_goto(int n);
+gboolean vb_tab_discard(Client *c);
+gboolean vb_tab_is_placeholder(Client *c);
+void vb_tab_load_on_restore(Client *c);
+guint vb_tab_discard_all(void);
+WebKitUserContentManager *vb_get_user_content_manager(Client *c);
 Client *vb_get_current_client(void);
+Client *vb_get_client_for_tab(int page_num);
 int vb_get_tab_count(void);
 
 #endif /* end of include guard: _MAIN_H */
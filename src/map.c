@@ -25,6 +25,7 @@
 #include "config.h"
 #include "main.h"
 #include "map.h"
+#include "trace.h"
 #include "util.h"
 
 static char *convert_keylabel(const char *in, int inlen, int *len);
@@ -138,6 +139,8 @@ MapState map_handle_keys(Client *c, const guchar *keys, int keylen, gboolean use
     gboolean timeout = (keylen == 0); /* keylen 0 signalized timeout */
     static int showlen = 0;           /* track the number of keys in showcmd of status bar */
 
+    trace_begin("map_handle_keys");
+
     /* if a previous timeout function was set remove this */
     if (c->map.timout_id) {
         g_source_remove(c->map.timout_id);
@@ -201,6 +204,7 @@ MapState map_handle_keys(Client *c, const guchar *keys, int keylen, gboolean use
         /* if all keys where processed return MAP_DONE */
         if (c->map.qlen == 0) {
             c->map.resolved = 0;
+            trace_end("map_handle_keys");
             return match ? MAP_DONE : MAP_NOMATCH;
         }
 
@@ -242,6 +246,7 @@ MapState map_handle_keys(Client *c, const guchar *keys, int keylen, gboolean use
             /* if there are ambiguous matches return MAP_AMBIGUOUS and flush queue
              * after a timeout if the user do not type more keys */
             if (ambiguous) {
+                trace_end("map_handle_keys");
                 return MAP_AMBIGUOUS;
             }
         }
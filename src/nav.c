@@ -0,0 +1,210 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Each navigation of a client gets a context that holds its uri parsed once
+ * into the parts the load handlers need. The context is created when the
+ * navigation is decided and is used by the following load events as long as
+ * the uri of the webview is the same, so the autocmds, the histignore check,
+ * the handlers, the site profiles and the history don't parse and sanitize
+ * the uri each on their own.
+ *
+ * The navigation policy is also decided for subframes, so a decided context
+ * is only kept as pending and becomes the current one of the client once a
+ * load event of the main frame asks for its uri.
+ */
+#include <glib.h>
+#include <string.h>
+
+#include "main.h"
+#include "nav.h"
+#include "util.h"
+
+typedef struct {
+    NavContext  *current;   /* navigation of the main frame */
+    NavContext  *pending;   /* last decided navigation of any frame */
+} NavClient;
+
+static struct {
+    GHashTable  *clients;   /* Client* -> NavClient* */
+} nav;
+
+static NavClient *client_get(Client *c);
+static void client_free(NavClient *nc);
+static NavContext *context_new(const char *uri);
+
+
+/**
+ * Creates the context for a decided navigation of the client to the uri.
+ * The context replaces the pending one of the client, the current one is
+ * kept until a load of the main frame takes the new context over by
+ * nav_get().
+ */
+NavContext *nav_begin(Client *c, const char *uri)
+{
+    NavClient *nc = client_get(c);
+
+    if (nc->pending) {
+        nav_unref(nc->pending);
+    }
+    nc->pending = context_new(uri);
+
+    return nc->pending;
+}
+
+/**
+ * Returns the context of the current navigation of the client for the uri of
+ * the main frame. The pending context is taken over if it was decided for
+ * the uri, else a new one is created if the uri differs from that of the
+ * current navigation, like after a redirect. Returns NULL if uri is NULL.
+ */
+NavContext *nav_get(Client *c, const char *uri)
+{
+    NavClient *nc;
+
+    if (!uri) {
+        return NULL;
+    }
+    nc = client_get(c);
+    if (nc->current && !strcmp(nc->current->uri, uri)) {
+        return nc->current;
+    }
+    if (nc->current) {
+        nav_unref(nc->current);
+    }
+    if (nc->pending && !strcmp(nc->pending->uri, uri)) {
+        nc->current = nc->pending;
+        nc->pending = NULL;
+    } else {
+        nc->current = context_new(uri);
+    }
+
+    return nc->current;
+}
+
+/**
+ * Keeps the context alive for callers that run ex commands, which may start
+ * a new navigation of the client.
+ */
+NavContext *nav_ref(NavContext *ctx)
+{
+    ctx->ref++;
+
+    return ctx;
+}
+
+void nav_unref(NavContext *ctx)
+{
+    if (--ctx->ref) {
+        return;
+    }
+    g_hash_table_destroy(ctx->matches);
+    g_free(ctx->uri);
+    g_free(ctx->display);
+    g_free(ctx->host);
+    g_free(ctx->path);
+    g_slice_free(NavContext, ctx);
+}
+
+/**
+ * Matches the uri of the navigation against an autocmd pattern. The results
+ * are kept for the navigation, so each pattern is matched once although the
+ * autocmds run on several load events.
+ */
+gboolean nav_wildmatch(NavContext *ctx, const char *pattern)
+{
+    gpointer result;
+    gboolean match;
+
+    if (g_hash_table_lookup_extended(ctx->matches, pattern, NULL, &result)) {
+        return GPOINTER_TO_INT(result);
+    }
+
+    match = util_wildmatch(pattern, ctx->uri);
+    g_hash_table_insert(ctx->matches, g_strdup(pattern), GINT_TO_POINTER(match));
+
+    return match;
+}
+
+void nav_client_remove(Client *c)
+{
+    if (nav.clients) {
+        g_hash_table_remove(nav.clients, c);
+    }
+}
+
+void nav_cleanup(void)
+{
+    if (nav.clients) {
+        g_hash_table_destroy(nav.clients);
+        nav.clients = NULL;
+    }
+}
+
+static NavClient *client_get(Client *c)
+{
+    NavClient *nc;
+
+    if (!nav.clients) {
+        nav.clients = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)client_free);
+    }
+    if (!(nc = g_hash_table_lookup(nav.clients, c))) {
+        nc = g_slice_new0(NavClient);
+        g_hash_table_insert(nav.clients, c, nc);
+    }
+
+    return nc;
+}
+
+static void client_free(NavClient *nc)
+{
+    if (nc->current) {
+        nav_unref(nc->current);
+    }
+    if (nc->pending) {
+        nav_unref(nc->pending);
+    }
+    g_slice_free(NavClient, nc);
+}
+
+static NavContext *context_new(const char *uri)
+{
+    NavContext *ctx;
+    GUri *parsed;
+
+    ctx          = g_slice_new0(NavContext);
+    ctx->ref     = 1;
+    ctx->uri     = g_strdup(uri);
+    ctx->display = util_sanitize_uri(uri);
+    ctx->matches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    if ((parsed = g_uri_parse(uri, G_URI_FLAGS_NONE, NULL))) {
+        ctx->scheme = g_intern_string(g_uri_get_scheme(parsed));
+        if (g_uri_get_host(parsed)) {
+            ctx->host = g_ascii_strdown(g_uri_get_host(parsed), -1);
+        }
+        ctx->path = g_strdup(g_uri_get_path(parsed));
+        g_uri_unref(parsed);
+    } else {
+        ctx->scheme = g_uri_peek_scheme(uri);
+    }
+
+    return ctx;
+}
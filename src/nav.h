@@ -0,0 +1,46 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _NAV_H
+#define _NAV_H
+
+#include <glib.h>
+
+#include "main.h"
+
+/* The parsed uri of a navigation, shared by the handlers of its load events. */
+typedef struct {
+    int         ref;
+    char        *uri;       /* uri as given by webkit */
+    char        *display;   /* uri without password for display and history */
+    const char  *scheme;    /* interned lower case scheme or NULL */
+    char        *host;      /* lower case host or NULL */
+    char        *path;
+    GHashTable  *matches;   /* autocmd pattern -> result of the match */
+} NavContext;
+
+NavContext *nav_begin(Client *c, const char *uri);
+NavContext *nav_get(Client *c, const char *uri);
+NavContext *nav_ref(NavContext *ctx);
+void nav_unref(NavContext *ctx);
+gboolean nav_wildmatch(NavContext *ctx, const char *pattern);
+void nav_client_remove(Client *c);
+void nav_cleanup(void);
+
+#endif /* end of include guard: _NAV_H */
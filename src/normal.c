@@ -22,13 +22,16 @@
 #include <string.h>
 
 #include "ascii.h"
+#include "async.h"
 #include "command.h"
 #include "config.h"
+#include "ex.h"
 #include "hints.h"
 #include "ext-proxy.h"
 #include "main.h"
 #include "normal.h"
 #include "scripts/scripts.h"
+#include "session.h"
 #include "util.h"
 #include "ext-proxy.h"
 
@@ -58,16 +61,20 @@ static VbResult normal_descent(Client *c, const NormalCmdInfo *info);
 static VbResult normal_ex(Client *c, const NormalCmdInfo *info);
 static VbResult normal_fire(Client *c, const NormalCmdInfo *info);
 static VbResult normal_focus_last_active(Client *c, const NormalCmdInfo *info);
+static void focus_last_active(Client *c, const char *result, gpointer data);
 static VbResult normal_g_cmd(Client *c, const NormalCmdInfo *info);
 static VbResult normal_hint(Client *c, const NormalCmdInfo *info);
 static VbResult normal_do_hint(Client *c, const char *prompt);
 static VbResult normal_increment_decrement(Client *c, const NormalCmdInfo *info);
 static VbResult normal_input_open(Client *c, const NormalCmdInfo *info);
 static VbResult normal_mark(Client *c, const NormalCmdInfo *info);
+static void mark_resume(Client *c, const char *state, gpointer data);
 static void jump (Client *c, const guint64 p);
 static void jump_after_load(WebKitWebView *webview, WebKitLoadEvent event, Client *c);
 static VbResult normal_navigate(Client *c, const NormalCmdInfo *info);
 static VbResult normal_open_clipboard(Client *c, const NormalCmdInfo *info);
+static void open_primary(Client *c, const char *text, gpointer data);
+static void open_text(Client *c, const char *text, gpointer data);
 static VbResult normal_open(Client *c, const NormalCmdInfo *info);
 static VbResult normal_pass(Client *c, const NormalCmdInfo *info);
 static VbResult normal_prevnext(Client *c, const NormalCmdInfo *info);
@@ -76,6 +83,7 @@ static VbResult normal_quit(Client *c, const NormalCmdInfo *info);
 static VbResult normal_scroll(Client *c, const NormalCmdInfo *info);
 static VbResult normal_search(Client *c, const NormalCmdInfo *info);
 static VbResult normal_search_selection(Client *c, const NormalCmdInfo *info);
+static void search_text(Client *c, const char *text, gpointer data);
 static VbResult normal_view_inspector(Client *c, const NormalCmdInfo *info);
 static VbResult normal_view_source(Client *c, const NormalCmdInfo *info);
 static void normal_view_source_loaded(WebKitWebResource *resource, GAsyncResult *res, Client *c);
@@ -449,27 +457,23 @@ static VbResult normal_fire(Client *c, const NormalCmdInfo *info)
 
 static VbResult normal_focus_last_active(Client *c, const NormalCmdInfo *info)
 {
-    GVariant *variant;
-    gboolean success;
-    char *script_result;
+    async_eval(c,
+        "if (typeof vimb_input_mode_element !== 'undefined' && vimb_input_mode_element) { vimb_input_mode_element.focus(); 1; } else 0;",
+        focus_last_active, NULL, NULL);
 
-    variant = ext_proxy_eval_script_sync(c,
-        "if (typeof vimb_input_mode_element !== 'undefined' && vimb_input_mode_element) { vimb_input_mode_element.focus(); 1; } else 0;");
-    if (variant == NULL) {
-        g_warning("cannot set focus on the last focused element: failed to evaluate js");
-        return RESULT_ERROR;
-    }
-    g_variant_get(variant, "(bs)", &success, &script_result);
-    g_variant_unref(variant);
-    if (!success) {
-        return RESULT_ERROR;
-    }
+    return RESULT_COMPLETE;
+}
 
-    if (*script_result == '0') {
+/**
+ * Focus the first input element if there was no last focused one.
+ */
+static void focus_last_active(Client *c, const char *result, gpointer data)
+{
+    if (!result) {
+        g_warning("cannot set focus on the last focused element: failed to evaluate js");
+    } else if (*result == '0') {
         ext_proxy_focus_input(c);
     }
-
-    return RESULT_COMPLETE;
 }
 
 static VbResult normal_g_cmd(Client *c, const NormalCmdInfo *info)
@@ -594,30 +598,59 @@ static void jump_after_load(WebKitWebView *webview, WebKitLoadEvent event, Clien
 }
 
 static VbResult normal_mark(Client *c, const NormalCmdInfo *info)
+{
+    char *mark;
+
+    /* check if the second char is a valid mark char */
+    if (!(mark = strchr(MARK_CHARS, info->key2)) && !(mark = strchr(GLOBAL_MARK_CHARS, info->key2))) {
+        return RESULT_ERROR;
+    }
+
+    /* check if the mark to jump to was set */
+    if ('m' != info->key
+        && (islower(*mark)
+            ? (int)(c->state.marks[mark - MARK_CHARS] - .5) < 0
+            : !c->state.global_marks[mark - GLOBAL_MARK_CHARS].uri)) {
+        return RESULT_ERROR;
+    }
+
+    /* The page posts its scroll position at most once per frame, so get the
+     * exact one before it is stored or used as last position. */
+    async_eval(c, "typeof vbScrollState === 'function' ? vbScrollState().join(' ') : ''",
+            mark_resume, GINT_TO_POINTER(info->key << 8 | info->key2), NULL);
+
+    return RESULT_COMPLETE;
+}
+
+/**
+ * Sets or jumps to the mark after the scroll state of the page arrived.
+ */
+static void mark_resume(Client *c, const char *state, gpointer data)
 {
     guint64 current_pos;
     char *current_uri;
     char *mark;
     Arg *arg;
     int idx;
+    char key  = GPOINTER_TO_INT(data) >> 8;
+    char key2 = GPOINTER_TO_INT(data) & 0xff;
 
-    /* check if the second char is a valid mark char */
-    if (!(mark = strchr(MARK_CHARS, info->key2)) && !(mark = strchr(GLOBAL_MARK_CHARS, info->key2))) {
-        return RESULT_ERROR;
+    if (state) {
+        vb_scroll_state_update(c, state);
+    }
+
+    if (!(mark = strchr(MARK_CHARS, key2))) {
+        mark = strchr(GLOBAL_MARK_CHARS, key2);
     }
 
     if (islower(*mark)) {
         /* get the index of the mark char */
         idx = mark - MARK_CHARS;
 
-        if ('m' == info->key) {
+        if ('m' == key) {
             c->state.marks[idx] = c->state.scroll_top;
+            session_save();
         } else {
-            /* check if the mark was set */
-            if ((int)(c->state.marks[idx] - .5) < 0) {
-                return RESULT_ERROR;
-            }
-
             current_pos = c->state.scroll_top;
             jump(c, c->state.marks[idx]);
 
@@ -628,16 +661,11 @@ static VbResult normal_mark(Client *c, const NormalCmdInfo *info)
         /* get the index of the mark char */
         idx = mark - GLOBAL_MARK_CHARS;
 
-        if ('m' == info->key) {
+        if ('m' == key) {
             g_free(c->state.global_marks[idx].uri);
             c->state.global_marks[idx].pos = c->state.scroll_top;
             c->state.global_marks[idx].uri = g_strdup(c->state.uri);
         } else {
-            /* check if the mark was set */
-            if (!c->state.global_marks[idx].uri) {
-                return RESULT_ERROR;
-            }
-
             current_pos = c->state.scroll_top;
             current_uri = c->state.uri;
 
@@ -658,8 +686,6 @@ static VbResult normal_mark(Client *c, const NormalCmdInfo *info)
             c->state.global_marks[MARK_TICK].uri = g_strdup(current_uri);
         }
     }
-
-    return RESULT_COMPLETE;
 }
 
 static VbResult normal_navigate(Client *c, const NormalCmdInfo *info)
@@ -697,7 +723,11 @@ static VbResult normal_navigate(Client *c, const NormalCmdInfo *info)
             break;
 
         case CTRL('C'):
-            webkit_web_view_stop_loading(view);
+            /* interrupt running shell commands first and the page loading
+             * only if there was nothing else to cancel */
+            if (!ex_shell_cancel(c)) {
+                webkit_web_view_stop_loading(view);
+            }
             break;
     }
 
@@ -706,27 +736,44 @@ static VbResult normal_navigate(Client *c, const NormalCmdInfo *info)
 
 static VbResult normal_open_clipboard(Client *c, const NormalCmdInfo *info)
 {
-    Arg a = {info->key == 'P' ? TARGET_TAB : TARGET_CURRENT};
+    gpointer target = GINT_TO_POINTER(info->key == 'P' ? TARGET_TAB : TARGET_CURRENT);
+    const char *text;
 
     /* if register is not the default - read out of the internal register */
     if (info->reg) {
-        a.s = g_strdup(vb_register_get(c, info->reg));
+        if (!(text = vb_register_get(c, info->reg))) {
+            return RESULT_ERROR;
+        }
+        open_text(c, text, target);
     } else {
         /* if no register is given use the system clipboard */
-        a.s = util_clipboard_get_text(GTK_WIDGET(c->webview), TRUE);
-        if (!a.s) {
-            a.s = util_clipboard_get_text(GTK_WIDGET(c->webview), FALSE);
-        }
+        async_clipboard(c, TRUE, open_primary, target, NULL);
     }
 
-    if (a.s) {
-        vb_load_uri(c, &a);
-        g_free(a.s);
+    return RESULT_COMPLETE;
+}
 
-        return RESULT_COMPLETE;
+/**
+ * Open the primary selection or the clipboard if the selection is empty.
+ */
+static void open_primary(Client *c, const char *text, gpointer data)
+{
+    if (text) {
+        open_text(c, text, data);
+    } else {
+        async_clipboard(c, FALSE, open_text, data, NULL);
     }
+}
 
-    return RESULT_ERROR;
+static void open_text(Client *c, const char *text, gpointer data)
+{
+    Arg a = {GPOINTER_TO_INT(data)};
+
+    if (text) {
+        a.s = g_strdup(text);
+        vb_load_uri(c, &a);
+        g_free(a.s);
+    }
 }
 
 /**
@@ -790,8 +837,8 @@ static VbResult normal_scroll(Client *c, const NormalCmdInfo *info)
 {
     char *js;
 
-    js = g_strdup_printf("vbscroll('%c',%d,%d,%d);", info->key, c->config.scrollstep,
-            info->count, c->config.smooth_scrolling);
+    js = g_strdup_printf("vbscroll('%c',%d,%d,%d);", info->key, c->config.settings.scroll_step,
+            info->count, c->config.settings.smooth_scrolling);
     ext_proxy_eval_script(c, js, NULL);
     g_free(js);
 
@@ -810,23 +857,30 @@ static VbResult normal_search(Client *c, const NormalCmdInfo *info)
 static VbResult normal_search_selection(Client *c, const NormalCmdInfo *info)
 {
     int count;
-    char *query;
 
     /* there is no function to get the selected text so we copy current
      * selection to clipboard */
     webkit_web_view_execute_editing_command(c->webview, WEBKIT_EDITING_COMMAND_COPY);
-    query = util_clipboard_get_text(GTK_WIDGET(c->webview), TRUE);
-    if (!query) {
-        return RESULT_ERROR;
-    }
     count = (info->count > 0) ? info->count : 1;
-
-    command_search(c, &((Arg){info->key == '*' ? count : -count, query}), TRUE);
-    g_free(query);
+    async_clipboard(c, TRUE, search_text, GINT_TO_POINTER(info->key == '*' ? count : -count), NULL);
 
     return RESULT_COMPLETE;
 }
 
+/**
+ * Search for the selection read back from the clipboard.
+ */
+static void search_text(Client *c, const char *text, gpointer data)
+{
+    char *query;
+
+    if (text) {
+        query = g_strdup(text);
+        command_search(c, &((Arg){GPOINTER_TO_INT(data), query}), TRUE);
+        g_free(query);
+    }
+}
+
 static VbResult normal_view_inspector(Client *c, const NormalCmdInfo *info)
 {
     WebKitSettings *settings;
@@ -901,7 +955,7 @@ static VbResult normal_zoom(Client *c, const NormalCmdInfo *info)
     /* zz reset zoom to it's default zoom level */
     if (info->key2 == 'z') {
         webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(view), FALSE);
-        webkit_web_view_set_zoom_level(view, c->config.default_zoom / 100.0);
+        webkit_web_view_set_zoom_level(view, c->config.settings.default_zoom / 100.0);
 
         return RESULT_COMPLETE;
     }
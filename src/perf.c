@@ -0,0 +1,429 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <webkit/webkit.h>
+
+#include "config.h"
+#include "main.h"
+#include "perf.h"
+#include "util.h"
+
+extern struct Vimb vb;
+
+/* The load of a client that is measured at the moment. */
+typedef struct {
+    PerfRecord  *record;
+    guint       timer;      /* completes the record if the page does not report */
+} PerfClient;
+
+static struct {
+    GHashTable      *clients;   /* Client* -> PerfClient* */
+    GQueue          records;    /* the latest completed PerfRecord */
+    PerfRecordFunc  func;
+} perf = {NULL, G_QUEUE_INIT, NULL};
+
+/* rows of the :perf report, the load times followed by the page timing and
+ * the handler times */
+static const char *metric_names[] = {
+    "commit", "finish",
+    "ttfb", "interactive", "dcl", "load", "fp", "fcp",
+    "autocmd", "history", "statusbar"
+};
+#define METRIC_LAST (2 + PERF_PAGE_LAST + PERF_HANDLER_LAST)
+
+static void on_script_message(WebKitUserContentManager *manager,
+        JSCValue *value, gpointer data);
+static gboolean on_page_timeout(gpointer data);
+static PerfClient *client_get(Client *c, gboolean create);
+static void client_free(PerfClient *pc);
+static void record_complete(Client *c, PerfClient *pc);
+static void record_free(PerfRecord *record);
+static void record_log(const PerfRecord *record);
+static gdouble metric_value(const PerfRecord *record, int metric);
+static void report_row(GString *str, const char *name, GArray *values);
+static int cmp_double(gconstpointer a, gconstpointer b);
+
+
+/**
+ * Register the message handler the page script reports its timing to.
+ */
+void perf_register_handler(WebKitUserContentManager *ucm)
+{
+    webkit_user_content_manager_register_script_message_handler(ucm, "perf", NULL);
+    g_signal_connect(ucm, "script-message-received::perf", G_CALLBACK(on_script_message), NULL);
+}
+
+/**
+ * Track the load events of the client. A record is started with each load
+ * and completed once the page reported its timing after the load finished or
+ * after PERF_PAGE_TIMEOUT milliseconds.
+ */
+void perf_load_changed(Client *c, WebKitLoadEvent event, const char *uri)
+{
+    PerfClient *pc;
+    gint64 now = g_get_monotonic_time();
+
+    switch (event) {
+        case WEBKIT_LOAD_STARTED:
+            pc = client_get(c, TRUE);
+            /* complete the previous load in case the timing is still awaited */
+            record_complete(c, pc);
+            pc->record          = g_slice_new0(PerfRecord);
+            pc->record->uri     = g_strdup(uri);
+            pc->record->started = now;
+            break;
+
+        case WEBKIT_LOAD_COMMITTED:
+            pc = client_get(c, FALSE);
+            if (pc && pc->record) {
+                pc->record->committed = now - pc->record->started;
+                /* the committed uri is the one after possible redirects */
+                if (uri) {
+                    g_free(pc->record->uri);
+                    pc->record->uri = g_strdup(uri);
+                }
+            }
+            break;
+
+        case WEBKIT_LOAD_FINISHED:
+            pc = client_get(c, FALSE);
+            if (pc && pc->record && !pc->timer) {
+                pc->record->finished = now - pc->record->started;
+                /* Complete the record in the next main loop iteration to
+                 * include the time spent in the handlers of this event. */
+                if (pc->record->has_page) {
+                    pc->timer = g_idle_add(on_page_timeout, c);
+                } else {
+                    pc->timer = g_timeout_add(PERF_PAGE_TIMEOUT, on_page_timeout, c);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Mark the current load as failed. A load cancelled by the next one is not
+ * taken for a failure.
+ */
+void perf_load_failed(Client *c, GError *error)
+{
+    PerfClient *pc = client_get(c, FALSE);
+
+    if (pc && pc->record && !g_error_matches(error, WEBKIT_NETWORK_ERROR, WEBKIT_NETWORK_ERROR_CANCELLED)) {
+        pc->record->failed = TRUE;
+    }
+}
+
+/**
+ * Add the time since start to the given handler of the current load.
+ */
+void perf_handler_time(Client *c, PerfHandler handler, gint64 start)
+{
+    PerfClient *pc = client_get(c, FALSE);
+
+    if (pc && pc->record) {
+        pc->record->handlers[handler] += g_get_monotonic_time() - start;
+    }
+}
+
+/**
+ * Set a function that is called with each completed record.
+ */
+void perf_set_record_func(PerfRecordFunc func)
+{
+    perf.func = func;
+}
+
+/**
+ * Complete or drop the load of a client that is going to be freed.
+ */
+void perf_client_remove(Client *c)
+{
+    PerfClient *pc = client_get(c, FALSE);
+
+    if (pc) {
+        record_complete(c, pc);
+        g_hash_table_remove(perf.clients, c);
+    }
+}
+
+/**
+ * Show the percentiles of the recorded page loads and the latest pages.
+ */
+void perf_report(Client *c)
+{
+    GString *str;
+    GArray *values;
+    PerfRecord *r;
+    gdouble v;
+    int i, count;
+
+    str = g_string_new("-- Page loads --");
+    if (!perf.records.length) {
+        g_string_append(str, "\nNo page loads recorded");
+        goto out;
+    }
+    g_string_append_printf(str, "\n%u loads, times in ms\n%-12s %8s %8s %8s %8s",
+            perf.records.length, "", "p50", "p90", "p99", "max");
+
+    values = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    for (i = 0; i < METRIC_LAST; i++) {
+        g_array_set_size(values, 0);
+        for (GList *l = perf.records.head; l; l = l->next) {
+            if ((v = metric_value(l->data, i)) >= 0) {
+                g_array_append_val(values, v);
+            }
+        }
+        report_row(str, metric_names[i], values);
+    }
+    g_array_free(values, TRUE);
+
+    g_string_append_printf(str, "\n-- Latest pages --\n%8s %8s %8s", "finish", "fcp", "size");
+    count = 0;
+    for (GList *l = perf.records.tail; l && count < 10; l = l->prev, count++) {
+        char *size;
+
+        r    = l->data;
+        size = g_format_size((guint64)r->transfer_size);
+        g_string_append_printf(str, "\n%8.0f %8.0f %8s %s",
+                r->finished / 1000.0, r->page[PERF_FCP], size, r->uri ? r->uri : "");
+        g_free(size);
+    }
+
+out:
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", str->str);
+    g_string_free(str, TRUE);
+}
+
+void perf_cleanup(void)
+{
+    PerfRecord *record;
+
+    if (perf.clients) {
+        g_hash_table_destroy(perf.clients);
+        perf.clients = NULL;
+    }
+    while ((record = g_queue_pop_head(&perf.records))) {
+        record_free(record);
+    }
+}
+
+/**
+ * Receives [ttfb, interactive, dcl, load, fp, fcp, transferSize] posted by
+ * the perf_metrics script once the load event of the page has passed.
+ */
+static void on_script_message(WebKitUserContentManager *manager,
+        JSCValue *value, gpointer data)
+{
+    JSCValue *item;
+    PerfClient *pc = NULL;
+    Client *c;
+    int i;
+
+    if (!jsc_value_is_array(value)) {
+        return;
+    }
+
+    /* the content manager may be shared, so take the client with a record
+     * that still awaits the page timing */
+    for (c = vb.clients; c; c = c->next) {
+        if (vb_get_user_content_manager(c) == manager
+            && (pc = client_get(c, FALSE))
+            && pc->record && !pc->record->has_page) {
+            break;
+        }
+    }
+    if (!c) {
+        return;
+    }
+
+    for (i = 0; i < PERF_PAGE_LAST; i++) {
+        item = jsc_value_object_get_property_at_index(value, i);
+        pc->record->page[i] = jsc_value_to_double(item);
+        g_object_unref(item);
+    }
+    item = jsc_value_object_get_property_at_index(value, PERF_PAGE_LAST);
+    pc->record->transfer_size = (gint64)jsc_value_to_double(item);
+    g_object_unref(item);
+    pc->record->has_page = TRUE;
+
+    /* there is nothing left to wait for if the load already finished */
+    if (pc->timer) {
+        g_source_remove(pc->timer);
+        pc->timer = 0;
+        record_complete(c, pc);
+    }
+}
+
+static gboolean on_page_timeout(gpointer data)
+{
+    Client *c      = data;
+    PerfClient *pc = client_get(c, FALSE);
+
+    if (pc) {
+        pc->timer = 0;
+        record_complete(c, pc);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static PerfClient *client_get(Client *c, gboolean create)
+{
+    PerfClient *pc;
+
+    if (!perf.clients) {
+        if (!create) {
+            return NULL;
+        }
+        perf.clients = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)client_free);
+    }
+    pc = g_hash_table_lookup(perf.clients, c);
+    if (!pc && create) {
+        pc = g_slice_new0(PerfClient);
+        g_hash_table_insert(perf.clients, c, pc);
+    }
+    return pc;
+}
+
+static void client_free(PerfClient *pc)
+{
+    if (pc->timer) {
+        g_source_remove(pc->timer);
+    }
+    if (pc->record) {
+        record_free(pc->record);
+    }
+    g_slice_free(PerfClient, pc);
+}
+
+/**
+ * Move the record of the client to the list of completed records. Loads that
+ * did not finish, because they were aborted or replaced, are dropped.
+ */
+static void record_complete(Client *c, PerfClient *pc)
+{
+    PerfRecord *record = pc->record;
+
+    if (pc->timer) {
+        g_source_remove(pc->timer);
+        pc->timer = 0;
+    }
+    if (!record) {
+        return;
+    }
+    pc->record = NULL;
+    if (!record->finished) {
+        record_free(record);
+        return;
+    }
+
+    record_log(record);
+    if (perf.func) {
+        perf.func(c, record);
+    }
+    g_queue_push_tail(&perf.records, record);
+    while (perf.records.length > PERF_RECORDS_MAX) {
+        record_free(g_queue_pop_head(&perf.records));
+    }
+}
+
+static void record_free(PerfRecord *record)
+{
+    g_free(record->uri);
+    g_slice_free(PerfRecord, record);
+}
+
+/**
+ * Append the record as tab separated line to the perf file.
+ */
+static void record_log(const PerfRecord *record)
+{
+    if (!vb.files[FILES_PERF]) {
+        return;
+    }
+    util_file_append(vb.files[FILES_PERF],
+            "%" G_GINT64_FORMAT "\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%"
+            G_GINT64_FORMAT "\t%.1f\t%.1f\t%.1f\t%s\n",
+            g_get_real_time() / G_USEC_PER_SEC,
+            record->committed / 1000.0,
+            record->finished / 1000.0,
+            record->page[PERF_TTFB],
+            record->page[PERF_INTERACTIVE],
+            record->page[PERF_DCL],
+            record->page[PERF_LOAD],
+            record->page[PERF_FP],
+            record->page[PERF_FCP],
+            record->transfer_size,
+            record->handlers[PERF_AUTOCMD] / 1000.0,
+            record->handlers[PERF_HISTORY] / 1000.0,
+            record->handlers[PERF_STATUSBAR] / 1000.0,
+            record->uri ? record->uri : "");
+}
+
+/**
+ * Returns the metric of the record in milliseconds or -1 if the record does
+ * not have it.
+ */
+static gdouble metric_value(const PerfRecord *record, int metric)
+{
+    if (metric == 0) {
+        return record->committed ? record->committed / 1000.0 : -1;
+    }
+    if (metric == 1) {
+        return record->finished / 1000.0;
+    }
+    metric -= 2;
+    if (metric < PERF_PAGE_LAST) {
+        return record->has_page && record->page[metric] > 0 ? record->page[metric] : -1;
+    }
+    return record->handlers[metric - PERF_PAGE_LAST] / 1000.0;
+}
+
+/**
+ * Append the nearest rank percentiles of the values to the report.
+ */
+static void report_row(GString *str, const char *name, GArray *values)
+{
+    gdouble *v;
+    guint n = values->len;
+
+    g_string_append_printf(str, "\n%-12s", name);
+    if (!n) {
+        g_string_append_printf(str, " %8s %8s %8s %8s", "-", "-", "-", "-");
+        return;
+    }
+    g_array_sort(values, cmp_double);
+    v = (gdouble*)values->data;
+#define RANK(p) v[MAX(((p) * n + 99) / 100, 1) - 1]
+    g_string_append_printf(str, " %8.1f %8.1f %8.1f %8.1f",
+            RANK(50), RANK(90), RANK(99), v[n - 1]);
+#undef RANK
+}
+
+static int cmp_double(gconstpointer a, gconstpointer b)
+{
+    gdouble x = *(const gdouble*)a, y = *(const gdouble*)b;
+
+    return x < y ? -1 : x > y;
+}
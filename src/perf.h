@@ -0,0 +1,67 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _PERF_H
+#define _PERF_H
+
+#include "main.h"
+
+/* vimb's own handlers of the load events whose time is measured */
+typedef enum {
+    PERF_AUTOCMD,
+    PERF_HISTORY,
+    PERF_STATUSBAR,
+    PERF_HANDLER_LAST
+} PerfHandler;
+
+/* navigation and paint timing reported by the page */
+typedef enum {
+    PERF_TTFB,
+    PERF_INTERACTIVE,
+    PERF_DCL,
+    PERF_LOAD,
+    PERF_FP,
+    PERF_FCP,
+    PERF_PAGE_LAST
+} PerfPageTiming;
+
+typedef struct {
+    char        *uri;
+    gint64      started;                        /* monotonic time of the load start */
+    gint64      committed;                      /* microseconds from start to commit */
+    gint64      finished;                       /* microseconds from start to finish */
+    gint64      handlers[PERF_HANDLER_LAST];    /* microseconds spent in the handlers */
+    gdouble     page[PERF_PAGE_LAST];           /* milliseconds from navigation start */
+    gint64      transfer_size;
+    gboolean    has_page;                       /* the page reported its timing */
+    gboolean    failed;                         /* the load failed */
+} PerfRecord;
+
+typedef void (*PerfRecordFunc)(Client *c, const PerfRecord *record);
+
+void perf_register_handler(WebKitUserContentManager *ucm);
+void perf_load_changed(Client *c, WebKitLoadEvent event, const char *uri);
+void perf_load_failed(Client *c, GError *error);
+void perf_handler_time(Client *c, PerfHandler handler, gint64 start);
+void perf_set_record_func(PerfRecordFunc func);
+void perf_client_remove(Client *c);
+void perf_report(Client *c);
+void perf_cleanup(void);
+
+#endif /* end of include guard: _PERF_H */
@@ -0,0 +1,42 @@
+(function() {
+    'use strict';
+
+    /* Posts the navigation and paint timing of the document in milliseconds
+     * since the start of the navigation. */
+    function report() {
+        var perf = window.performance;
+        var nav, paint, fp = 0, fcp = 0;
+
+        if (!perf || !perf.getEntriesByType
+            || !window.webkit || !window.webkit.messageHandlers || !window.webkit.messageHandlers.perf) {
+            return;
+        }
+        nav = perf.getEntriesByType('navigation')[0];
+        if (!nav) {
+            return;
+        }
+        paint = perf.getEntriesByType('paint');
+        for (var i = 0; i < paint.length; i++) {
+            if (paint[i].name === 'first-paint') {
+                fp = paint[i].startTime;
+            } else if (paint[i].name === 'first-contentful-paint') {
+                fcp = paint[i].startTime;
+            }
+        }
+        window.webkit.messageHandlers.perf.postMessage([
+            nav.responseStart, nav.domInteractive, nav.domContentLoadedEventEnd,
+            nav.loadEventEnd, fp, fcp, nav.transferSize || 0
+        ]);
+    }
+
+    /* loadEventEnd is not set before the load handlers returned */
+    function schedule() {
+        window.setTimeout(report, 0);
+    }
+
+    if (document.readyState === 'complete') {
+        schedule();
+    } else {
+        window.addEventListener('load', schedule);
+    }
+})();
@@ -1,48 +1,80 @@
 (function() {
     'use strict';
 
-    function updateScrollPosition() {
+    /* last reported state as [max, percent, top] */
+    var last = [-1, -1, -1];
+    var pending = false;
+
+    function getState() {
         var de = document.documentElement;
         var body = document.body;
 
         if (!de || !body) {
-            return;
+            return null;
         }
 
-        var scrollTop = Math.max(de.scrollTop || 0, body.scrollTop || 0);
+        var scrollTop = Math.round(Math.max(de.scrollTop || 0, body.scrollTop || 0));
         var scrollHeight = Math.max(de.scrollHeight || 0, body.scrollHeight || 0);
         var clientHeight = window.innerHeight || 0;
-        var max = scrollHeight - clientHeight;
+        var max = Math.max(scrollHeight - clientHeight, 0);
         var percent = 0;
 
         if (max > 0) {
             percent = Math.round(scrollTop * 100 / max);
         }
 
+        return [max, percent, scrollTop];
+    }
+
+    function post(state) {
         if (window.webkit && window.webkit.messageHandlers && window.webkit.messageHandlers.scroll) {
-            window.webkit.messageHandlers.scroll.postMessage({
-                max: max,
-                percent: percent,
-                top: scrollTop
-            });
+            window.webkit.messageHandlers.scroll.postMessage(state);
         }
     }
 
-    var scrollTimeout;
-    window.addEventListener('scroll', function() {
-        if (scrollTimeout) {
-            clearTimeout(scrollTimeout);
+    /* Runs at most once per frame and posts only if the state has changed,
+     * so the exact top is known for marks, discarded tabs and the session. */
+    function update() {
+        var state = getState();
+
+        pending = false;
+        if (!state) {
+            return;
+        }
+        if (state[0] !== last[0] || state[1] !== last[1] || state[2] !== last[2]) {
+            last = state;
+            post(state);
+        }
+    }
+
+    function schedule() {
+        if (!pending) {
+            pending = true;
+            window.requestAnimationFrame(update);
+        }
+    }
+
+    /* Allows to pull the current state on demand. If force is given the
+     * state is also posted to the scroll message handler. */
+    window.vbScrollState = function(force) {
+        var state = getState();
+
+        if (!state) {
+            return [0, 0, 0];
+        }
+        last = state;
+        if (force) {
+            post(state);
         }
-        scrollTimeout = setTimeout(updateScrollPosition, 50);
-    }, {passive: true});
+        return state;
+    };
 
-    window.addEventListener('resize', updateScrollPosition, {passive: true});
+    window.addEventListener('scroll', schedule, {passive: true});
+    window.addEventListener('resize', schedule, {passive: true});
 
     if (document.readyState === 'complete') {
-        setTimeout(updateScrollPosition, 100);
+        schedule();
     } else {
-        window.addEventListener('load', function() {
-            setTimeout(updateScrollPosition, 100);
-        });
+        window.addEventListener('load', schedule);
     }
 })();
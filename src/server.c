@@ -0,0 +1,266 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "main.h"
+#include "ex.h"
+#include "server.h"
+
+extern struct Vimb vb;
+
+/* An invocation that forwards its arguments to the running instance. The
+ * request consists of lines "cmd {ex command}" and "open {uri}" and ends
+ * when the invocation shuts down its side of the connection. */
+typedef struct {
+    GSocketConnection   *conn;
+    GDataInputStream    *in;
+    GSList              *cmds;
+    GSList              *uris;
+} Request;
+
+static struct {
+    GSocketService  *service;
+    char            *path;
+} server;
+
+static char *socket_path(void);
+static char *resolve_file(const char *uri);
+static gboolean on_incoming(GSocketService *service, GSocketConnection *conn,
+        GObject *source, gpointer data);
+static void on_read_line(GObject *stream, GAsyncResult *res, Request *r);
+static void request_run(Request *r);
+static void request_free(Request *r);
+
+
+/**
+ * Send the uri and the ex commands to the instance running in server mode
+ * for the current profile. Returns FALSE if there is no such instance or the
+ * request could not be sent. The socket is only removed if nobody listens on
+ * it, a busy server or a permission problem leave it in place.
+ */
+gboolean server_forward(const char *uri, GSList *cmds)
+{
+    GSocketClient *client;
+    GSocketConnection *conn;
+    GSocketAddress *address;
+    GOutputStream *out;
+    GString *request;
+    char *path, *file, reply[3] = {0};
+    gboolean ok = FALSE;
+    GError *error = NULL;
+
+    path    = socket_path();
+    address = g_unix_socket_address_new(path);
+    client  = g_socket_client_new();
+    g_socket_client_set_timeout(client, SERVER_TIMEOUT);
+
+    conn = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, &error);
+    if (!conn) {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED)) {
+            /* nobody listens on the socket, the server was not stopped cleanly */
+            g_unlink(path);
+        }
+        g_error_free(error);
+        goto out;
+    }
+
+    request = g_string_new(NULL);
+    for (GSList *l = cmds; l; l = l->next) {
+        g_string_append_printf(request, "cmd %s\n", (char*)l->data);
+    }
+    /* The server runs in another directory, so relative file paths are
+     * resolved here. */
+    file = resolve_file(uri);
+    g_string_append_printf(request, "open %s\n", file ? file : (uri ? uri : ""));
+    g_free(file);
+
+    out = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+    if (g_output_stream_write_all(out, request->str, request->len, NULL, NULL, NULL)
+        && g_socket_shutdown(g_socket_connection_get_socket(conn), FALSE, TRUE, NULL)) {
+        /* The server got the request, opening the uri here too on a missing
+         * reply would show the page twice. */
+        ok = TRUE;
+        if (!g_input_stream_read_all(g_io_stream_get_input_stream(G_IO_STREAM(conn)),
+                reply, sizeof(reply) - 1, NULL, NULL, NULL)
+            || strcmp(reply, "ok")) {
+            g_warning("The server did not confirm the request");
+        }
+    }
+    g_string_free(request, TRUE);
+    g_object_unref(conn);
+
+out:
+    g_object_unref(client);
+    g_object_unref(address);
+    g_free(path);
+
+    return ok;
+}
+
+/**
+ * Listen on the socket of the current profile for forwarded invocations.
+ */
+gboolean server_start(GError **error)
+{
+    GSocketAddress *address;
+    char *dir;
+
+    server.path = socket_path();
+    dir         = g_path_get_dirname(server.path);
+    g_mkdir_with_parents(dir, 0700);
+    g_free(dir);
+
+    server.service = g_socket_service_new();
+    address        = g_unix_socket_address_new(server.path);
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(server.service),
+            address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+            NULL, NULL, error)) {
+        g_object_unref(address);
+        g_clear_object(&server.service);
+        g_clear_pointer(&server.path, g_free);
+
+        return FALSE;
+    }
+    g_object_unref(address);
+
+    g_signal_connect(server.service, "incoming", G_CALLBACK(on_incoming), NULL);
+    g_socket_service_start(server.service);
+
+    return TRUE;
+}
+
+/**
+ * Stop listening and remove the socket.
+ */
+void server_cleanup(void)
+{
+    if (server.service) {
+        g_socket_service_stop(server.service);
+        g_socket_listener_close(G_SOCKET_LISTENER(server.service));
+        g_clear_object(&server.service);
+    }
+    if (server.path) {
+        g_unlink(server.path);
+        g_clear_pointer(&server.path, g_free);
+    }
+}
+
+/**
+ * Returns the path of the socket of the current profile.
+ */
+static char *socket_path(void)
+{
+    return g_build_filename(g_get_user_runtime_dir(), PROJECT,
+            vb.profile ? vb.profile : "default", "server", NULL);
+}
+
+/**
+ * Returns the absolute file:// uri if given uri is the path of an existing
+ * file, else NULL. The returned string must be freed with g_free().
+ */
+static char *resolve_file(const char *uri)
+{
+    char *rp, *file;
+
+    if (!uri || !*uri || strstr(uri, "://") || !(rp = realpath(uri, NULL))) {
+        return NULL;
+    }
+    file = g_filename_to_uri(rp, NULL, NULL);
+    free(rp);
+
+    return file;
+}
+
+static gboolean on_incoming(GSocketService *service, GSocketConnection *conn,
+        GObject *source, gpointer data)
+{
+    Request *r = g_slice_new0(Request);
+
+    r->conn = g_object_ref(conn);
+    r->in   = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(conn)));
+    g_data_input_stream_read_line_async(r->in, G_PRIORITY_DEFAULT, NULL,
+            (GAsyncReadyCallback)on_read_line, r);
+
+    return TRUE;
+}
+
+static void on_read_line(GObject *stream, GAsyncResult *res, Request *r)
+{
+    char *line;
+
+    line = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(stream), res, NULL, NULL);
+    if (!line) {
+        /* end of the request */
+        request_run(r);
+        request_free(r);
+        return;
+    }
+
+    if (g_str_has_prefix(line, "cmd ")) {
+        r->cmds = g_slist_append(r->cmds, g_strdup(line + 4));
+    } else if (g_str_has_prefix(line, "open ")) {
+        r->uris = g_slist_append(r->uris, g_strdup(line + 5));
+    }
+    g_free(line);
+
+    g_data_input_stream_read_line_async(r->in, G_PRIORITY_DEFAULT, NULL,
+            (GAsyncReadyCallback)on_read_line, r);
+}
+
+/**
+ * Open each forwarded uri in a new tab like a newly started instance would
+ * show it, the commands are run before the page is loaded.
+ */
+static void request_run(Request *r)
+{
+    GOutputStream *out;
+    Client *c;
+
+    for (GSList *l = r->uris; l; l = l->next) {
+        c = vb_tab_new(NULL, NULL);
+        for (GSList *cmd = r->cmds; cmd; cmd = cmd->next) {
+            ex_run_string(c, cmd->data, FALSE);
+        }
+        vb_load_uri(c, &(Arg){TARGET_CURRENT, l->data});
+    }
+    if (r->uris) {
+        gtk_window_present(GTK_WINDOW(vb.main_window));
+    }
+
+    /* the reply fits into the socket buffer and does not block */
+    out = g_io_stream_get_output_stream(G_IO_STREAM(r->conn));
+    g_output_stream_write_all(out, "ok", 2, NULL, NULL, NULL);
+    g_io_stream_close(G_IO_STREAM(r->conn), NULL, NULL);
+}
+
+static void request_free(Request *r)
+{
+    g_slist_free_full(r->cmds, g_free);
+    g_slist_free_full(r->uris, g_free);
+    g_object_unref(r->in);
+    g_object_unref(r->conn);
+    g_slice_free(Request, r);
+}
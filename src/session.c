@@ -0,0 +1,315 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "config.h"
+#include "main.h"
+#include "session.h"
+
+extern struct Vimb vb;
+
+static struct {
+    guint           timer;      /* pending delayed write */
+    gboolean        writing;    /* an asynchronous write is running */
+    gboolean        dirty;      /* the tabs changed while writing */
+    gboolean        frozen;     /* session was flushed on quit, don't write anymore */
+    GCancellable    *cancellable;
+} session;
+
+static GBytes *session_serialize(void);
+static void session_serialize_tab(GKeyFile *kf, const char *group, Client *c);
+static gboolean session_write(gpointer data);
+static void on_session_written(GObject *source, GAsyncResult *res, gpointer data);
+static Client *session_restore_tab(GKeyFile *kf, const char *group);
+
+
+/**
+ * Restore the tabs of the last session. The tabs are created as placeholders
+ * and only the active tab gets its webview, the other tabs are loaded once
+ * they are activated.
+ * Returns TRUE if at least one tab was restored.
+ */
+gboolean session_restore(void)
+{
+    GKeyFile *kf;
+    char **groups;
+    int active, count = 0;
+
+    if (!vb.files[FILES_SESSION]) {
+        return FALSE;
+    }
+
+    kf = g_key_file_new();
+    if (!g_key_file_load_from_file(kf, vb.files[FILES_SESSION], G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(kf);
+        return FALSE;
+    }
+
+    groups = g_key_file_get_groups(kf, NULL);
+    for (int i = 0; groups[i]; i++) {
+        if (g_str_has_prefix(groups[i], "tab") && session_restore_tab(kf, groups[i])) {
+            count++;
+        }
+    }
+    g_strfreev(groups);
+
+    if (count) {
+        active = g_key_file_get_integer(kf, "session", "active", NULL);
+        vb_tab_goto(CLAMP(active, 0, count - 1));
+    }
+    g_key_file_free(kf);
+
+    return count > 0;
+}
+
+/**
+ * Schedule writing the session file. Called on every change of the tabs,
+ * the writes are delayed and bundled to keep the disk io low.
+ */
+void session_save(void)
+{
+    if (!vb.files[FILES_SESSION] || session.frozen) {
+        return;
+    }
+    if (session.writing) {
+        /* Write again once the running write is done. */
+        session.dirty = TRUE;
+        return;
+    }
+    if (!session.timer) {
+        session.timer = g_timeout_add_seconds(SESSION_SAVE_DELAY, session_write, NULL);
+    }
+}
+
+/**
+ * Write the session synchronous and stop writing it on further changes.
+ * This is called before the tabs are closed on quit, so that the session
+ * holds the tabs open at that time.
+ */
+void session_flush(void)
+{
+    GBytes *bytes;
+    GError *error = NULL;
+    gsize len;
+    const char *data;
+
+    if (!vb.files[FILES_SESSION] || session.frozen) {
+        return;
+    }
+    session.frozen = TRUE;
+
+    if (session.timer) {
+        g_source_remove(session.timer);
+        session.timer = 0;
+    }
+    /* The replaced file is kept untouched if a running write is cancelled. */
+    if (session.cancellable) {
+        g_cancellable_cancel(session.cancellable);
+    }
+
+    bytes = session_serialize();
+    data  = g_bytes_get_data(bytes, &len);
+    if (!g_file_set_contents(vb.files[FILES_SESSION], data, len, &error)) {
+        g_warning("Could not write session: %s", error->message);
+        g_error_free(error);
+    }
+    g_bytes_unref(bytes);
+}
+
+void session_cleanup(void)
+{
+    if (session.timer) {
+        g_source_remove(session.timer);
+        session.timer = 0;
+    }
+    if (session.cancellable) {
+        g_cancellable_cancel(session.cancellable);
+        g_clear_object(&session.cancellable);
+    }
+}
+
+/**
+ * Build the content of the session file from the tabs in the order they are
+ * shown.
+ */
+static GBytes *session_serialize(void)
+{
+    GKeyFile *kf;
+    GtkWidget *page;
+    Client *c;
+    char *data, group[16];
+    gsize len;
+    int i, n, tab = 0;
+
+    kf = g_key_file_new();
+    g_key_file_set_integer(kf, "session", "active",
+            gtk_notebook_get_current_page(GTK_NOTEBOOK(vb.notebook)));
+
+    n = vb_get_tab_count();
+    for (i = 0; i < n; i++) {
+        page = gtk_notebook_get_nth_page(GTK_NOTEBOOK(vb.notebook), i);
+        for (c = vb.clients; c && c->tab_box != page; c = c->next);
+        if (c) {
+            g_snprintf(group, sizeof(group), "tab%d", tab++);
+            session_serialize_tab(kf, group, c);
+        }
+    }
+
+    data = g_key_file_to_data(kf, &len, NULL);
+    g_key_file_free(kf);
+
+    return g_bytes_new_take(data, len);
+}
+
+static void session_serialize_tab(GKeyFile *kf, const char *group, Client *c)
+{
+    WebKitWebViewSessionState *state = NULL;
+    char *marks[MARK_SIZE + 1];
+    int i;
+
+    if (c->state.uri) {
+        g_key_file_set_string(kf, group, "uri", c->state.uri);
+    }
+    if (c->state.title) {
+        g_key_file_set_string(kf, group, "title", c->state.title);
+    }
+
+    /* Discarded tabs and placeholders keep the state of their last webview. */
+    if (c->webview) {
+        state = webkit_web_view_get_session_state(c->webview);
+    } else if (c->state.discard.session) {
+        state = webkit_web_view_session_state_ref(c->state.discard.session);
+    }
+    if (state) {
+        GBytes *bytes = webkit_web_view_session_state_serialize(state);
+        gsize size;
+        const guchar *raw = g_bytes_get_data(bytes, &size);
+        char *b64 = g_base64_encode(raw, size);
+
+        g_key_file_set_string(kf, group, "state", b64);
+        g_free(b64);
+        g_bytes_unref(bytes);
+        webkit_web_view_session_state_unref(state);
+    }
+
+    /* Placeholders and tabs that are still restored keep the position to
+     * restore in the discard state until the load has finished. */
+    if (!c->webview || c->state.discard.restoring) {
+        g_key_file_set_uint64(kf, group, "scroll", c->state.discard.scroll_top);
+    } else {
+        g_key_file_set_uint64(kf, group, "scroll", c->state.scroll_top);
+    }
+    for (i = 0; i < MARK_SIZE; i++) {
+        marks[i] = g_strdup_printf("%" G_GUINT64_FORMAT, c->state.marks[i]);
+    }
+    marks[i] = NULL;
+    g_key_file_set_string_list(kf, group, "marks", (const char * const *)marks, MARK_SIZE);
+    for (i = 0; i < MARK_SIZE; i++) {
+        g_free(marks[i]);
+    }
+}
+
+static gboolean session_write(gpointer data)
+{
+    GFile *file;
+    GBytes *bytes;
+
+    session.timer   = 0;
+    session.writing = TRUE;
+    session.dirty   = FALSE;
+    if (!session.cancellable) {
+        session.cancellable = g_cancellable_new();
+    }
+
+    bytes = session_serialize();
+    file  = g_file_new_for_path(vb.files[FILES_SESSION]);
+    g_file_replace_contents_bytes_async(file, bytes, NULL, FALSE,
+            G_FILE_CREATE_PRIVATE, session.cancellable, on_session_written, NULL);
+    g_object_unref(file);
+    g_bytes_unref(bytes);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void on_session_written(GObject *source, GAsyncResult *res, gpointer data)
+{
+    GError *error = NULL;
+
+    if (!g_file_replace_contents_finish(G_FILE(source), res, NULL, &error)) {
+        gboolean cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+        if (!cancelled) {
+            g_warning("Could not write session: %s", error->message);
+        }
+        g_error_free(error);
+        /* Cancelled on quit, the session is already written. */
+        if (cancelled) {
+            return;
+        }
+    }
+
+    session.writing = FALSE;
+    if (session.dirty) {
+        session_save();
+    }
+}
+
+/**
+ * Create a placeholder tab from the given session file group.
+ */
+static Client *session_restore_tab(GKeyFile *kf, const char *group)
+{
+    WebKitWebViewSessionState *state = NULL;
+    Client *c;
+    char *uri, *title, *b64, **marks;
+    gsize len;
+
+    uri   = g_key_file_get_string(kf, group, "uri", NULL);
+    title = g_key_file_get_string(kf, group, "title", NULL);
+    if ((b64 = g_key_file_get_string(kf, group, "state", NULL))) {
+        guchar *raw = g_base64_decode(b64, &len);
+        GBytes *bytes = g_bytes_new_take(raw, len);
+
+        state = webkit_web_view_session_state_new(bytes);
+        g_bytes_unref(bytes);
+        g_free(b64);
+    }
+
+    if (!uri && !state) {
+        g_free(title);
+        return NULL;
+    }
+
+    c = vb_tab_new_placeholder(uri, title, state);
+    c->state.discard.scroll_top = g_key_file_get_uint64(kf, group, "scroll", NULL);
+    if ((marks = g_key_file_get_string_list(kf, group, "marks", &len, NULL))) {
+        for (gsize i = 0; i < len && i < MARK_SIZE; i++) {
+            c->state.marks[i] = g_ascii_strtoull(marks[i], NULL, 10);
+        }
+        g_strfreev(marks);
+    }
+
+    g_free(uri);
+    g_free(title);
+
+    return c;
+}
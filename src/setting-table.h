@@ -0,0 +1,140 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* The settings of vimb, included with SETTING() defined as needed to
+ * generate the setting ids, the fields of the Settings struct and the table
+ * used by :set. This file has no include guard by intention.
+ *
+ * SETTING(id, field, name, type, default, setter, flags, data)
+ *
+ * The setter is called with the new value and the data before the value is
+ * stored in the field and may reject it. Settings without setter are only
+ * stored. */
+SETTING(USER_AGENT, user_agent, "user-agent", TYPE_CHAR, "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/60.5 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent")
+/* WebKitGTK 6.0: enable-accelerated-2d-canvas is deprecated and removed - setting removed */
+/* SETTING(ACCELERATED_2D_CANVAS, accelerated_2d_canvas, "accelerated-2d-canvas", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-accelerated-2d-canvas") */
+SETTING(ALLOW_FILE_ACCESS_FROM_FILE_URLS, allow_file_access_from_file_urls, "allow-file-access-from-file-urls", TYPE_BOOLEAN, FALSE, webkit, 0, "allow-file-access-from-file-urls")
+SETTING(ALLOW_UNIVERSAL_ACCESS_FROM_FILE_URLS, allow_universal_access_from_file_urls, "allow-universal-access-from-file-urls", TYPE_BOOLEAN, FALSE, webkit, 0, "allow-universal-access-from-file-urls")
+SETTING(CARET, caret, "caret", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-caret-browsing")
+SETTING(CURSIV_FONT, cursiv_font, "cursiv-font", TYPE_CHAR, "serif", webkit, 0, "cursive-font-family")
+SETTING(DARK_MODE, dark_mode, "dark-mode", TYPE_BOOLEAN, FALSE, dark_mode, 0, NULL)
+SETTING(DEFAULT_CHARSET, default_charset, "default-charset", TYPE_CHAR, "utf-8", webkit, 0, "default-charset")
+SETTING(DEFAULT_FONT, default_font, "default-font", TYPE_CHAR, "sans-serif", webkit, 0, "default-font-family")
+/* WebKitGTK 6.0: enable-dns-prefetching is deprecated and does nothing - setting removed */
+/* SETTING(DNS_PREFETCHING, dns_prefetching, "dns-prefetching", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-dns-prefetching") */
+SETTING(FONT_SIZE, font_size, "font-size", TYPE_INTEGER, SETTING_DEFAULT_FONT_SIZE, webkit, 0, "default-font-size")
+/* WebKitGTK 6.0: enable-frame-flattening is deprecated and removed - setting removed */
+/* SETTING(FRAME_FLATTENING, frame_flattening, "frame-flattening", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-frame-flattening") */
+SETTING(GEOLOCATION, geolocation, "geolocation", TYPE_CHAR, "ask", geolocation, FLAG_NODUP, NULL)
+SETTING(HARDWARE_ACCELERATION_POLICY, hardware_acceleration_policy, "hardware-acceleration-policy", TYPE_CHAR, "ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL)
+SETTING(HEADER, header, "header", TYPE_CHAR, "", headers, FLAG_LIST|FLAG_NODUP, "header")
+SETTING(HINT_TIMEOUT, hint_timeout, "hint-timeout", TYPE_INTEGER, 1000, NULL, 0, NULL)
+SETTING(HINT_KEYS, hint_keys, "hint-keys", TYPE_CHAR, SETTING_HINT_KEYS, NULL, 0, NULL)
+SETTING(HINT_FOLLOW_LAST, hint_follow_last, "hint-follow-last", TYPE_BOOLEAN, TRUE, NULL, 0, NULL)
+SETTING(HINT_KEYS_SAME_LENGTH, hint_keys_same_length, "hint-keys-same-length", TYPE_BOOLEAN, FALSE, NULL, 0, NULL)
+SETTING(HINT_MATCH_ELEMENT, hint_match_element, "hint-match-element", TYPE_BOOLEAN, TRUE, NULL, 0, NULL)
+SETTING(HISTIGNORE, histignore, "histignore", TYPE_CHAR, SETTING_HISTIGNORE, histignore, 0, NULL)
+SETTING(HTML5_DATABASE, html5_database, "html5-database", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-html5-database")
+SETTING(HTML5_LOCAL_STORAGE, html5_local_storage, "html5-local-storage", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-html5-local-storage")
+/* WebKitGTK 6.0: enable-hyperlink-auditing is deprecated and does nothing - setting removed */
+/* SETTING(HYPERLINK_AUDITING, hyperlink_auditing, "hyperlink-auditing", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-hyperlink-auditing") */
+SETTING(IMAGES, images, "images", TYPE_BOOLEAN, TRUE, webkit, 0, "auto-load-images")
+#if WEBKIT_CHECK_VERSION(2, 30, 0)
+SETTING(INTELLIGENT_TRACKING_PREVENTION, intelligent_tracking_prevention, "intelligent-tracking-prevention", TYPE_BOOLEAN, FALSE, intelligent_tracking_prevention, 0, NULL)
+#endif
+SETTING(JAVASCRIPT_CAN_ACCESS_CLIPBOARD, javascript_can_access_clipboard, "javascript-can-access-clipboard", TYPE_BOOLEAN, FALSE, webkit, 0, "javascript-can-access-clipboard")
+SETTING(JAVASCRIPT_CAN_OPEN_WINDOWS_AUTOMATICALLY, javascript_can_open_windows_automatically, "javascript-can-open-windows-automatically", TYPE_BOOLEAN, FALSE, webkit, 0, "javascript-can-open-windows-automatically")
+#if WEBKIT_CHECK_VERSION(2, 24, 0)
+SETTING(JAVASCRIPT_ENABLE_MARKUP, javascript_enable_markup, "javascript-enable-markup", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-javascript-markup")
+#endif
+SETTING(MEDIA, media, "media", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-media")
+SETTING(MEDIA_PLAYBACK_ALLOWS_INLINE, media_playback_allows_inline, "media-playback-allows-inline", TYPE_BOOLEAN, TRUE, webkit, 0, "media-playback-allows-inline")
+SETTING(MEDIA_PLAYBACK_REQUIRES_USER_GESTURE, media_playback_requires_user_gesture, "media-playback-requires-user-gesture", TYPE_BOOLEAN, FALSE, webkit, 0, "media-playback-requires-user-gesture")
+SETTING(MEDIA_STREAM, media_stream, "media-stream", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-media-stream")
+SETTING(MEDIASOURCE, mediasource, "mediasource", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-mediasource")
+SETTING(MINIMUM_FONT_SIZE, minimum_font_size, "minimum-font-size", TYPE_INTEGER, 5, webkit, 0, "minimum-font-size")
+SETTING(MONOSPACE_FONT, monospace_font, "monospace-font", TYPE_CHAR, "monospace", webkit, 0, "monospace-font-family")
+SETTING(MONOSPACE_FONT_SIZE, monospace_font_size, "monospace-font-size", TYPE_INTEGER, SETTING_DEFAULT_MONOSPACE_FONT_SIZE, webkit, 0, "default-monospace-font-size")
+SETTING(NEW_WINDOW, new_window, "new-window", TYPE_CHAR, "tab", new_window, FLAG_NODUP, NULL)
+SETTING(NOTIFICATION, notification, "notification", TYPE_CHAR, "ask", notification, FLAG_NODUP, NULL)
+/* WebKitGTK 6.0: enable-offline-web-application-cache is deprecated and does nothing - setting removed */
+/* SETTING(OFFLINE_CACHE, offline_cache, "offline-cache", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-offline-web-application-cache") */
+/* WebKitGTK 6.0: enable-plugins is deprecated and removed - setting removed */
+/* SETTING(PLUGINS, plugins, "plugins", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-plugins") */
+SETTING(PREVENT_NEWWINDOW, prevent_newwindow, "prevent-newwindow", TYPE_BOOLEAN, FALSE, NULL, 0, NULL)
+SETTING(PRINT_BACKGROUNDS, print_backgrounds, "print-backgrounds", TYPE_BOOLEAN, TRUE, webkit, 0, "print-backgrounds")
+SETTING(SANS_SERIF_FONT, sans_serif_font, "sans-serif-font", TYPE_CHAR, "sans-serif", webkit, 0, "sans-serif-font-family")
+SETTING(SCRIPTS, scripts, "scripts", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-javascript")
+SETTING(SERIF_FONT, serif_font, "serif-font", TYPE_CHAR, "serif", webkit, 0, "serif-font-family")
+SETTING(SITE_SPECIFIC_QUIRKS, site_specific_quirks, "site-specific-quirks", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-site-specific-quirks")
+SETTING(SMOOTH_SCROLLING, smooth_scrolling, "smooth-scrolling", TYPE_BOOLEAN, FALSE, smooth_scrolling, 0, NULL)
+SETTING(SPATIAL_NAVIGATION, spatial_navigation, "spatial-navigation", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-spatial-navigation")
+SETTING(TABS_TO_LINKS, tabs_to_links, "tabs-to-links", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-tabs-to-links")
+SETTING(WEBAUDIO, webaudio, "webaudio", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-webaudio")
+SETTING(WEBGL, webgl, "webgl", TYPE_BOOLEAN, FALSE, webkit, 0, "enable-webgl")
+SETTING(WEBINSPECTOR, webinspector, "webinspector", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-developer-extras")
+/* WebKitGTK 6.0: enable-xss-auditor is deprecated and removed - setting removed */
+/* SETTING(XSS_AUDITOR, xss_auditor, "xss-auditor", TYPE_BOOLEAN, TRUE, webkit, 0, "enable-xss-auditor") */
+
+/* internal variables */
+SETTING(STYLESHEET, stylesheet, "stylesheet", TYPE_BOOLEAN, TRUE, user_style, 0, NULL)
+SETTING(USER_SCRIPTS, user_scripts, "user-scripts", TYPE_BOOLEAN, TRUE, user_scripts, 0, NULL)
+SETTING(COOKIE_ACCEPT, cookie_accept, "cookie-accept", TYPE_CHAR, SETTING_COOKIE_ACCEPT, cookie_accept, 0, NULL)
+SETTING(SCROLL_STEP, scroll_step, "scroll-step", TYPE_INTEGER, 40, NULL, 0, NULL)
+SETTING(SCROLL_MULTIPLIER, scroll_multiplier, "scroll-multiplier", TYPE_INTEGER, 1, NULL, 0, NULL)
+SETTING(HOME_PAGE, home_page, "home-page", TYPE_CHAR, SETTING_HOME_PAGE, NULL, 0, NULL)
+SETTING(STATUS_BAR_SHOW_SETTINGS, status_bar_show_settings, "status-bar-show-settings", TYPE_BOOLEAN, FALSE, NULL, 0, NULL)
+/* TODO should be global and not overwritten by a new client */
+SETTING(HISTORY_MAX_ITEMS, history_max_items, "history-max-items", TYPE_INTEGER, 2000, internal, 0, &vb.config.history_max)
+SETTING(EDITOR_COMMAND, editor_command, "editor-command", TYPE_CHAR, "x-terminal-emulator -e -vi '%s'", NULL, 0, NULL)
+SETTING(STRICT_SSL, strict_ssl, "strict-ssl", TYPE_BOOLEAN, TRUE, tls_policy, 0, NULL)
+SETTING(STATUS_BAR, status_bar, "status-bar", TYPE_BOOLEAN, TRUE, statusbar, 0, NULL)
+SETTING(TIMEOUTLEN, timeoutlen, "timeoutlen", TYPE_INTEGER, 1000, timeoutlen, 0, NULL)
+SETTING(INPUT_AUTOHIDE, input_autohide, "input-autohide", TYPE_BOOLEAN, TRUE, input_autohide, 0, NULL)
+SETTING(FULLSCREEN, fullscreen, "fullscreen", TYPE_BOOLEAN, FALSE, fullscreen, 0, NULL)
+SETTING(SHOW_TITLEBAR, show_titlebar, "show-titlebar", TYPE_BOOLEAN, TRUE, window_decorate, 0, NULL)
+SETTING(DEFAULT_ZOOM, default_zoom, "default-zoom", TYPE_INTEGER, 100, default_zoom, 0, NULL)
+SETTING(DOWNLOAD_PATH, download_path, "download-path", TYPE_CHAR, SETTING_DOWNLOAD_PATH, NULL, 0, NULL)
+SETTING(DOWNLOAD_COMMAND, download_command, "download-command", TYPE_CHAR, SETTING_DOWNLOAD_COMMAND, NULL, 0, NULL)
+SETTING(DOWNLOAD_USE_EXTERNAL, download_use_external, "download-use-external", TYPE_BOOLEAN, FALSE, NULL, 0, NULL)
+SETTING(INCSEARCH, incsearch, "incsearch", TYPE_BOOLEAN, TRUE, NULL, 0, NULL)
+/* TODO should be global and not overwritten by a new client */
+SETTING(CLOSED_MAX_ITEMS, closed_max_items, "closed-max-items", TYPE_INTEGER, 10, internal, 0, &vb.config.closed_max)
+SETTING(TAB_DISCARD_TIMEOUT, tab_discard_timeout, "tab-discard-timeout", TYPE_INTEGER, 0, internal, 0, &vb.config.tab_discard_timeout)
+/* The resource budget is read from the config file on startup before
+ * the web context is created. Only the cache model can be changed later on,
+ * the setter rejects other values for the memory settings. */
+SETTING(CACHE_MODEL, cache_model, "cache-model", TYPE_CHAR, "web-browser", budget, FLAG_STARTUP, NULL)
+SETTING(MEMORY_LIMIT, memory_limit, "memory-limit", TYPE_INTEGER, BUDGET_MEMORY_LIMIT, budget, FLAG_STARTUP, NULL)
+SETTING(MEMORY_CONSERVATIVE_THRESHOLD, memory_conservative_threshold, "memory-conservative-threshold", TYPE_INTEGER, BUDGET_CONSERVATIVE_THRESHOLD, budget, FLAG_STARTUP, NULL)
+SETTING(MEMORY_STRICT_THRESHOLD, memory_strict_threshold, "memory-strict-threshold", TYPE_INTEGER, BUDGET_STRICT_THRESHOLD, budget, FLAG_STARTUP, NULL)
+SETTING(MEMORY_POLL_INTERVAL, memory_poll_interval, "memory-poll-interval", TYPE_INTEGER, BUDGET_POLL_INTERVAL, budget, FLAG_STARTUP, NULL)
+SETTING(X_HINT_COMMAND, x_hint_command, "x-hint-command", TYPE_CHAR, ":o <C-R>;", NULL, 0, NULL)
+SETTING(SPELL_CHECKING, spell_checking, "spell-checking", TYPE_BOOLEAN, FALSE, webkit_spell_checking, 0, NULL)
+SETTING(SPELL_CHECKING_LANGUAGES, spell_checking_languages, "spell-checking-languages", TYPE_CHAR, "en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL)
+
+/* gui style settings vimb */
+SETTING(COMPLETION_CSS, completion_css, "completion-css", TYPE_CHAR, SETTING_COMPLETION_CSS, gui_style, 0, NULL)
+SETTING(COMPLETION_HOVER_CSS, completion_hover_css, "completion-hover-css", TYPE_CHAR, SETTING_COMPLETION_HOVER_CSS, gui_style, 0, NULL)
+SETTING(COMPLETION_SELECTED_CSS, completion_selected_css, "completion-selected-css", TYPE_CHAR, SETTING_COMPLETION_SELECTED_CSS, gui_style, 0, NULL)
+SETTING(INPUT_CSS, input_css, "input-css", TYPE_CHAR, SETTING_INPUT_CSS, gui_style, 0, NULL)
+SETTING(INPUT_ERROR_CSS, input_error_css, "input-error-css", TYPE_CHAR, SETTING_INPUT_ERROR_CSS, gui_style, 0, NULL)
+SETTING(STATUS_CSS, status_css, "status-css", TYPE_CHAR, SETTING_STATUS_CSS, gui_style, 0, NULL)
+SETTING(STATUS_SSL_CSS, status_ssl_css, "status-ssl-css", TYPE_CHAR, SETTING_STATUS_SSL_CSS, gui_style, 0, NULL)
+SETTING(STATUS_SSL_INVALID_CSS, status_ssl_invalid_css, "status-ssl-invalid-css", TYPE_CHAR, SETTING_STATUS_SSL_INVLID_CSS, gui_style, 0, NULL)
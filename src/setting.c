@@ -18,17 +18,21 @@
  */
 
 #include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../version.h"
+#include "budget.h"
 #include "completion.h"
 #include "config.h"
 #include "ext-proxy.h"
 #include "main.h"
 #include "setting.h"
-#include "scripts/scripts.h"
 #include "shortcut.h"
+#include "site.h"
 #include "regex.h"
+#include "user-content.h"
+#include "util.h"
 
 typedef enum {
     SETTING_SET,        /* :set option=value */
@@ -36,23 +40,46 @@ typedef enum {
     SETTING_PREPEND,    /* :set option^=value */
     SETTING_REMOVE,     /* :set option-=value */
     SETTING_GET,        /* :set option? */
-    SETTING_TOGGLE      /* :set option! */
+    SETTING_TOGGLE,     /* :set option! */
+    SETTING_INIT        /* default applied by setting_init() */
 } SettingType;
 
 enum {
-    FLAG_LIST  = (1<<1),    /* setting contains a ',' separated list of values */
-    FLAG_NODUP = (1<<2),    /* don't allow duplicate strings within list values */
+    FLAG_LIST    = (1<<1),  /* setting contains a ',' separated list of values */
+    FLAG_NODUP   = (1<<2),  /* don't allow duplicate strings within list values */
+    FLAG_STARTUP = (1<<3),  /* setting is read from the config file before the first client exists */
 };
 
-static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type);
-static gboolean prepare_setting_value(Setting *prop, void *value, SettingType type, void **newvalue);
-static gboolean setting_add(Client *c, const char *name, DataType type, void *value,
-    SettingFunction setter, int flags, void *data);
-static void setting_print(Client *c, Setting *s);
-static void setting_free(Setting *s);
+typedef union {
+    gboolean b;
+    int      i;
+    char     *s;
+} SettingValue;
+
+/* The definition of a setting, generated from setting-table.h. */
+typedef struct {
+    const char      *name;
+    DataType        type;
+    size_t          offset;     /* of the value within Settings */
+    SettingValue    def;
+    SettingFunction setter;
+    int             flags;
+    void            *data;      /* data given to the setter */
+} SettingInfo;
+
+static void setting_sort_names(void);
+static int setting_lookup(const char *name);
+static void *setting_parse_value(const SettingInfo *s, const char *param, SettingValue *value);
+static int setting_compare_ids(const void *a, const void *b);
+static int setting_compare_name(const void *name, const void *id);
+static void *setting_value(Client *c, SettingId id);
+static int setting_set_value(Client *c, SettingId id, void *value, SettingType type);
+static gboolean prepare_setting_value(Client *c, SettingId id, void *value, SettingType type, void **newvalue);
+static void setting_print(Client *c, SettingId id);
 
 static int cookie_accept(Client *c, const char *name, DataType type, void *value, void *data);
 static int dark_mode(Client *c, const char *name, DataType type, void *value, void *data);
+static int budget(Client *c, const char *name, DataType type, void *value, void *data);
 static int default_zoom(Client *c, const char *name, DataType type, void *value, void *data);
 static int fullscreen(Client *c, const char *name, DataType type, void *value, void *data);
 static int geolocation(Client *c, const char *name, DataType type, void *value, void *data);
@@ -60,6 +87,7 @@ static int gui_style(Client *c, const char *name, DataType type, void *value, vo
 static int hardware_acceleration_policy(Client *c, const char *name, DataType type, void *value, void *data);
 static int input_autohide(Client *c, const char *name, DataType type, void *value, void *data);
 static int internal(Client *c, const char *name, DataType type, void *value, void *data);
+static int new_window(Client *c, const char *name, DataType type, void *value, void *data);
 static int notification(Client *c, const char *name, DataType type, void *value, void *data);
 static int headers(Client *c, const char *name, DataType type, void *value, void *data);
 static int histignore(Client *c, const char *name, DataType type, void *value, void *data);
@@ -68,6 +96,7 @@ static int user_scripts(Client *c, const char *name, DataType type, void *value,
 static int user_style(Client *c, const char *name, DataType type, void *value, void *data);
 static int smooth_scrolling(Client *c, const char *name, DataType type, void *value, void *data);
 static int statusbar(Client *c, const char *name, DataType type, void *value, void *data);
+static int timeoutlen(Client *c, const char *name, DataType type, void *value, void *data);
 static int tls_policy(Client *c, const char *name, DataType type, void *value, void *data);
 static int webkit(Client *c, const char *name, DataType type, void *value, void *data);
 static int webkit_spell_checking(Client *c, const char *name, DataType type, void *value, void *data);
@@ -76,127 +105,35 @@ static int window_decorate(Client *c, const char *name, DataType type, void *val
 
 extern struct Vimb vb;
 
+#define SETTING_VALUE_TYPE_BOOLEAN(v)   {.b = (v)}
+#define SETTING_VALUE_TYPE_INTEGER(v)   {.i = (v)}
+#define SETTING_VALUE_TYPE_CHAR(v)      {.s = (char*)(v)}
+
+static const SettingInfo settings[SET_COUNT] = {
+#define SETTING(id, field, name, type, def, setter, flags, data) \
+    [SET_##id] = {name, type, G_STRUCT_OFFSET(Settings, field), SETTING_VALUE_##type(def), setter, flags, data},
+#include "setting-table.h"
+#undef SETTING
+};
+
+/* Setting ids sorted by name to lookup settings for :set by binary search
+ * and to complete them in order. */
+static int names[SET_COUNT];
+static gboolean names_sorted = FALSE;
+
 
 void setting_init(Client *c)
 {
+    const SettingInfo *s;
     int i;
-    gboolean on = TRUE, off = FALSE;
-
-    c->config.settings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)setting_free);
-    setting_add(c, "user-agent", TYPE_CHAR, &"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/60.5 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent");
-    /* TODO use the real names for webkit settings */
-    i = 14;
-    /* WebKitGTK 6.0: enable-accelerated-2d-canvas is deprecated and removed - setting removed */
-    /* setting_add(c, "accelerated-2d-canvas", TYPE_BOOLEAN, &off, webkit, 0, "enable-accelerated-2d-canvas"); */
-    setting_add(c, "allow-file-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-file-access-from-file-urls");
-    setting_add(c, "allow-universal-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-universal-access-from-file-urls");
-    setting_add(c, "caret", TYPE_BOOLEAN, &off, webkit, 0, "enable-caret-browsing");
-    setting_add(c, "cursiv-font", TYPE_CHAR, &"serif", webkit, 0, "cursive-font-family");
-    setting_add(c, "dark-mode", TYPE_BOOLEAN, &off, dark_mode, 0, NULL);
-    setting_add(c, "default-charset", TYPE_CHAR, &"utf-8", webkit, 0, "default-charset");
-    setting_add(c, "default-font", TYPE_CHAR, &"sans-serif", webkit, 0, "default-font-family");
-    /* WebKitGTK 6.0: enable-dns-prefetching is deprecated and does nothing - setting removed */
-    /* setting_add(c, "dns-prefetching", TYPE_BOOLEAN, &on, webkit, 0, "enable-dns-prefetching"); */
-    i = SETTING_DEFAULT_FONT_SIZE;
-    setting_add(c, "font-size", TYPE_INTEGER, &i, webkit, 0, "default-font-size");
-    /* WebKitGTK 6.0: enable-frame-flattening is deprecated and removed - setting removed */
-    /* setting_add(c, "frame-flattening", TYPE_BOOLEAN, &off, webkit, 0, "enable-frame-flattening"); */
-    setting_add(c, "geolocation", TYPE_CHAR, &"ask", geolocation, FLAG_NODUP, NULL);
-    setting_add(c, "hardware-acceleration-policy", TYPE_CHAR, &"ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL);
-    setting_add(c, "header", TYPE_CHAR, &"", headers, FLAG_LIST|FLAG_NODUP, "header");
-    i = 1000;
-    setting_add(c, "hint-timeout", TYPE_INTEGER, &i, NULL, 0, NULL);
-    setting_add(c, "hint-keys", TYPE_CHAR, &SETTING_HINT_KEYS, NULL, 0, NULL);
-    setting_add(c, "hint-follow-last", TYPE_BOOLEAN, &on, NULL, 0, NULL);
-    setting_add(c, "hint-keys-same-length", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "hint-match-element", TYPE_BOOLEAN, &on, NULL, 0, NULL);
-    setting_add(c, "histignore", TYPE_CHAR, &SETTING_HISTIGNORE, histignore, 0, NULL);
-    setting_add(c, "html5-database", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-database");
-    setting_add(c, "html5-local-storage", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-local-storage");
-    /* WebKitGTK 6.0: enable-hyperlink-auditing is deprecated and does nothing - setting removed */
-    /* setting_add(c, "hyperlink-auditing", TYPE_BOOLEAN, &off, webkit, 0, "enable-hyperlink-auditing"); */
-    setting_add(c, "images", TYPE_BOOLEAN, &on, webkit, 0, "auto-load-images");
-#if WEBKIT_CHECK_VERSION(2, 30, 0)
-    setting_add(c, "intelligent-tracking-prevention", TYPE_BOOLEAN, &off, intelligent_tracking_prevention, 0, NULL);
-#endif
-    setting_add(c, "javascript-can-access-clipboard", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-access-clipboard");
-    setting_add(c, "javascript-can-open-windows-automatically", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-open-windows-automatically");
-#if WEBKIT_CHECK_VERSION(2, 24, 0)
-    setting_add(c, "javascript-enable-markup", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript-markup");
-#endif
-    setting_add(c, "media", TYPE_BOOLEAN, &on, webkit, 0, "enable-media");
-    setting_add(c, "media-playback-allows-inline", TYPE_BOOLEAN, &on, webkit, 0, "media-playback-allows-inline");
-    setting_add(c, "media-playback-requires-user-gesture", TYPE_BOOLEAN, &off, webkit, 0, "media-playback-requires-user-gesture");
-    setting_add(c, "media-stream", TYPE_BOOLEAN, &off, webkit, 0, "enable-media-stream");
-    setting_add(c, "mediasource", TYPE_BOOLEAN, &off, webkit, 0, "enable-mediasource");
-    i = 5;
-    setting_add(c, "minimum-font-size", TYPE_INTEGER, &i, webkit, 0, "minimum-font-size");
-    setting_add(c, "monospace-font", TYPE_CHAR, &"monospace", webkit, 0, "monospace-font-family");
-    i = SETTING_DEFAULT_MONOSPACE_FONT_SIZE;
-    setting_add(c, "monospace-font-size", TYPE_INTEGER, &i, webkit, 0, "default-monospace-font-size");
-    setting_add(c, "notification", TYPE_CHAR, &"ask", notification, FLAG_NODUP, NULL);
-    /* WebKitGTK 6.0: enable-offline-web-application-cache is deprecated and does nothing - setting removed */
-    /* setting_add(c, "offline-cache", TYPE_BOOLEAN, &on, webkit, 0, "enable-offline-web-application-cache"); */
-    /* WebKitGTK 6.0: enable-plugins is deprecated and removed - setting removed */
-    /* setting_add(c, "plugins", TYPE_BOOLEAN, &on, webkit, 0, "enable-plugins"); */
-    setting_add(c, "prevent-newwindow", TYPE_BOOLEAN, &off, internal, 0, &c->config.prevent_newwindow);
-    setting_add(c, "print-backgrounds", TYPE_BOOLEAN, &on, webkit, 0, "print-backgrounds");
-    setting_add(c, "sans-serif-font", TYPE_CHAR, &"sans-serif", webkit, 0, "sans-serif-font-family");
-    setting_add(c, "scripts", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript");
-    setting_add(c, "serif-font", TYPE_CHAR, &"serif", webkit, 0, "serif-font-family");
-    setting_add(c, "site-specific-quirks", TYPE_BOOLEAN, &off, webkit, 0, "enable-site-specific-quirks");
-    setting_add(c, "smooth-scrolling", TYPE_BOOLEAN, &off, smooth_scrolling, 0, NULL);
-    setting_add(c, "spatial-navigation", TYPE_BOOLEAN, &off, webkit, 0, "enable-spatial-navigation");
-    setting_add(c, "tabs-to-links", TYPE_BOOLEAN, &on, webkit, 0, "enable-tabs-to-links");
-    setting_add(c, "webaudio", TYPE_BOOLEAN, &off, webkit, 0, "enable-webaudio");
-    setting_add(c, "webgl", TYPE_BOOLEAN, &off, webkit, 0, "enable-webgl");
-    setting_add(c, "webinspector", TYPE_BOOLEAN, &on, webkit, 0, "enable-developer-extras");
-    /* WebKitGTK 6.0: enable-xss-auditor is deprecated and removed - setting removed */
-    /* setting_add(c, "xss-auditor", TYPE_BOOLEAN, &on, webkit, 0, "enable-xss-auditor"); */
-
-    /* internal variables */
-    setting_add(c, "stylesheet", TYPE_BOOLEAN, &on, user_style, 0, NULL);
-    setting_add(c, "user-scripts", TYPE_BOOLEAN, &on, user_scripts, 0, NULL);
-    setting_add(c, "cookie-accept", TYPE_CHAR, &SETTING_COOKIE_ACCEPT, cookie_accept, 0, NULL);
-    i = 40;
-    setting_add(c, "scroll-step", TYPE_INTEGER, &i, internal, 0, &c->config.scrollstep);
-    i = 1;
-    setting_add(c, "scroll-multiplier", TYPE_INTEGER, &i, internal, 0, &c->config.scrollmultiplier);
-    setting_add(c, "home-page", TYPE_CHAR, &SETTING_HOME_PAGE, NULL, 0, NULL);
-    i = 2000;
-    setting_add(c, "status-bar-show-settings", TYPE_BOOLEAN, &off, internal, 0, &c->config.statusbar_show_settings);
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "history-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.history_max);
-    setting_add(c, "editor-command", TYPE_CHAR, &"x-terminal-emulator -e -vi '%s'", NULL, 0, NULL);
-    setting_add(c, "strict-ssl", TYPE_BOOLEAN, &on, tls_policy, 0, NULL);
-    setting_add(c, "status-bar", TYPE_BOOLEAN, &on, statusbar, 0, NULL);
-    i = 1000;
-    setting_add(c, "timeoutlen", TYPE_INTEGER, &i, internal, 0, &c->map.timeoutlen);
-    setting_add(c, "input-autohide", TYPE_BOOLEAN, &on, input_autohide, 0, &c->config.input_autohide);
-    setting_add(c, "fullscreen", TYPE_BOOLEAN, &off, fullscreen, 0, NULL);
-    setting_add(c, "show-titlebar", TYPE_BOOLEAN, &on, window_decorate, 0, NULL);
-    i = 100;
-    setting_add(c, "default-zoom", TYPE_INTEGER, &i, default_zoom, 0, NULL);
-    setting_add(c, "download-path", TYPE_CHAR, &SETTING_DOWNLOAD_PATH, NULL, 0, NULL);
-    setting_add(c, "download-command", TYPE_CHAR, &SETTING_DOWNLOAD_COMMAND, NULL, 0, NULL);
-    setting_add(c, "download-use-external", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "incsearch", TYPE_BOOLEAN, &on, internal, 0, &c->config.incsearch);
-    i = 10;
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "closed-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.closed_max);
-    setting_add(c, "x-hint-command", TYPE_CHAR, &":o <C-R>;", NULL, 0, NULL);
-    setting_add(c, "spell-checking", TYPE_BOOLEAN, &off, webkit_spell_checking, 0, NULL);
-    setting_add(c, "spell-checking-languages", TYPE_CHAR, &"en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL);
-
-    /* gui style settings vimb */
-    setting_add(c, "completion-css", TYPE_CHAR, &SETTING_COMPLETION_CSS, gui_style, 0, NULL);
-    setting_add(c, "completion-hover-css", TYPE_CHAR, &SETTING_COMPLETION_HOVER_CSS, gui_style, 0, NULL);
-    setting_add(c, "completion-selected-css", TYPE_CHAR, &SETTING_COMPLETION_SELECTED_CSS, gui_style, 0, NULL);
-    setting_add(c, "input-css", TYPE_CHAR, &SETTING_INPUT_CSS, gui_style, 0, NULL);
-    setting_add(c, "input-error-css", TYPE_CHAR, &SETTING_INPUT_ERROR_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-css", TYPE_CHAR, &SETTING_STATUS_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-ssl-css", TYPE_CHAR, &SETTING_STATUS_SSL_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-ssl-invalid-css", TYPE_CHAR, &SETTING_STATUS_SSL_INVLID_CSS, gui_style, 0, NULL);
+
+    setting_sort_names();
+
+    /* the defaults are applied in the order of the table */
+    for (i = 0; i < SET_COUNT; i++) {
+        s = &settings[i];
+        setting_set_value(c, i, s->type == TYPE_CHAR ? s->def.s : (void*)&s->def, SETTING_INIT);
+    }
 
     /* initialize the shortcuts and set the default shortcuts */
     shortcut_add(c->config.shortcuts, "dl", "https://duckduckgo.com/html/?q=$0");
@@ -233,14 +170,15 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
     }
 
     /* lookup a matching setting */
-    Setting *s = g_hash_table_lookup(c->config.settings, name);
-    if (!s) {
+    int id = setting_lookup(name);
+    if (id < 0) {
         vb_echo(c, MSG_ERROR, TRUE, "Config '%s' not found", name);
         return CMD_ERROR | CMD_KEEPINPUT;
     }
+    const SettingInfo *s = &settings[id];
 
     if (type == SETTING_GET) {
-        setting_print(c, s);
+        setting_print(c, id);
         return CMD_SUCCESS | CMD_KEEPINPUT;
     }
 
@@ -250,9 +188,9 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
 
             return CMD_ERROR | CMD_KEEPINPUT;
         }
-        gboolean value = !s->value.b;
-        res = setting_set_value(c, s, &value, SETTING_SET);
-        setting_print(c, s);
+        gboolean value = !*(gboolean*)setting_value(c, id);
+        res = setting_set_value(c, id, &value, SETTING_SET);
+        setting_print(c, id);
 
         /* make sure the new value set by the toggle keep visible */
         res |= CMD_KEEPINPUT;
@@ -264,24 +202,8 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
         }
 
         /* convert sting value into internal used data type */
-        gboolean boolvar;
-        int intvar;
-        switch (s->type) {
-            case TYPE_BOOLEAN:
-                boolvar = g_ascii_strncasecmp(param, "true", 4) == 0
-                    || g_ascii_strncasecmp(param, "on", 2) == 0;
-                res = setting_set_value(c, s, &boolvar, type);
-                break;
-
-            case TYPE_INTEGER:
-                intvar = g_ascii_strtoull(param, (char**)NULL, 10);
-                res = setting_set_value(c, s, &intvar, type);
-                break;
-
-            default:
-                res = setting_set_value(c, s, (void*)param, type);
-                break;
-        }
+        SettingValue value;
+        res = setting_set_value(c, id, setting_parse_value(s, param, &value), type);
     }
 
     if (res & (CMD_SUCCESS | CMD_KEEPINPUT)) {
@@ -295,57 +217,204 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
 gboolean setting_fill_completion(Client *c, GListStore *store, const char *input)
 {
     gboolean found = FALSE;
-    GList *src     = g_hash_table_get_keys(c->config.settings);
+    const char *name;
+    int i;
 
-    /* If no filter input given - copy all entries into the data store. */
-    if (!input || !*input) {
-        for (GList *l = src; l; l = l->next) {
-            CompletionItem *item = completion_item_new(l->data, NULL);
+    /* If no filter input is given all settings are added, else the names are
+     * compared by prefix matching. */
+    for (i = 0; i < SET_COUNT; i++) {
+        name = settings[names[i]].name;
+        if (!input || !*input || g_str_has_prefix(name, input)) {
+            CompletionItem *item = completion_item_new(name, NULL);
             g_list_store_append(store, item);
             g_object_unref(item);
             found = TRUE;
         }
-        g_list_free(src);
-        return found;
     }
 
-    /* If filter input is given - copy matching list entires into data store.
-     * Strings are compared by prefix matching. */
-    for (GList *l = src; l; l = l->next) {
-        char *value = (char*)l->data;
-        if (g_str_has_prefix(value, input)) {
-            CompletionItem *item = completion_item_new(l->data, NULL);
-            g_list_store_append(store, item);
-            g_object_unref(item);
-            found = TRUE;
+    return found;
+}
+
+/**
+ * Apply the ':set' commands of the config file to the settings that are
+ * needed before the first client exists, like the resource budget. The
+ * values are given to the setters without client.
+ */
+void setting_read_startup(const char *file)
+{
+    char **lines, *line, *param;
+    const SettingInfo *s;
+    SettingValue value;
+    int id;
+
+    if (!(lines = util_get_lines(file))) {
+        return;
+    }
+    setting_sort_names();
+
+    for (int i = 0; lines[i]; i++) {
+        line = g_strstrip(lines[i]);
+        while (*line == ':') {
+            line++;
         }
+        if (g_str_has_prefix(line, "set ")) {
+            line += 4;
+        } else if (g_str_has_prefix(line, "se ")) {
+            line += 3;
+        } else {
+            continue;
+        }
+
+        /* split the input string into parameter and value part like :set */
+        if (!(param = strchr(line, '='))) {
+            continue;
+        }
+        *param++ = '\0';
+        g_strstrip(line);
+        g_strstrip(param);
+
+        id = setting_lookup(line);
+        if (id < 0 || !(settings[id].flags & FLAG_STARTUP)) {
+            continue;
+        }
+        s = &settings[id];
+        s->setter(NULL, s->name, s->type, setting_parse_value(s, param, &value), s->data);
     }
+    g_strfreev(lines);
+}
 
-    g_list_free(src);
-    return found;
+/**
+ * Converts the value given as string for the setting into the value of the
+ * WebKitSettings property the setting is mapped to. Returns the property or
+ * NULL if the setting is unknown or does more than setting the property.
+ */
+const char *setting_webkit_value(const char *name, const char *param, GValue *value)
+{
+    int id = setting_lookup(name);
+
+    if (id < 0 || settings[id].setter != webkit) {
+        return NULL;
+    }
+
+    switch (settings[id].type) {
+        case TYPE_BOOLEAN:
+            g_value_init(value, G_TYPE_BOOLEAN);
+            g_value_set_boolean(value, g_ascii_strncasecmp(param, "true", 4) == 0
+                    || g_ascii_strncasecmp(param, "on", 2) == 0);
+            break;
+
+        case TYPE_INTEGER:
+            g_value_init(value, G_TYPE_UINT);
+            g_value_set_uint(value, g_ascii_strtoull(param, (char**)NULL, 10));
+            break;
+
+        default:
+            g_value_init(value, G_TYPE_STRING);
+            g_value_set_string(value, param);
+            break;
+    }
+
+    return settings[id].data;
 }
 
 void setting_cleanup(Client *c)
 {
-    if (c->config.settings) {
-        g_hash_table_destroy(c->config.settings);
-        c->config.settings = NULL;
+    int i;
+
+    for (i = 0; i < SET_COUNT; i++) {
+        if (settings[i].type == TYPE_CHAR) {
+            char **str = setting_value(c, i);
+            g_free(*str);
+            *str = NULL;
+        }
+    }
+}
+
+/**
+ * Sort the setting ids by name once, which is required by setting_lookup().
+ */
+static void setting_sort_names(void)
+{
+    if (!names_sorted) {
+        for (int i = 0; i < SET_COUNT; i++) {
+            names[i] = i;
+        }
+        qsort(names, SET_COUNT, sizeof(int), setting_compare_ids);
+        names_sorted = TRUE;
     }
 }
 
-static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type)
+/**
+ * Returns the id of the setting with given name or -1 if there is none.
+ */
+static int setting_lookup(const char *name)
+{
+    int *id = bsearch(name, names, SET_COUNT, sizeof(int), setting_compare_name);
+
+    return id ? *id : -1;
+}
+
+/**
+ * Converts the value given as string into the type of the setting. Returns
+ * the pointer to give to the setter, which points into value or is param
+ * itself for string settings.
+ */
+static void *setting_parse_value(const SettingInfo *s, const char *param, SettingValue *value)
 {
+    switch (s->type) {
+        case TYPE_BOOLEAN:
+            value->b = g_ascii_strncasecmp(param, "true", 4) == 0
+                || g_ascii_strncasecmp(param, "on", 2) == 0;
+            return &value->b;
+
+        case TYPE_INTEGER:
+            value->i = g_ascii_strtoull(param, (char**)NULL, 10);
+            return &value->i;
+
+        default:
+            return (void*)param;
+    }
+}
+
+/**
+ * Compares the names of two settings given by pointers to their ids.
+ */
+static int setting_compare_ids(const void *a, const void *b)
+{
+    return strcmp(settings[*(const int*)a].name, settings[*(const int*)b].name);
+}
+
+/**
+ * Compares the name with the name of the setting the id points to.
+ */
+static int setting_compare_name(const void *name, const void *id)
+{
+    return strcmp((const char*)name, settings[*(const int*)id].name);
+}
+
+/**
+ * Returns a pointer to the value of the setting within the client settings.
+ */
+static void *setting_value(Client *c, SettingId id)
+{
+    return G_STRUCT_MEMBER_P(&c->config.settings, settings[id].offset);
+}
+
+static int setting_set_value(Client *c, SettingId id, void *value, SettingType type)
+{
+    const SettingInfo *prop = &settings[id];
+    void *field = setting_value(c, id);
     int res = CMD_SUCCESS;
     /* by default given value is also the new value */
     void *newvalue = NULL;
     gboolean free_newvalue;
 
     /* get prepared value according to setting type */
-    free_newvalue = prepare_setting_value(prop, value, type, &newvalue);
+    free_newvalue = prepare_setting_value(c, id, value, type, &newvalue);
 
     /* if there is a setter defined - call this first to check if the value is
-     * accepted */
-    if (prop->setter) {
+     * accepted, settings read on startup keep the value they got then */
+    if (prop->setter && !(type == SETTING_INIT && prop->flags & FLAG_STARTUP)) {
         res = prop->setter(c, prop->name, prop->type, newvalue, prop->data);
         /* break here on error and don't change the setting */
         if (!(res & CMD_SUCCESS)) {
@@ -356,15 +425,15 @@ static int setting_set_value(Client *c, Setting *prop, void *value, SettingType
     /* save the new value also in the setting */
     switch (prop->type) {
         case TYPE_BOOLEAN:
-            prop->value.b = *((gboolean*)newvalue);
+            *(gboolean*)field = *((gboolean*)newvalue);
             break;
 
         case TYPE_INTEGER:
-            prop->value.i = *((int*)newvalue);
+            *(int*)field = *((int*)newvalue);
             break;
 
         default:
-            OVERWRITE_STRING(prop->value.s, newvalue);
+            OVERWRITE_STRING(*(char**)field, newvalue);
             break;
     }
 
@@ -380,11 +449,13 @@ free:
  * Return value TRUE indicates that the memory of newvalue must be freed by
  * the caller.
  */
-static gboolean prepare_setting_value(Setting *prop, void *value, SettingType type, void **newvalue)
+static gboolean prepare_setting_value(Client *c, SettingId id, void *value, SettingType type, void **newvalue)
 {
+    const SettingInfo *prop = &settings[id];
+    void *field = setting_value(c, id);
     gboolean islist, res = FALSE;
     int vlen, i = 0;
-    char *p = NULL;
+    char *p = NULL, *current;
 
     if ((type != SETTING_APPEND && type != SETTING_PREPEND && type != SETTING_REMOVE)
         || prop->type == TYPE_BOOLEAN
@@ -399,22 +470,24 @@ static gboolean prepare_setting_value(Setting *prop, void *value, SettingType ty
         int *newint = g_malloc(sizeof(int));
         res         = TRUE;
         if (type == SETTING_APPEND) {
-            *newint = prop->value.i + *((int*)value);
+            *newint = *(int*)field + *((int*)value);
         } else if (type == SETTING_PREPEND) {
-            *newint = prop->value.i * *((int*)value);
+            *newint = *(int*)field * *((int*)value);
         } else if (type == SETTING_REMOVE) {
-            *newint = prop->value.i - *((int*)value);
+            *newint = *(int*)field - *((int*)value);
         }
         *newvalue = (void*)newint;
         return res;
     }
 
+    current = *(char**)field;
+
     /* handle operations on currently empty value */
-    if (!*prop->value.s) {
+    if (!*current) {
         if (type == SETTING_APPEND || type == SETTING_PREPEND) {
             *newvalue = value;
         } else {
-            *newvalue = prop->value.s;
+            *newvalue = current;
         }
         return res;
     }
@@ -424,14 +497,14 @@ static gboolean prepare_setting_value(Setting *prop, void *value, SettingType ty
 
     /* check if value already exists in current set option */
     if (type == SETTING_REMOVE || prop->flags & FLAG_NODUP) {
-        for (p = prop->value.s; *p; p++) {
-            if ((!islist || p == prop->value.s || (p[-1] == ','))
+        for (p = current; *p; p++) {
+            if ((!islist || p == current || (p[-1] == ','))
                 && strncmp(p, value, vlen) == 0
                 && (!islist || p[vlen] == ',' || p[vlen] == '\0')
             ) {
                 i = vlen;
                 if (islist) {
-                    if (p == prop->value.s) {
+                    if (p == current) {
                         /* include the comma after the matched string */
                         if (p[vlen] == ',') {
                             i++;
@@ -456,23 +529,23 @@ static gboolean prepare_setting_value(Setting *prop, void *value, SettingType ty
     if (type == SETTING_APPEND) {
         if (islist && *(char*)value) {
             /* don't append a comma if the value is empty */
-            *newvalue = g_strconcat(prop->value.s, ",", value, NULL);
+            *newvalue = g_strconcat(current, ",", value, NULL);
         } else {
-            *newvalue = g_strconcat(prop->value.s, value, NULL);
+            *newvalue = g_strconcat(current, value, NULL);
         }
         res = TRUE;
     } else if (type == SETTING_PREPEND) {
         if (islist && *(char*)value) {
             /* don't prepend a comma if the value is empty */
-            *newvalue = g_strconcat(value, ",", prop->value.s, NULL);
+            *newvalue = g_strconcat(value, ",", current, NULL);
         } else {
-            *newvalue = g_strconcat(value, prop->value.s, NULL);
+            *newvalue = g_strconcat(value, current, NULL);
         }
         res = TRUE;
     } else if (type == SETTING_REMOVE && p) {
-        char *copy = g_strdup(prop->value.s);
+        char *copy = g_strdup(current);
         /* make p to point to the same position in the copy */
-        p = copy + (p - prop->value.s);
+        p = copy + (p - current);
 
         memmove(p, p + i, 1 + strlen(p + vlen));
         *newvalue = copy;
@@ -482,47 +555,26 @@ static gboolean prepare_setting_value(Setting *prop, void *value, SettingType ty
     return res;
 }
 
-static gboolean setting_add(Client *c, const char *name, DataType type, void *value,
-        SettingFunction setter, int flags, void *data)
+static void setting_print(Client *c, SettingId id)
 {
-    Setting *prop = g_slice_new0(Setting);
-    prop->name   = name;
-    prop->type   = type;
-    prop->setter = setter;
-    prop->flags  = flags;
-    prop->data   = data;
-
-    setting_set_value(c, prop, value, SETTING_SET);
+    const SettingInfo *s = &settings[id];
+    void *value          = setting_value(c, id);
 
-    g_hash_table_insert(c->config.settings, (char*)name, prop);
-    return TRUE;
-}
-
-static void setting_print(Client *c, Setting *s)
-{
     switch (s->type) {
         case TYPE_BOOLEAN:
-            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%s", s->name, s->value.b ? "true" : "false");
+            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%s", s->name, *(gboolean*)value ? "true" : "false");
             break;
 
         case TYPE_INTEGER:
-            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%d", s->name, s->value.i);
+            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%d", s->name, *(int*)value);
             break;
 
         default:
-            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%s", s->name, s->value.s);
+            vb_echo(c, MSG_NORMAL, FALSE, "  %s=%s", s->name, *(char**)value);
             break;
     }
 }
 
-static void setting_free(Setting *s)
-{
-    if (s->type == TYPE_CHAR || s->type == TYPE_COLOR || s->type == TYPE_FONT) {
-        g_free(s->value.s);
-    }
-    g_slice_free(Setting, s);
-}
-
 static int cookie_accept(Client *c, const char *name, DataType type, void *value, void *data)
 {
     WebKitCookieManager *cm;
@@ -552,14 +604,16 @@ static int dark_mode(Client *c, const char *name, DataType type, void *value, vo
     return CMD_SUCCESS;
 }
 
-static int default_zoom(Client *c, const char *name, DataType type, void *value, void *data)
+static int budget(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    /* Store the percent value in the client config. */
-    c->config.default_zoom = *(int*)value;
+    return budget_set(c, name, value);
+}
 
+static int default_zoom(Client *c, const char *name, DataType type, void *value, void *data)
+{
     /* Apply the default zoom to the webview. */
     webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(c->webview), FALSE);
-    webkit_web_view_set_zoom_level(c->webview, c->config.default_zoom / 100.0);
+    webkit_web_view_set_zoom_level(c->webview, *(int*)value / 100.0);
 
     return CMD_SUCCESS;
 }
@@ -607,7 +661,7 @@ static int window_decorate(Client *c, const char *name, DataType type, void *val
 
 static int hardware_acceleration_policy(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitSettings *settings = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *settings = site_base_settings(c);
 
     /* WebKitGTK 6.0: ON_DEMAND policy removed - map to ALWAYS for compatibility */
     if (g_str_equal(value, "ondemand") || g_str_equal(value, "always")) {
@@ -618,6 +672,7 @@ static int hardware_acceleration_policy(Client *c, const char *name, DataType ty
         vb_echo(c, MSG_ERROR, TRUE, "%s must be in [ondemand, always, never]", name);
         return CMD_ERROR|CMD_KEEPINPUT;
     }
+    site_settings_changed(c);
 
     return CMD_SUCCESS;
 }
@@ -625,12 +680,13 @@ static int hardware_acceleration_policy(Client *c, const char *name, DataType ty
 /**
  * Allow to set user defined http headers.
  *
- * :set header=NAME1=VALUE!,NAME2=,NAME3
+ * :set header=NAME1=VALUE!,NAME2=,NAME3,HOST:NAME4=VALUE
  *
  * Note that these headers will replace already existing headers. If there is
  * no '=' after the header name, than the complete header will be removed from
  * the request (NAME3), if the '=' is present means that the header value is
- * set to empty value.
+ * set to empty value. Headers prefixed by a host are only changed for requests
+ * to that host and its subdomains.
  */
 static int headers(Client *c, const char *name, DataType type, void *value, void *data)
 {
@@ -671,9 +727,6 @@ static int input_autohide(Client *c, const char *name, DataType type, void *valu
 {
     char *text;
 
-    /* save selected value in internal variable */
-    *(gboolean*)data = *(gboolean*)value;
-
     /* if autohide is on and inputbox contains no text - hide it now */
     if (*(gboolean*)value) {
         text = vb_input_get_text(c);
@@ -709,6 +762,22 @@ static int internal(Client *c, const char *name, DataType type, void *value, voi
     return CMD_SUCCESS;
 }
 
+static int new_window(Client *c, const char *name, DataType type, void *value, void *data)
+{
+    if (g_str_equal(value, "tab")) {
+        c->config.new_window = NEW_WINDOW_TAB;
+    } else if (g_str_equal(value, "background")) {
+        c->config.new_window = NEW_WINDOW_BACKGROUND;
+    } else if (g_str_equal(value, "process")) {
+        c->config.new_window = NEW_WINDOW_PROCESS;
+    } else {
+        vb_echo(c, MSG_ERROR, TRUE, "%s must be in [tab, background, process]", name);
+        return CMD_ERROR|CMD_KEEPINPUT;
+    }
+
+    return CMD_SUCCESS;
+}
+
 static int notification(Client *c, const char *name, DataType type, void *value, void *data)
 {
     char *policy = (char *)value;
@@ -721,99 +790,26 @@ static int notification(Client *c, const char *name, DataType type, void *value,
 
 static int user_scripts(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitUserContentManager *ucm;
-    WebKitUserScript *script;
-    gchar *source;
-
-    gboolean enabled = *(gboolean*)value;
-
-    ucm = webkit_web_view_get_user_content_manager(c->webview);
-    webkit_user_content_manager_remove_all_scripts(ucm);
-
-    if (enabled) {
-        if (vb.files[FILES_SCRIPT]
-                && g_file_get_contents(vb.files[FILES_SCRIPT], &source, NULL, NULL)) {
-
-            script = webkit_user_script_new(
-                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL
-            );
-
-            webkit_user_content_manager_add_script(ucm, script);
-            webkit_user_script_unref(script);
-            g_free(source);
-        }
-    }
-
-    /* Inject the global scripts: hints, scroll, scroll observer, and focus tracking.
-     * Focus tracking detects when editable elements gain/lose focus to
-     * automatically switch vimb between normal and input modes.
-     *
-     * Focus tracking script should be injected at the start of a document
-     * since document may have an input or textarea with an autofocus
-     * attribute or there may be a script in the middle of a document that sets
-     * focus to some element. */
-    script = webkit_user_script_new(
-            JS_FOCUS_TRACKING,
-            WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
-            WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START, NULL, NULL);
-    webkit_user_content_manager_add_script(ucm, script);
-    webkit_user_script_unref(script);
-
-    script = webkit_user_script_new(
-            JS_HINTS " " JS_SCROLL " " JS_SCROLL_OBSERVER,
-            WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
-            WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
-    webkit_user_content_manager_add_script(ucm, script);
-    webkit_user_script_unref(script);
+    user_content_add_scripts(webkit_web_view_get_user_content_manager(c->webview),
+            *(gboolean*)value);
 
     return CMD_SUCCESS;
 }
 
 static int user_style(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitUserContentManager *ucm;
-    WebKitUserStyleSheet *style;
-    gchar *source;
-
-    gboolean enabled = *(gboolean*)value;
-
-    ucm = webkit_web_view_get_user_content_manager(c->webview);
-
-    if (enabled) {
-        if (g_file_get_contents(vb.files[FILES_USER_STYLE], &source, NULL, NULL)) {
-            style = webkit_user_style_sheet_new(
-                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-                WEBKIT_USER_STYLE_LEVEL_USER, NULL, NULL
-            );
-
-            webkit_user_content_manager_add_style_sheet(ucm, style);
-            webkit_user_style_sheet_unref(style);
-            g_free(source);
-        } else {
-            g_message("Could not read style file: %s", vb.files[FILES_USER_STYLE]);
-        }
-    } else {
-        webkit_user_content_manager_remove_all_style_sheets(ucm);
-    }
-
-    /* Inject the global styles with author level to allow restyling by user
-     * style sheets. */
-    style = webkit_user_style_sheet_new(CSS_HINTS,
-            WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-            WEBKIT_USER_STYLE_LEVEL_AUTHOR, NULL, NULL);
-    webkit_user_content_manager_add_style_sheet(ucm, style);
-    webkit_user_style_sheet_unref(style);
+    user_content_add_styles(webkit_web_view_get_user_content_manager(c->webview),
+            *(gboolean*)value);
 
     return CMD_SUCCESS;
 }
 
 static int smooth_scrolling(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitSettings *settings = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *settings = site_base_settings(c);
 
     webkit_settings_set_enable_smooth_scrolling(settings, *(gboolean*) value);
-    c->config.smooth_scrolling = *(gboolean*) value;
+    site_settings_changed(c);
 
     return CMD_SUCCESS;
 }
@@ -825,6 +821,13 @@ static int statusbar(Client *c, const char *name, DataType type, void *value, vo
     return CMD_SUCCESS;
 }
 
+static int timeoutlen(Client *c, const char *name, DataType type, void *value, void *data)
+{
+    c->map.timeoutlen = *(int*)value;
+
+    return CMD_SUCCESS;
+}
+
 static int gui_style(Client *c, const char *name, DataType type, void *value, void *data)
 {
     vb_gui_style_update(c, name, (const char*)value);
@@ -852,7 +855,7 @@ static int tls_policy(Client *c, const char *name, DataType type, void *value, v
 static int webkit(Client *c, const char *name, DataType type, void *value, void *data)
 {
     const char *property = (const char*)data;
-    WebKitSettings *web_setting = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *web_setting = site_base_settings(c);
 
     /* WebKitGTK 6.0: Skip deprecated properties that no longer exist */
     if (g_str_equal(property, "enable-dns-prefetching") ||
@@ -879,6 +882,8 @@ static int webkit(Client *c, const char *name, DataType type, void *value, void
             g_object_set(G_OBJECT(web_setting), property, (char*)value, NULL);
             break;
     }
+    site_settings_changed(c);
+
     return CMD_SUCCESS;
 }
 
@@ -28,5 +28,7 @@ void setting_init(Client *c);
 void setting_cleanup(Client *c);
 VbCmdResult setting_run(Client *c, char *name, const char *param);
 gboolean setting_fill_completion(Client *c, GListStore *store, const char *input);
+void setting_read_startup(const char *file);
+const char *setting_webkit_value(const char *name, const char *param, GValue *value);
 
 #endif /* end of include guard: _SETTING_H */
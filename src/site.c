@@ -0,0 +1,360 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Site profiles override settings for a host and its subdomains. Each
+ * profile is compiled into a WebKitSettings object per client, a copy of the
+ * settings changed by :set with the overrides applied. The object for the
+ * host is put on the webview before a navigation starts, so no ex command
+ * has to be run for the page.
+ */
+#include <glib.h>
+#include <string.h>
+#include <webkit/webkit.h>
+
+#include "main.h"
+#include "setting.h"
+#include "site.h"
+
+extern struct Vimb vb;
+
+/* A WebKitSettings property set by a profile. */
+typedef struct {
+    const char  *property;
+    GValue      value;
+} SiteOverride;
+
+typedef struct {
+    char        *host;
+    GArray      *overrides;     /* SiteOverride */
+} SiteProfile;
+
+/* The settings objects of a client. */
+typedef struct {
+    WebKitSettings  *base;      /* the settings changed by :set */
+    GHashTable      *cache;     /* SiteProfile* -> WebKitSettings* */
+    SiteProfile     *active;    /* profile of the current page or NULL */
+} SiteClient;
+
+static struct {
+    GHashTable  *profiles;  /* host -> SiteProfile* */
+    GHashTable  *resolved;  /* host -> SiteProfile* or NULL for hosts without */
+    GHashTable  *clients;   /* Client* -> SiteClient* */
+} site;
+
+static SiteProfile *profile_lookup(const char *host);
+static void profile_changed(SiteProfile *profile, gboolean removed);
+static void profile_free(SiteProfile *profile);
+static WebKitSettings *client_settings(SiteClient *sc, SiteProfile *profile);
+static void client_free(SiteClient *sc);
+static WebKitSettings *settings_copy(WebKitSettings *base);
+
+
+/**
+ * Add the setting to the profile for the host. A value given before for the
+ * same setting is replaced.
+ */
+gboolean site_add(Client *c, const char *host, const char *name, const char *value)
+{
+    SiteProfile *profile;
+    SiteOverride override = {NULL, G_VALUE_INIT}, *o;
+    char *key;
+    guint i;
+
+    if (!*host) {
+        return FALSE;
+    }
+    if (!(override.property = setting_webkit_value(name, value, &override.value))) {
+        vb_echo(c, MSG_ERROR, TRUE, "Setting '%s' can't be used for sites", name);
+        return FALSE;
+    }
+
+    if (!site.profiles) {
+        site.profiles = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                (GDestroyNotify)profile_free);
+        site.resolved = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    key = g_ascii_strdown(host, -1);
+    if (!(profile = g_hash_table_lookup(site.profiles, key))) {
+        profile            = g_slice_new(SiteProfile);
+        profile->host      = key;
+        profile->overrides = g_array_new(FALSE, FALSE, sizeof(SiteOverride));
+        g_hash_table_insert(site.profiles, profile->host, profile);
+        g_hash_table_remove_all(site.resolved);
+    } else {
+        g_free(key);
+    }
+
+    for (i = 0; i < profile->overrides->len; i++) {
+        o = &g_array_index(profile->overrides, SiteOverride, i);
+        if (!strcmp(o->property, override.property)) {
+            g_value_unset(&o->value);
+            *o = override;
+            break;
+        }
+    }
+    if (i == profile->overrides->len) {
+        g_array_append_val(profile->overrides, override);
+    }
+
+    profile_changed(profile, FALSE);
+
+    return TRUE;
+}
+
+/**
+ * Remove the profile for the host.
+ */
+gboolean site_remove(const char *host)
+{
+    SiteProfile *profile;
+    char *key;
+
+    if (!site.profiles) {
+        return FALSE;
+    }
+
+    key     = g_ascii_strdown(host, -1);
+    profile = g_hash_table_lookup(site.profiles, key);
+    g_free(key);
+    if (!profile) {
+        return FALSE;
+    }
+
+    profile_changed(profile, TRUE);
+    g_hash_table_remove_all(site.resolved);
+    g_hash_table_remove(site.profiles, profile->host);
+
+    return TRUE;
+}
+
+/**
+ * Put the settings for the lower case host of a uri on the webview of the
+ * client. This is called when the load of the main frame starts. The host
+ * is NULL for uris without one.
+ */
+void site_apply(Client *c, const char *host)
+{
+    SiteProfile *profile;
+    SiteClient *sc;
+
+    if (!site.profiles || !c->webview) {
+        return;
+    }
+
+    profile = host ? profile_lookup(host) : NULL;
+    if (!site.clients) {
+        site.clients = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)client_free);
+    }
+    if (!(sc = g_hash_table_lookup(site.clients, c))) {
+        if (!profile) {
+            return;
+        }
+        /* no profile was used so far, so the settings of the webview are
+         * those changed by :set */
+        sc        = g_slice_new(SiteClient);
+        sc->base  = g_object_ref(webkit_web_view_get_settings(c->webview));
+        sc->cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_object_unref);
+        sc->active = NULL;
+        g_hash_table_insert(site.clients, c, sc);
+    }
+
+    if (sc->active != profile) {
+        sc->active = profile;
+        webkit_web_view_set_settings(c->webview, client_settings(sc, profile));
+    }
+}
+
+/**
+ * Returns the settings of the client that are changed by :set.
+ */
+WebKitSettings *site_base_settings(Client *c)
+{
+    SiteClient *sc;
+
+    if (site.clients && (sc = g_hash_table_lookup(site.clients, c))) {
+        return sc->base;
+    }
+    return webkit_web_view_get_settings(c->webview);
+}
+
+/**
+ * Recompile the profiles of the client after its base settings have been
+ * changed.
+ */
+void site_settings_changed(Client *c)
+{
+    SiteClient *sc;
+
+    if (!site.clients || !(sc = g_hash_table_lookup(site.clients, c))) {
+        return;
+    }
+
+    g_hash_table_remove_all(sc->cache);
+    if (sc->active && c->webview) {
+        webkit_web_view_set_settings(c->webview, client_settings(sc, sc->active));
+    }
+}
+
+void site_client_remove(Client *c)
+{
+    if (site.clients) {
+        g_hash_table_remove(site.clients, c);
+    }
+}
+
+void site_cleanup(void)
+{
+    if (site.clients) {
+        g_hash_table_destroy(site.clients);
+        site.clients = NULL;
+    }
+    if (site.profiles) {
+        g_hash_table_destroy(site.resolved);
+        g_hash_table_destroy(site.profiles);
+        site.resolved = NULL;
+        site.profiles = NULL;
+    }
+}
+
+/**
+ * Returns the profile for the host of the uri, that is the profile of the
+ * most specific of the host and its parent domains, or NULL.
+ */
+static SiteProfile *profile_lookup(const char *host)
+{
+    SiteProfile *profile = NULL;
+    const char *p;
+
+    if (g_hash_table_lookup_extended(site.resolved, host, NULL, (gpointer*)&profile)) {
+        return profile;
+    }
+
+    for (p = host; p && !profile; p = strchr(p, '.')) {
+        if (*p == '.') {
+            p++;
+        }
+        profile = g_hash_table_lookup(site.profiles, p);
+    }
+    g_hash_table_insert(site.resolved, g_strdup(host), profile);
+
+    return profile;
+}
+
+/**
+ * Drop the compiled settings of the profile and update the webviews that
+ * use it.
+ */
+static void profile_changed(SiteProfile *profile, gboolean removed)
+{
+    GHashTableIter iter;
+    Client *c;
+    SiteClient *sc;
+
+    if (!site.clients) {
+        return;
+    }
+
+    g_hash_table_iter_init(&iter, site.clients);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&c, (gpointer*)&sc)) {
+        g_hash_table_remove(sc->cache, profile);
+        if (sc->active == profile && c->webview) {
+            if (removed) {
+                sc->active = NULL;
+            }
+            webkit_web_view_set_settings(c->webview, client_settings(sc, sc->active));
+        }
+    }
+}
+
+static void profile_free(SiteProfile *profile)
+{
+    guint i;
+
+    for (i = 0; i < profile->overrides->len; i++) {
+        g_value_unset(&g_array_index(profile->overrides, SiteOverride, i).value);
+    }
+    g_array_free(profile->overrides, TRUE);
+    g_free(profile->host);
+    g_slice_free(SiteProfile, profile);
+}
+
+/**
+ * Returns the settings object of the client for the profile, or the base
+ * settings if profile is NULL.
+ */
+static WebKitSettings *client_settings(SiteClient *sc, SiteProfile *profile)
+{
+    WebKitSettings *settings;
+    SiteOverride *o;
+    guint i;
+
+    if (!profile) {
+        return sc->base;
+    }
+    if ((settings = g_hash_table_lookup(sc->cache, profile))) {
+        return settings;
+    }
+
+    settings = settings_copy(sc->base);
+    for (i = 0; i < profile->overrides->len; i++) {
+        o = &g_array_index(profile->overrides, SiteOverride, i);
+        g_object_set_property(G_OBJECT(settings), o->property, &o->value);
+    }
+    g_hash_table_insert(sc->cache, profile, settings);
+
+    return settings;
+}
+
+static void client_free(SiteClient *sc)
+{
+    g_object_unref(sc->base);
+    g_hash_table_destroy(sc->cache);
+    g_slice_free(SiteClient, sc);
+}
+
+/**
+ * Create new settings with all the properties of base.
+ */
+static WebKitSettings *settings_copy(WebKitSettings *base)
+{
+    WebKitSettings *copy = webkit_settings_new();
+    GValue value = G_VALUE_INIT;
+    GParamSpec **specs;
+    guint n, i;
+
+    specs = g_object_class_list_properties(G_OBJECT_GET_CLASS(base), &n);
+    g_object_freeze_notify(G_OBJECT(copy));
+    for (i = 0; i < n; i++) {
+        if ((specs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE
+                || specs[i]->flags & (G_PARAM_CONSTRUCT_ONLY | G_PARAM_DEPRECATED)) {
+            continue;
+        }
+        g_value_init(&value, specs[i]->value_type);
+        g_object_get_property(G_OBJECT(base), specs[i]->name, &value);
+        g_object_set_property(G_OBJECT(copy), specs[i]->name, &value);
+        g_value_unset(&value);
+    }
+    g_object_thaw_notify(G_OBJECT(copy));
+    g_free(specs);
+
+    return copy;
+}
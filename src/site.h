@@ -0,0 +1,33 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _SITE_H
+#define _SITE_H
+
+#include "main.h"
+
+gboolean site_add(Client *c, const char *host, const char *name, const char *value);
+gboolean site_remove(const char *host);
+void site_apply(Client *c, const char *host);
+WebKitSettings *site_base_settings(Client *c);
+void site_settings_changed(Client *c);
+void site_client_remove(Client *c);
+void site_cleanup(void);
+
+#endif /* end of include guard: _SITE_H */
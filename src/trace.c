@@ -0,0 +1,188 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "trace.h"
+
+typedef struct {
+    const char  *name;
+    gint64      ts;         /* monotonic time in microseconds */
+    guint64     id;         /* id of async events */
+    char        phase;      /* phase as used in the chrome trace format */
+} TraceEvent;
+
+/* Ring of the latest events of a single thread. Only the owning thread
+ * writes to it, so no lock is needed to record an event. The head is
+ * published atomically to allow the main thread to read the events. */
+typedef struct {
+    guint       tid;
+    gint        head;       /* number of events written so far */
+    TraceEvent  events[TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+static struct {
+    GMutex  lock;       /* guards the list of buffers */
+    GSList  *buffers;
+    guint   next_tid;
+    gint64  started;    /* events before this time are not exported */
+} trace;
+
+static GPrivate buffer_key = G_PRIVATE_INIT(NULL);
+
+static void record(const char *name, char phase, guint64 id);
+static TraceBuffer *buffer_new(void);
+static void append_event(GString *json, const TraceEvent *ev, int pid, guint tid);
+
+
+/**
+ * Mark the begin of a span on the current thread.
+ */
+void trace_begin(const char *name)
+{
+    record(name, 'B', 0);
+}
+
+/**
+ * Mark the end of the span started by trace_begin() with the same name.
+ */
+void trace_end(const char *name)
+{
+    record(name, 'E', 0);
+}
+
+void trace_instant(const char *name)
+{
+    record(name, 'i', 0);
+}
+
+/**
+ * Mark the begin of a span that ends in another callback, like the load of
+ * a page. The id is used to match the begin and the end.
+ */
+void trace_async_begin(const char *name, guint64 id)
+{
+    record(name, 'b', id);
+}
+
+void trace_async_end(const char *name, guint64 id)
+{
+    record(name, 'e', id);
+}
+
+/**
+ * Events are always recorded, this only drops the events recorded before.
+ */
+void trace_start(void)
+{
+    trace.started = g_get_monotonic_time();
+}
+
+/**
+ * Write the recorded events since the last trace_start() to file in the
+ * chrome trace event format that can be opened by Perfetto or
+ * chrome://tracing.
+ */
+gboolean trace_stop(const char *file, GError **error)
+{
+    GString *json;
+    TraceBuffer *buf;
+    guint head, i;
+    gboolean res;
+    int pid = getpid();
+
+    json = g_string_new("{\"traceEvents\":[");
+
+    g_mutex_lock(&trace.lock);
+    for (GSList *l = trace.buffers; l; l = l->next) {
+        buf  = l->data;
+        head = (guint)g_atomic_int_get(&buf->head);
+        i    = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+        for (; i != head; i++) {
+            if (buf->events[i % TRACE_BUFFER_SIZE].ts >= trace.started) {
+                append_event(json, &buf->events[i % TRACE_BUFFER_SIZE], pid, buf->tid);
+            }
+        }
+    }
+    g_mutex_unlock(&trace.lock);
+
+    /* remove the trailing comma of the last event */
+    if (json->str[json->len - 1] == ',') {
+        g_string_truncate(json, json->len - 1);
+    }
+    g_string_append(json, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    res = g_file_set_contents(file, json->str, json->len, error);
+    g_string_free(json, TRUE);
+    trace.started = 0;
+
+    return res;
+}
+
+static void record(const char *name, char phase, guint64 id)
+{
+    TraceBuffer *buf = g_private_get(&buffer_key);
+    TraceEvent *ev;
+    guint head;
+
+    if (G_UNLIKELY(!buf)) {
+        buf = buffer_new();
+    }
+
+    head      = (guint)buf->head;
+    ev        = &buf->events[head % TRACE_BUFFER_SIZE];
+    ev->name  = name;
+    ev->ts    = g_get_monotonic_time();
+    ev->id    = id;
+    ev->phase = phase;
+    g_atomic_int_set(&buf->head, (gint)(head + 1));
+}
+
+/**
+ * Create the buffer for the current thread. The buffers are kept until the
+ * end of the program, so that events of finished threads can be exported.
+ */
+static TraceBuffer *buffer_new(void)
+{
+    TraceBuffer *buf = g_new0(TraceBuffer, 1);
+
+    g_mutex_lock(&trace.lock);
+    buf->tid      = ++trace.next_tid;
+    trace.buffers = g_slist_append(trace.buffers, buf);
+    g_mutex_unlock(&trace.lock);
+
+    g_private_set(&buffer_key, buf);
+
+    return buf;
+}
+
+static void append_event(GString *json, const TraceEvent *ev, int pid, guint tid)
+{
+    g_string_append_printf(json,
+            "\n{\"name\":\"%s\",\"cat\":\"vimb\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u",
+            ev->name, ev->phase, ev->ts, pid, tid);
+    if (ev->phase == 'b' || ev->phase == 'e') {
+        g_string_append_printf(json, ",\"id\":\"0x%" G_GINT64_MODIFIER "x\"", ev->id);
+    } else if (ev->phase == 'i') {
+        g_string_append(json, ",\"s\":\"t\"");
+    }
+    g_string_append(json, "},");
+}
@@ -0,0 +1,35 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <glib.h>
+
+/* The name of the events must be a string literal, only the pointer is
+ * recorded. */
+void trace_begin(const char *name);
+void trace_end(const char *name);
+void trace_instant(const char *name);
+void trace_async_begin(const char *name, guint64 id);
+void trace_async_end(const char *name, guint64 id);
+void trace_start(void);
+gboolean trace_stop(const char *file, GError **error);
+
+#endif /* end of include guard: _TRACE_H */
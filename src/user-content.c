@@ -0,0 +1,572 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "main.h"
+#include "user-content.h"
+#include "util.h"
+#include "scripts/scripts.h"
+
+extern struct Vimb vb;
+
+/* A compiled content filter and some information about it's source. */
+typedef struct {
+    WebKitUserContentFilter *filter;
+    goffset                 size;           /* size of the source file in bytes */
+    gint64                  compile_time;   /* microseconds of last compilation, 0 if loaded from store */
+} Filter;
+
+/* Data of a single running filter compilation. */
+typedef struct {
+    char    *id;
+    goffset size;
+    gint64  start;
+} FilterJob;
+
+/* A user content file that is read once and watched for changes. */
+typedef struct {
+    GFileMonitor *monitor;
+    gboolean     loaded;    /* FALSE if the file has to be (re)read */
+    gpointer     content;   /* WebKitUserScript or WebKitUserStyleSheet */
+} CachedFile;
+
+static void cached_file_watch(CachedFile *cf, const char *path);
+static void cached_file_clear(CachedFile *cf);
+static void on_file_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other_file, GFileMonitorEvent event, CachedFile *cf);
+static WebKitUserScript *get_user_script(void);
+static WebKitUserStyleSheet *get_user_style(void);
+static void filter_attach(const char *id, WebKitUserContentFilter *filter,
+        goffset size, gint64 compile_time);
+static void filter_detach(const char *id);
+static void filter_free(Filter *f);
+static void on_filter_identifiers_fetched(GObject *source, GAsyncResult *res, gpointer data);
+static void on_filter_loaded(GObject *source, GAsyncResult *res, gpointer data);
+static void on_filter_saved(GObject *source, GAsyncResult *res, gpointer data);
+static void filter_job_done(void);
+
+/* Process wide cache of the user scripts and style sheets. The objects are
+ * immutable and can be shared between all the user content managers, so
+ * opening a new tab does not need to read files or copy script sources. */
+static struct {
+    WebKitUserScript     *focus_tracking;
+    WebKitUserScript     *global_scripts;
+    WebKitUserStyleSheet *hints_style;
+    CachedFile           script;
+    CachedFile           style;
+    /* Content filters compiled from the json files in the filters dir. */
+    WebKitUserContentFilterStore *filter_store;
+    char                 *filter_dir;
+    GHashTable           *filters;          /* maps identifier to Filter */
+    guint                filter_jobs;       /* number of running compilations */
+    guint                filter_errors;     /* failed compilations of last update */
+} uc;
+
+/**
+ * Free all the cached user content.
+ */
+void user_content_cleanup(void)
+{
+    g_clear_pointer(&uc.focus_tracking, webkit_user_script_unref);
+    g_clear_pointer(&uc.global_scripts, webkit_user_script_unref);
+    g_clear_pointer(&uc.hints_style, webkit_user_style_sheet_unref);
+
+    cached_file_clear(&uc.script);
+    g_clear_pointer(&uc.script.content, webkit_user_script_unref);
+    g_clear_object(&uc.script.monitor);
+    cached_file_clear(&uc.style);
+    g_clear_pointer(&uc.style.content, webkit_user_style_sheet_unref);
+    g_clear_object(&uc.style.monitor);
+
+    g_clear_pointer(&uc.filters, g_hash_table_destroy);
+    g_clear_object(&uc.filter_store);
+    g_clear_pointer(&uc.filter_dir, g_free);
+}
+
+/**
+ * Replace the scripts of given user content manager by the builtin scripts
+ * and if user is TRUE the scripts from the users scripts file.
+ */
+void user_content_add_scripts(WebKitUserContentManager *ucm, gboolean user)
+{
+    WebKitUserScript *script;
+
+    webkit_user_content_manager_remove_all_scripts(ucm);
+
+    if (user && (script = get_user_script())) {
+        webkit_user_content_manager_add_script(ucm, script);
+    }
+
+    /* Inject the global scripts: hints, scroll, scroll observer, and focus tracking.
+     * Focus tracking detects when editable elements gain/lose focus to
+     * automatically switch vimb between normal and input modes.
+     *
+     * Focus tracking script should be injected at the start of a document
+     * since document may have an input or textarea with an autofocus
+     * attribute or there may be a script in the middle of a document that sets
+     * focus to some element. */
+    if (!uc.focus_tracking) {
+        uc.focus_tracking = webkit_user_script_new(
+                JS_FOCUS_TRACKING,
+                WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START, NULL, NULL);
+    }
+    webkit_user_content_manager_add_script(ucm, uc.focus_tracking);
+
+    if (!uc.global_scripts) {
+        uc.global_scripts = webkit_user_script_new(
+                JS_HINTS " " JS_SCROLL " " JS_SCROLL_OBSERVER " " JS_PERF_METRICS,
+                WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
+    }
+    webkit_user_content_manager_add_script(ucm, uc.global_scripts);
+}
+
+/**
+ * Replace the style sheets of given user content manager by the builtin
+ * styles and if user is TRUE the style sheet from the users style file.
+ */
+void user_content_add_styles(WebKitUserContentManager *ucm, gboolean user)
+{
+    WebKitUserStyleSheet *style;
+
+    webkit_user_content_manager_remove_all_style_sheets(ucm);
+
+    if (user && (style = get_user_style())) {
+        webkit_user_content_manager_add_style_sheet(ucm, style);
+    }
+
+    /* Inject the global styles with author level to allow restyling by user
+     * style sheets. */
+    if (!uc.hints_style) {
+        uc.hints_style = webkit_user_style_sheet_new(CSS_HINTS,
+                WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                WEBKIT_USER_STYLE_LEVEL_AUTHOR, NULL, NULL);
+    }
+    webkit_user_content_manager_add_style_sheet(ucm, uc.hints_style);
+}
+
+/**
+ * Prepare the content filter store in the cache dir and load all the filters
+ * that have been compiled before. The filters are loaded asynchronous and
+ * added to all the clients as soon as they are available.
+ */
+void user_content_filter_init(void)
+{
+    char *cache, *path;
+
+    uc.filters = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)filter_free);
+
+    path = util_get_config_dir();
+    uc.filter_dir = g_build_filename(path, "filters", NULL);
+    g_free(path);
+
+    cache = util_get_cache_dir();
+    path  = g_build_filename(cache, "filters", NULL);
+    uc.filter_store = webkit_user_content_filter_store_new(path);
+    g_free(path);
+    g_free(cache);
+
+    webkit_user_content_filter_store_fetch_identifiers(uc.filter_store, NULL,
+            on_filter_identifiers_fetched, NULL);
+}
+
+/**
+ * Add all the loaded content filters to given user content manager.
+ */
+void user_content_add_filters(WebKitUserContentManager *ucm)
+{
+    GHashTableIter iter;
+    Filter *f;
+
+    if (!uc.filters) {
+        return;
+    }
+
+    g_hash_table_iter_init(&iter, uc.filters);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&f)) {
+        webkit_user_content_manager_add_filter(ucm, f->filter);
+    }
+}
+
+/**
+ * Compile all the WebKit content blocker json files from the filters dir
+ * into the filter store. The identifier of a filter is the filename without
+ * the .json extension. Filters whose source file was removed are removed
+ * from the store too.
+ *
+ * Returns FALSE if the filter dir could not be read or an update is already
+ * running.
+ */
+gboolean user_content_filter_update(Client *c)
+{
+    GHashTableIter iter;
+    GPtrArray *removed;
+    GDir *dir;
+    GFile *file;
+    GStatBuf st;
+    FilterJob *job;
+    const char *filename;
+    char *id, *json, *path;
+    guint i;
+
+    if (!uc.filter_store) {
+        return FALSE;
+    }
+    if (uc.filter_jobs) {
+        vb_echo(c, MSG_ERROR, TRUE, "Filter update already running");
+        return FALSE;
+    }
+    if (!(dir = g_dir_open(uc.filter_dir, 0, NULL))) {
+        vb_echo(c, MSG_ERROR, TRUE, "Could not read filter dir %s", uc.filter_dir);
+        return FALSE;
+    }
+
+    uc.filter_errors = 0;
+    while ((filename = g_dir_read_name(dir))) {
+        if (!g_str_has_suffix(filename, ".json")) {
+            continue;
+        }
+        path = g_build_filename(uc.filter_dir, filename, NULL);
+        if (g_stat(path, &st) || !S_ISREG(st.st_mode)) {
+            g_free(path);
+            continue;
+        }
+
+        job        = g_slice_new(FilterJob);
+        job->id    = g_strndup(filename, strlen(filename) - 5);
+        job->size  = st.st_size;
+        job->start = g_get_monotonic_time();
+
+        file = g_file_new_for_path(path);
+        webkit_user_content_filter_store_save_from_file(uc.filter_store,
+                job->id, file, NULL, on_filter_saved, job);
+        uc.filter_jobs++;
+
+        g_object_unref(file);
+        g_free(path);
+    }
+    g_dir_close(dir);
+
+    /* Drop the filters that have no source file anymore. */
+    removed = g_ptr_array_new_with_free_func(g_free);
+    g_hash_table_iter_init(&iter, uc.filters);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&id, NULL)) {
+        json = g_strconcat(id, ".json", NULL);
+        path = g_build_filename(uc.filter_dir, json, NULL);
+        if (!g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+            g_ptr_array_add(removed, g_strdup(id));
+        }
+        g_free(json);
+        g_free(path);
+    }
+    for (i = 0; i < removed->len; i++) {
+        id = g_ptr_array_index(removed, i);
+        webkit_user_content_filter_store_remove(uc.filter_store, id, NULL, NULL, NULL);
+        filter_detach(id);
+    }
+    g_ptr_array_free(removed, TRUE);
+
+    if (!uc.filter_jobs) {
+        vb_echo(c, MSG_NORMAL, FALSE, "No filters found in %s", uc.filter_dir);
+    } else {
+        vb_echo(c, MSG_NORMAL, FALSE, "Compiling %u filters", uc.filter_jobs);
+    }
+
+    return TRUE;
+}
+
+/**
+ * Show some information about the loaded content filters.
+ */
+void user_content_filter_stats(Client *c)
+{
+    GHashTableIter iter;
+    GString *str;
+    Filter *f;
+    char *id;
+
+    str = g_string_new("-- Filters --");
+    if (uc.filters) {
+        g_hash_table_iter_init(&iter, uc.filters);
+        while (g_hash_table_iter_next(&iter, (gpointer*)&id, (gpointer*)&f)) {
+            g_string_append_printf(str, "\n%s", id);
+            if (f->size) {
+                g_string_append_printf(str, "  %" G_GOFFSET_FORMAT "KiB", f->size / 1024);
+            }
+            if (f->compile_time) {
+                g_string_append_printf(str, "  compiled in %" G_GINT64_FORMAT "ms",
+                        f->compile_time / 1000);
+            }
+        }
+    }
+    if (uc.filter_jobs) {
+        g_string_append_printf(str, "\n%u filters compiling", uc.filter_jobs);
+    }
+
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", str->str);
+    g_string_free(str, TRUE);
+}
+
+/**
+ * Start to watch the file on given path so that the cached content is
+ * dropped when the file is changed, created or removed.
+ */
+static void cached_file_watch(CachedFile *cf, const char *path)
+{
+    GFile *file;
+
+    if (cf->monitor) {
+        return;
+    }
+
+    file        = g_file_new_for_path(path);
+    cf->monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+    if (cf->monitor) {
+        g_signal_connect(cf->monitor, "changed", G_CALLBACK(on_file_changed), cf);
+    }
+    g_object_unref(file);
+}
+
+/**
+ * Mark the cached file to be reread on next use.
+ */
+static void cached_file_clear(CachedFile *cf)
+{
+    cf->loaded = FALSE;
+}
+
+static void on_file_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other_file, GFileMonitorEvent event, CachedFile *cf)
+{
+    switch (event) {
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_RENAMED:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+            cached_file_clear(cf);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Retrieves the user script from the scripts file or NULL if there is none.
+ * The file is only read if it was not read before or has changed since.
+ */
+static WebKitUserScript *get_user_script(void)
+{
+    char *source;
+
+    if (!vb.files[FILES_SCRIPT]) {
+        return NULL;
+    }
+    if (uc.script.loaded) {
+        return uc.script.content;
+    }
+
+    g_clear_pointer(&uc.script.content, webkit_user_script_unref);
+    if (g_file_get_contents(vb.files[FILES_SCRIPT], &source, NULL, NULL)) {
+        uc.script.content = webkit_user_script_new(
+                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
+        g_free(source);
+    }
+
+    cached_file_watch(&uc.script, vb.files[FILES_SCRIPT]);
+    /* Without monitor the file is read each time like before. */
+    uc.script.loaded = uc.script.monitor != NULL;
+
+    return uc.script.content;
+}
+
+/**
+ * Retrieves the user style sheet from the style file or NULL if there is
+ * none. The file is only read if it was not read before or has changed
+ * since.
+ */
+static WebKitUserStyleSheet *get_user_style(void)
+{
+    char *source;
+
+    if (!vb.files[FILES_USER_STYLE]) {
+        return NULL;
+    }
+    if (uc.style.loaded) {
+        return uc.style.content;
+    }
+
+    g_clear_pointer(&uc.style.content, webkit_user_style_sheet_unref);
+    if (g_file_get_contents(vb.files[FILES_USER_STYLE], &source, NULL, NULL)) {
+        uc.style.content = webkit_user_style_sheet_new(
+                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                WEBKIT_USER_STYLE_LEVEL_USER, NULL, NULL);
+        g_free(source);
+    } else {
+        g_message("Could not read style file: %s", vb.files[FILES_USER_STYLE]);
+    }
+
+    cached_file_watch(&uc.style, vb.files[FILES_USER_STYLE]);
+    uc.style.loaded = uc.style.monitor != NULL;
+
+    return uc.style.content;
+}
+
+/**
+ * Add the filter to the filter table and to all the existing clients.
+ */
+static void filter_attach(const char *id, WebKitUserContentFilter *filter,
+        goffset size, gint64 compile_time)
+{
+    WebKitUserContentManager *ucm;
+    Filter *f;
+    Client *c;
+
+    f               = g_slice_new(Filter);
+    f->filter       = filter;
+    f->size         = size;
+    f->compile_time = compile_time;
+
+    /* Remove an older version of the same filter first. */
+    filter_detach(id);
+    g_hash_table_insert(uc.filters, g_strdup(id), f);
+
+    for (c = vb.clients; c; c = c->next) {
+        if ((ucm = vb_get_user_content_manager(c))) {
+            webkit_user_content_manager_add_filter(ucm, filter);
+        }
+    }
+}
+
+/**
+ * Remove the filter of given identifier from the filter table and from all
+ * the clients.
+ */
+static void filter_detach(const char *id)
+{
+    WebKitUserContentManager *ucm;
+    Client *c;
+
+    if (!g_hash_table_remove(uc.filters, id)) {
+        return;
+    }
+    for (c = vb.clients; c; c = c->next) {
+        if ((ucm = vb_get_user_content_manager(c))) {
+            webkit_user_content_manager_remove_filter_by_id(ucm, id);
+        }
+    }
+}
+
+static void filter_free(Filter *f)
+{
+    webkit_user_content_filter_unref(f->filter);
+    g_slice_free(Filter, f);
+}
+
+static void on_filter_identifiers_fetched(GObject *source, GAsyncResult *res, gpointer data)
+{
+    char **ids;
+    int i;
+
+    ids = webkit_user_content_filter_store_fetch_identifiers_finish(
+            WEBKIT_USER_CONTENT_FILTER_STORE(source), res);
+    if (!ids) {
+        return;
+    }
+    for (i = 0; ids[i]; i++) {
+        webkit_user_content_filter_store_load(WEBKIT_USER_CONTENT_FILTER_STORE(source),
+                ids[i], NULL, on_filter_loaded, NULL);
+    }
+    g_strfreev(ids);
+}
+
+static void on_filter_loaded(GObject *source, GAsyncResult *res, gpointer data)
+{
+    WebKitUserContentFilter *filter;
+    GError *error = NULL;
+
+    filter = webkit_user_content_filter_store_load_finish(
+            WEBKIT_USER_CONTENT_FILTER_STORE(source), res, &error);
+    if (!filter) {
+        g_warning("Could not load content filter: %s", error->message);
+        g_error_free(error);
+        return;
+    }
+    /* The store is gone if vimb was quit in the meantime. */
+    if (!uc.filters) {
+        webkit_user_content_filter_unref(filter);
+        return;
+    }
+    filter_attach(webkit_user_content_filter_get_identifier(filter), filter, 0, 0);
+}
+
+static void on_filter_saved(GObject *source, GAsyncResult *res, gpointer data)
+{
+    WebKitUserContentFilter *filter;
+    GError *error = NULL;
+    FilterJob *job = (FilterJob*)data;
+    Client *c;
+
+    filter = webkit_user_content_filter_store_save_finish(
+            WEBKIT_USER_CONTENT_FILTER_STORE(source), res, &error);
+    if (!filter) {
+        uc.filter_errors++;
+        if ((c = vb_get_current_client())) {
+            vb_echo(c, MSG_ERROR, FALSE, "Could not compile filter %s: %s",
+                    job->id, error->message);
+        }
+        g_error_free(error);
+    } else if (uc.filters) {
+        filter_attach(job->id, filter, job->size, g_get_monotonic_time() - job->start);
+    } else {
+        webkit_user_content_filter_unref(filter);
+    }
+
+    g_free(job->id);
+    g_slice_free(FilterJob, job);
+    filter_job_done();
+}
+
+/**
+ * Called for each finished filter compilation to report the end of the
+ * update.
+ */
+static void filter_job_done(void)
+{
+    Client *c;
+
+    if (--uc.filter_jobs || !(c = vb_get_current_client())) {
+        return;
+    }
+    if (uc.filter_errors) {
+        vb_echo(c, MSG_ERROR, FALSE, "Filter update done with %u errors", uc.filter_errors);
+    } else {
+        vb_echo(c, MSG_NORMAL, FALSE, "Filter update done, %u filters loaded",
+                g_hash_table_size(uc.filters));
+    }
+}
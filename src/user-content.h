@@ -0,0 +1,35 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _USER_CONTENT_H
+#define _USER_CONTENT_H
+
+#include <webkit/webkit.h>
+
+#include "main.h"
+
+void user_content_cleanup(void);
+void user_content_add_scripts(WebKitUserContentManager *ucm, gboolean user);
+void user_content_add_styles(WebKitUserContentManager *ucm, gboolean user);
+void user_content_filter_init(void);
+void user_content_add_filters(WebKitUserContentManager *ucm);
+gboolean user_content_filter_update(Client *c);
+void user_content_filter_stats(Client *c);
+
+#endif /* end of include guard: _USER_CONTENT_H */
@@ -578,59 +578,6 @@ gboolean util_fill_completion(GListStore *store, const char *input, GList *src)
     return found;
 }
 
-/**
- * Fills file path completion entries into given list store for also given
- * input.
- */
-gboolean util_filename_fill_completion(GListStore *store, const char *input)
-{
-    gboolean found = FALSE;
-    GError *error  = NULL;
-    char *input_dirname, *real_dirname;
-    const char *last_slash, *input_basename;
-    GDir *dir;
-
-    last_slash     = strrchr(input, '/');
-    input_basename = last_slash ? last_slash + 1 : input;
-    input_dirname  = g_strndup(input, input_basename - input);
-    real_dirname   = util_expand(
-        *input_dirname ? input_dirname : ".",
-        UTIL_EXP_TILDE|UTIL_EXP_DOLLAR
-    );
-
-    dir = g_dir_open(real_dirname, 0, &error);
-    if (error) {
-        /* Can't open directory, likely bad user input */
-        g_error_free(error);
-    } else {
-        const char *filename;
-        char *fullpath, *result;
-
-        while ((filename = g_dir_read_name(dir))) {
-            if (g_str_has_prefix(filename, input_basename)) {
-                fullpath = g_build_filename(real_dirname, filename, NULL);
-                if (g_file_test(fullpath, G_FILE_TEST_IS_DIR)) {
-                    result = g_strconcat(input_dirname, filename, "/", NULL);
-                } else {
-                    result = g_strconcat(input_dirname, filename, NULL);
-                }
-                g_free(fullpath);
-                CompletionItem *item = completion_item_new(result, NULL);
-                g_list_store_append(store, item);
-                g_object_unref(item);
-                g_free(result);
-                found = TRUE;
-            }
-        }
-        g_dir_close(dir);
-    }
-
-    g_free(input_dirname);
-    g_free(real_dirname);
-
-    return found;
-}
-
 /**
  * Returns the script result as string.
  * Returned string must be freed by g_free.
@@ -645,44 +592,36 @@ double util_js_result_as_number(JSCValue *value)
     return jsc_value_to_double(value);
 }
 
-/* Helper structure for synchronous clipboard reading */
-typedef struct {
-    GMainLoop *loop;
-    char *result;
-    GdkClipboard *clipboard;
-} ClipboardData;
-
-static void clipboard_text_received(GObject *source, GAsyncResult *result, gpointer user_data)
-{
-    ClipboardData *data = (ClipboardData *)user_data;
-    data->result = gdk_clipboard_read_text_finish(GDK_CLIPBOARD(source), result, NULL);
-    g_main_loop_quit(data->loop);
-}
-
 /**
- * GTK4 clipboard helper - get text from clipboard (synchronous wrapper).
- * Returns string that must be freed with g_free, or NULL.
+ * Appends the value as quoted JSON string to str. Invalid utf8 sequences
+ * are replaced, so the result is always valid JSON.
  */
-char *util_clipboard_get_text(GtkWidget *widget, gboolean primary)
+void util_json_append_string(GString *str, const char *value)
 {
-    GdkDisplay *display;
-    ClipboardData data;
+    char *valid = NULL;
 
-    display = gtk_widget_get_display(widget);
-    data.clipboard = primary ? gdk_display_get_primary_clipboard(display)
-                             : gdk_display_get_clipboard(display);
-    data.result = NULL;
-    data.loop = g_main_loop_new(NULL, FALSE);
-
-    /* Read text asynchronously */
-    gdk_clipboard_read_text_async(data.clipboard, NULL,
-        clipboard_text_received, &data);
-
-    /* Wait for the async operation to complete */
-    g_main_loop_run(data.loop);
-    g_main_loop_unref(data.loop);
+    if (!g_utf8_validate(value, -1, NULL)) {
+        value = valid = g_utf8_make_valid(value, -1);
+    }
 
-    return data.result;
+    g_string_append_c(str, '"');
+    for (const char *p = value; *p; p++) {
+        switch (*p) {
+            case '"':  g_string_append(str, "\\\""); break;
+            case '\\': g_string_append(str, "\\\\"); break;
+            case '\n': g_string_append(str, "\\n"); break;
+            case '\r': g_string_append(str, "\\r"); break;
+            case '\t': g_string_append(str, "\\t"); break;
+            default:
+                if ((guchar)*p < 0x20) {
+                    g_string_append_printf(str, "\\u%04x", (guchar)*p);
+                } else {
+                    g_string_append_c(str, *p);
+                }
+        }
+    }
+    g_string_append_c(str, '"');
+    g_free(valid);
 }
 
 /**
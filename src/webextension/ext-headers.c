@@ -0,0 +1,222 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Header rules of the pages. The rules are compiled by the UI process and
+ * grouped by host, so each request only needs a lookup of the actions for
+ * its host, which are cached per page.
+ */
+#include <glib.h>
+#include <string.h>
+
+#include "ext-headers.h"
+
+/* number of hosts the resolved actions are cached for */
+#define CACHE_SIZE 64
+
+struct HeaderRules {
+    GPtrArray           *global;        /* actions for all hosts */
+    GHashTable          *rules;         /* maps host -> actions for this host and its subdomains */
+    GHashTable          *cache;         /* maps host -> resolved actions to apply */
+};
+
+static GPtrArray *header_actions_resolve(HeaderRules *hr, const char *host);
+static void header_action_free(gpointer data);
+static void ptr_array_unref0(gpointer data);
+
+
+/**
+ * Creates the header rules compiled by the UI process. Returns NULL if there
+ * are no rules.
+ */
+HeaderRules *ext_headers_new(GVariant *rules)
+{
+    GVariantIter iter, *items;
+    HeaderRules *hr;
+    GPtrArray *actions;
+    HeaderAction *action;
+    const char *host, *name, *value;
+
+    if (!g_variant_n_children(rules)) {
+        return NULL;
+    }
+
+    hr = g_slice_new0(HeaderRules);
+
+    g_variant_iter_init(&iter, rules);
+    while (g_variant_iter_next(&iter, "{&sa(sms)}", &host, &items)) {
+        actions = g_ptr_array_new_with_free_func(header_action_free);
+        while (g_variant_iter_next(items, "(&sm&s)", &name, &value)) {
+            action        = g_slice_new(HeaderAction);
+            action->name  = g_strdup(name);
+            action->value = g_strdup(value);
+            g_ptr_array_add(actions, action);
+        }
+        g_variant_iter_free(items);
+
+        if (!*host) {
+            hr->global = actions;
+        } else {
+            if (!hr->rules) {
+                hr->rules = g_hash_table_new_full(g_str_hash, g_str_equal,
+                        g_free, ptr_array_unref0);
+                hr->cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                        g_free, ptr_array_unref0);
+            }
+            g_hash_table_insert(hr->rules, g_strdup(host), actions);
+        }
+    }
+
+    return hr;
+}
+
+void ext_headers_free(HeaderRules *hr)
+{
+    /* The cache holds the actions of the rules, so free it first. */
+    if (hr->cache) {
+        g_hash_table_unref(hr->cache);
+    }
+    if (hr->rules) {
+        g_hash_table_unref(hr->rules);
+    }
+    if (hr->global) {
+        g_ptr_array_unref(hr->global);
+    }
+    g_slice_free(HeaderRules, hr);
+}
+
+/**
+ * Retrieves the list of header actions to apply to a request for given uri
+ * or NULL if there is nothing to do.
+ */
+GPtrArray *ext_headers_lookup(HeaderRules *hr, const char *uri)
+{
+    const char *start, *end, *p;
+    char host[256];
+    GPtrArray *actions;
+    gsize len, i;
+
+    if (!hr->rules) {
+        return hr->global;
+    }
+
+    /* Extract the lowercased host into a buffer on the stack, this is done
+     * for every request, so don't allocate memory here. */
+    if (!uri || !(start = strstr(uri, "://"))) {
+        return hr->global;
+    }
+    start += 3;
+    end    = start + strcspn(start, "/?#");
+    for (p = start; p < end; p++) {
+        if (*p == '@') {
+            start = p + 1;
+        }
+    }
+    if (*start != '[' && (p = memchr(start, ':', end - start))) {
+        end = p;
+    }
+    len = end - start;
+    if (!len || len >= sizeof(host)) {
+        return hr->global;
+    }
+    for (i = 0; i < len; i++) {
+        host[i] = g_ascii_tolower(start[i]);
+    }
+    host[len] = '\0';
+
+    if (!g_hash_table_lookup_extended(hr->cache, host, NULL, (gpointer*)&actions)) {
+        /* A page may request resources from many hosts over its lifetime,
+         * so start over instead of growing the cache without limit. */
+        if (g_hash_table_size(hr->cache) >= CACHE_SIZE) {
+            g_hash_table_remove_all(hr->cache);
+        }
+        actions = header_actions_resolve(hr, host);
+        g_hash_table_insert(hr->cache, g_strdup(host), actions);
+    }
+
+    return actions;
+}
+
+/**
+ * Merge the actions for all hosts and those for given host and its parent
+ * domains into a single list. The actions of more specific hosts overrule
+ * those for the same header of less specific ones.
+ *
+ * Returned list must be freed by g_ptr_array_unref().
+ */
+static GPtrArray *header_actions_resolve(HeaderRules *hr, const char *host)
+{
+    GPtrArray *result, *actions;
+    GSList *matches = NULL, *l;
+    HeaderAction *action;
+    const char *p;
+    guint i, j;
+
+    /* collect the lists from the least to the most specific host */
+    p = host;
+    while (p) {
+        if ((actions = g_hash_table_lookup(hr->rules, p))) {
+            matches = g_slist_prepend(matches, actions);
+        }
+        if ((p = strchr(p, '.'))) {
+            p++;
+        }
+    }
+    if (!matches) {
+        return hr->global ? g_ptr_array_ref(hr->global) : NULL;
+    }
+    if (hr->global) {
+        matches = g_slist_prepend(matches, hr->global);
+    }
+
+    /* The actions are owned by the rules, which outlive the cache. */
+    result = g_ptr_array_new();
+    for (l = matches; l; l = l->next) {
+        actions = l->data;
+        for (i = 0; i < actions->len; i++) {
+            action = g_ptr_array_index(actions, i);
+            for (j = 0; j < result->len; j++) {
+                if (!g_ascii_strcasecmp(((HeaderAction*)g_ptr_array_index(result, j))->name, action->name)) {
+                    g_ptr_array_remove_index(result, j);
+                    break;
+                }
+            }
+            g_ptr_array_add(result, action);
+        }
+    }
+    g_slist_free(matches);
+
+    return result;
+}
+
+static void header_action_free(gpointer data)
+{
+    HeaderAction *action = (HeaderAction*)data;
+
+    g_free(action->name);
+    g_free(action->value);
+    g_slice_free(HeaderAction, action);
+}
+
+static void ptr_array_unref0(gpointer data)
+{
+    if (data) {
+        g_ptr_array_unref(data);
+    }
+}
@@ -21,8 +21,10 @@
 #include <gio/gio.h>
 #include <glib.h>
 #include <libsoup/soup.h>
+#include <string.h>
 #include <webkit/webkit-web-process-extension.h>
 
+#include "ext-headers.h"
 #include "ext-main.h"
 #include "ext-util.h"
 #include "js-snippets.h"
@@ -35,10 +37,12 @@ static gboolean on_web_page_send_request(WebKitWebPage *webpage, WebKitURIReques
         WebKitURIResponse *response, gpointer extension);
 static void on_window_object_cleared(WebKitScriptWorld *world, WebKitWebPage *page,
         WebKitFrame *frame, gpointer user_data);
+static void on_web_page_destroyed(gpointer data, GObject *webpage);
+static void header_rules_set(guint64 page_id, GVariant *rules);
 
 /* Global struct to hold internal used variables. */
 struct Ext {
-    GHashTable          *headers;
+    GHashTable          *page_headers;  /* Maps page_id -> HeaderRules */
     GHashTable          *page_frames;  /* Maps page_id -> main WebKitFrame */
 };
 struct Ext ext = {0};
@@ -50,12 +54,28 @@ struct Ext ext = {0};
  * to webkit_web_process_extension_initialize_with_user_data
  */
 G_MODULE_EXPORT
-void webkit_web_process_extension_initialize_with_user_data(WebKitWebProcessExtension *extension, G_GNUC_UNUSED GVariant *data)
+void webkit_web_process_extension_initialize_with_user_data(WebKitWebProcessExtension *extension, GVariant *data)
 {
     WebKitScriptWorld *world;
+    GVariantIter *iter;
+    GVariant *rules;
+    guint64 page_id;
 
     /* Initialize the page frames hash table */
-    ext.page_frames = g_hash_table_new(g_direct_hash, g_direct_equal);
+    ext.page_frames  = g_hash_table_new(g_direct_hash, g_direct_equal);
+    ext.page_headers = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)ext_headers_free);
+
+    /* The initialization data holds the current header rules of all tabs,
+     * because messages can't reach a page before its process runs. */
+    if (data && g_variant_is_of_type(data, G_VARIANT_TYPE("(" VB_PAGE_HEADER_RULES_TYPE ")"))) {
+        g_variant_get(data, "(" VB_PAGE_HEADER_RULES_TYPE ")", &iter);
+        while (g_variant_iter_next(iter, "{t@" VB_HEADER_RULES_TYPE "}", &page_id, &rules)) {
+            header_rules_set(page_id, rules);
+            g_variant_unref(rules);
+        }
+        g_variant_iter_free(iter);
+    }
 
     /* Connect to page-created signal to handle new pages */
     g_signal_connect(extension, "page-created", G_CALLBACK(on_page_created), NULL);
@@ -113,6 +133,17 @@ static void on_page_created(WebKitWebProcessExtension *extension, WebKitWebPage
             "signal::document-loaded", G_CALLBACK(on_web_page_document_loaded), extension,
             "signal::user-message-received", G_CALLBACK(on_web_page_user_message_received), extension,
             NULL);
+    g_object_weak_ref(G_OBJECT(webpage), on_web_page_destroyed,
+            GUINT_TO_POINTER(webkit_web_page_get_id(webpage)));
+}
+
+/**
+ * Forget the data kept for a web page once it is gone.
+ */
+static void on_web_page_destroyed(gpointer data, GObject *webpage)
+{
+    g_hash_table_remove(ext.page_frames, data);
+    g_hash_table_remove(ext.page_headers, data);
 }
 
 /**
@@ -211,6 +242,16 @@ static gboolean on_web_page_user_message_received(WebKitWebPage *web_page,
         return TRUE;
     }
 
+    /* SetHeaderSetting - Replace the header rules */
+    if (g_strcmp0(name, "SetHeaderSetting") == 0) {
+        GVariant *rules;
+
+        g_variant_get(parameters, "(@" VB_HEADER_RULES_TYPE ")", &rules);
+        header_rules_set(webkit_web_page_get_id(web_page), rules);
+        g_variant_unref(rules);
+        return TRUE;
+    }
+
     /* LockInput - Lock an input element */
     if (g_strcmp0(name, "LockInput") == 0) {
         const char *element_id;
@@ -266,11 +307,19 @@ static gboolean on_web_page_user_message_received(WebKitWebPage *web_page,
 static gboolean on_web_page_send_request(WebKitWebPage *webpage, WebKitURIRequest *request,
         WebKitURIResponse *response, gpointer extension)
 {
-    char *name, *value;
     SoupMessageHeaders *headers;
-    GHashTableIter iter;
+    HeaderRules *hr;
+    GPtrArray *actions;
+    HeaderAction *action;
+    guint i;
 
-    if (!ext.headers) {
+    hr = g_hash_table_lookup(ext.page_headers, GUINT_TO_POINTER(webkit_web_page_get_id(webpage)));
+    if (!hr) {
+        return FALSE;
+    }
+
+    actions = ext_headers_lookup(hr, webkit_uri_request_get_uri(request));
+    if (!actions) {
         return FALSE;
     }
 
@@ -280,16 +329,28 @@ static gboolean on_web_page_send_request(WebKitWebPage *webpage, WebKitURIReques
         return FALSE;
     }
 
-    g_hash_table_iter_init(&iter, ext.headers);
-    while (g_hash_table_iter_next(&iter, (gpointer*)&name, (gpointer*)&value)) {
-        /* Null value is used to indicate that the header should be
-         * removed completely. */
-        if (value == NULL) {
-            soup_message_headers_remove(headers, name);
+    for (i = 0; i < actions->len; i++) {
+        action = g_ptr_array_index(actions, i);
+        if (action->value) {
+            soup_message_headers_replace(headers, action->name, action->value);
         } else {
-            soup_message_headers_replace(headers, name, value);
+            soup_message_headers_remove(headers, action->name);
         }
     }
 
     return FALSE;
 }
+
+/**
+ * Replace the header rules of the page by those compiled by the UI process.
+ */
+static void header_rules_set(guint64 page_id, GVariant *rules)
+{
+    HeaderRules *hr;
+
+    if ((hr = ext_headers_new(rules))) {
+        g_hash_table_insert(ext.page_headers, GUINT_TO_POINTER(page_id), hr);
+    } else {
+        g_hash_table_remove(ext.page_headers, GUINT_TO_POINTER(page_id));
+    }
+}
@@ -24,4 +24,13 @@
 #define VB_WEBEXTENSION_OBJECT_PATH  "/org/vimb/browser/WebExtension"
 #define VB_WEBEXTENSION_INTERFACE    "org.vimb.browser.WebExtension"
 
+/* GVariant type of the header rules sent by the SetHeaderSetting message.
+ * The rules map the host, or the empty string for all hosts, to the list of
+ * header names and values. A header without value is removed from the
+ * request. */
+#define VB_HEADER_RULES_TYPE "a{sa(sms)}"
+/* The initialization data of the webextension maps the page id of each tab
+ * to its header rules. */
+#define VB_PAGE_HEADER_RULES_TYPE "a{t" VB_HEADER_RULES_TYPE "}"
+
 #endif /* end of include guard: _EXT_MAIN_H */
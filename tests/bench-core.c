@@ -0,0 +1,513 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2026 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Micro benchmarks of the core data paths. Each benchmark is run on
+ * synthetic datasets of the sizes given by --sizes and the results are
+ * written as JSON to stdout, one result per line. If a baseline written by a
+ * previous run is given by --baseline, the results are compared against it
+ * and the program fails if a benchmark got slower than --threshold percent.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/main.h>
+#include <src/bookmark.h>
+#include <src/completion.h>
+#include <src/ex.h>
+#include <src/file-storage.h>
+#include <src/handler.h>
+#include <src/history.h>
+#include <src/map.h>
+#include <src/shortcut.h>
+#include <src/util.h>
+
+/* provide the Vimb struct used by the tested modules */
+struct Vimb vb;
+
+#define BENCH_RUNS      3       /* the fastest of the runs is reported */
+#define BENCH_MAPPINGS  500     /* number of mappings and of distinct keys in the config */
+
+typedef struct {
+    const char  *name;
+    gpointer    (*setup)(guint n);
+    guint       (*run)(gpointer data, guint n);     /* returns the number of operations */
+    void        (*teardown)(gpointer data);
+} Bench;
+
+typedef struct {
+    char    name[64];
+    guint   size;
+    gdouble ns_per_op;
+} Result;
+
+static char *tmpdir;
+static FILE *out;
+/* keeps the compiler from dropping the benchmarked calls */
+static volatile guint sink;
+
+/* ------------------------------------------------------------------------ */
+
+static char **lines_new(guint n, const char *fmt)
+{
+    char **lines = g_new(char*, n + 1);
+
+    for (guint i = 0; i < n; i++) {
+        /* every tenth entry is a duplicate of an earlier one */
+        guint id = i % 10 == 9 ? i / 2 : i;
+        lines[i] = g_strdup_printf(fmt, id % 997, id, id % 13, id % 7);
+    }
+    lines[n] = NULL;
+
+    return lines;
+}
+
+static void lines_free(gpointer data)
+{
+    g_strfreev(data);
+}
+
+static gpointer setup_uris(guint n)
+{
+    return lines_new(n, "https://host%u.example.com/path/%u/page-%u.html?q=%u");
+}
+
+static guint run_wildmatch(gpointer data, guint n)
+{
+    char **uris = data;
+    guint found = 0;
+
+    for (guint i = 0; i < n; i++) {
+        found += util_wildmatch("*://host?.example.com/{path,other}/*", uris[i]);
+    }
+    sink += found;
+    return n;
+}
+
+static gpointer setup_titles(guint n)
+{
+    return lines_new(n, "Title %u of the article number %u about topic %u and %u");
+}
+
+static guint run_strcasestr(gpointer data, guint n)
+{
+    char **titles = data;
+    guint found = 0;
+
+    for (guint i = 0; i < n; i++) {
+        found += util_strcasestr(titles[i], "TOPIC 1") != NULL;
+    }
+    sink += found;
+    return n;
+}
+
+static void *line_content(const char *key, const char *data)
+{
+    return g_strdup(key);
+}
+
+static gpointer setup_history_lines(guint n)
+{
+    return lines_new(n, "https://host%u.example.com/path/%u\tTitle %u of %u");
+}
+
+static guint run_unique_list(gpointer data, guint n)
+{
+    /* the lines are modified, so work on a fresh copy like the one read from
+     * a file */
+    char **lines = g_strdupv(data);
+    GList *list  = util_strv_to_unique_list(lines, line_content, 0);
+
+    g_list_free_full(list, g_free);
+    g_strfreev(lines);
+    return n;
+}
+
+static gpointer setup_history(guint n)
+{
+    char **lines = setup_history_lines(n);
+
+    vb.config.history_max       = 0;
+    vb.storage[STORAGE_HISTORY] = file_storage_new(tmpdir, "history", TRUE);
+    for (guint i = 0; i < n; i++) {
+        file_storage_append(vb.storage[STORAGE_HISTORY], "%s\n", lines[i]);
+    }
+    g_strfreev(lines);
+
+    return vb.storage[STORAGE_HISTORY];
+}
+
+static guint run_history(gpointer data, guint n)
+{
+    GListStore *store = g_list_store_new(COMPLETION_TYPE_ITEM);
+
+    history_fill_completion(store, HISTORY_URL, "host1 path");
+    g_object_unref(store);
+    return n;
+}
+
+static void teardown_history(gpointer data)
+{
+    file_storage_free(data);
+    vb.storage[STORAGE_HISTORY] = NULL;
+}
+
+static gpointer setup_bookmarks(guint n)
+{
+    char **lines = lines_new(n, "https://host%u.example.com/%u\tBookmark %u\ttag%u news");
+    char *content;
+
+    vb.files[FILES_BOOKMARK] = g_build_filename(tmpdir, "bookmark", NULL);
+    content = g_strjoinv("\n", lines);
+    g_file_set_contents(vb.files[FILES_BOOKMARK], content, -1, NULL);
+    g_free(content);
+    g_strfreev(lines);
+
+    return vb.files[FILES_BOOKMARK];
+}
+
+static guint run_bookmarks(gpointer data, guint n)
+{
+    GListStore *store = g_list_store_new(COMPLETION_TYPE_ITEM);
+
+    bookmark_fill_completion(store, "tag3");
+    g_object_unref(store);
+    return n;
+}
+
+static void teardown_bookmarks(gpointer data)
+{
+    g_remove(data);
+    g_free(data);
+    vb.files[FILES_BOOKMARK] = NULL;
+}
+
+static VbResult mode_keypress(Client *c, int key)
+{
+    return RESULT_COMPLETE;
+}
+
+static Mode bench_mode = {'n', NULL, NULL, mode_keypress, NULL};
+
+static Client *client_new(void)
+{
+    Client *c = g_new0(Client, 1);
+
+    c->mode             = &bench_mode;
+    c->handler          = handler_new();
+    c->config.shortcuts = shortcut_new();
+    map_init(c);
+
+    return c;
+}
+
+static void client_free(gpointer data)
+{
+    Client *c = data;
+
+    map_cleanup(c);
+    handler_free(c->handler);
+    shortcut_free(c->config.shortcuts);
+    g_free(c);
+}
+
+/* Returns a three char key sequence for the number. */
+static void key_for(guint i, char key[4])
+{
+    key[0] = 'a' + (i / 26 / 26) % 26;
+    key[1] = 'a' + (i / 26) % 26;
+    key[2] = 'a' + i % 26;
+    key[3] = '\0';
+}
+
+static gpointer setup_map(guint n)
+{
+    Client *c = client_new();
+    char key[4];
+
+    for (guint i = 0; i < BENCH_MAPPINGS; i++) {
+        key_for(i * 7, key);
+        map_insert(c, key, "j", 'n', FALSE);
+    }
+    return c;
+}
+
+static guint run_map(gpointer data, guint n)
+{
+    Client *c = data;
+    char key[4];
+
+    /* type the mapped key sequences char by char */
+    for (guint i = 0; i < n; i++) {
+        key_for((i / 3) % BENCH_MAPPINGS * 7, key);
+        map_handle_keys(c, (guchar*)&key[i % 3], 1, TRUE);
+    }
+    return n;
+}
+
+static gpointer setup_shortcuts(guint n)
+{
+    Shortcut *sc = shortcut_new();
+    char *key, *uri;
+
+    for (guint i = 0; i < n; i++) {
+        key = g_strdup_printf("s%u", i);
+        uri = g_strdup_printf("https://search%u.example.com/?q=$0&p=$1", i);
+        shortcut_add(sc, key, uri);
+        g_free(key);
+        g_free(uri);
+    }
+    shortcut_set_default(sc, "s0");
+
+    return sc;
+}
+
+static guint run_shortcuts(gpointer data, guint n)
+{
+    char query[64];
+
+    for (guint i = 0; i < n; i++) {
+        snprintf(query, sizeof(query), "s%u some 'search term' %u", (i * 31) % n, i);
+        g_free(shortcut_get_uri(data, query));
+    }
+    return n;
+}
+
+static void teardown_shortcuts(gpointer data)
+{
+    shortcut_free(data);
+}
+
+typedef struct {
+    Client  *c;
+    char    **lines;
+} Config;
+
+static gpointer setup_config(guint n)
+{
+    Config *cfg = g_new(Config, 1);
+    char key[4];
+
+    cfg->c     = client_new();
+    cfg->lines = g_new(char*, n + 1);
+    for (guint i = 0; i < n; i++) {
+        key_for(i % BENCH_MAPPINGS, key);
+        switch (i % 3) {
+            case 0:
+                cfg->lines[i] = g_strdup_printf("nmap %s :open %u<CR>", key, i);
+                break;
+            case 1:
+                cfg->lines[i] = g_strdup_printf("nnoremap <C-%c>%s %uG", 'a' + i % 26, key, i);
+                break;
+            default:
+                cfg->lines[i] = g_strdup_printf("shortcut-add %s=https://%u.example.com/?q=$0", key, i);
+                break;
+        }
+    }
+    cfg->lines[n] = NULL;
+
+    return cfg;
+}
+
+static guint run_config(gpointer data, guint n)
+{
+    Config *cfg = data;
+
+    for (guint i = 0; i < n; i++) {
+        ex_run_string(cfg->c, cfg->lines[i], FALSE);
+    }
+    return n;
+}
+
+static void teardown_config(gpointer data)
+{
+    Config *cfg = data;
+
+    client_free(cfg->c);
+    g_strfreev(cfg->lines);
+    g_free(cfg);
+}
+
+static Bench benches[] = {
+    {"util_wildmatch",           setup_uris,          run_wildmatch,   lines_free},
+    {"util_strcasestr",          setup_titles,        run_strcasestr,  lines_free},
+    {"util_strv_to_unique_list", setup_history_lines, run_unique_list, lines_free},
+    {"history_fill_completion",  setup_history,       run_history,     teardown_history},
+    {"bookmark_fill_completion", setup_bookmarks,     run_bookmarks,   teardown_bookmarks},
+    {"map_handle_keys",          setup_map,           run_map,         client_free},
+    {"shortcut_get_uri",         setup_shortcuts,     run_shortcuts,   teardown_shortcuts},
+    {"ex_run_string",            setup_config,        run_config,      teardown_config},
+};
+
+/* ------------------------------------------------------------------------ */
+
+/**
+ * Reads the results of a previous run. Only the format written by
+ * print_result() is understood.
+ */
+static GArray *baseline_load(const char *file)
+{
+    GArray *results;
+    char **lines;
+    Result r;
+
+    if (!(lines = util_get_lines(file))) {
+        return NULL;
+    }
+    results = g_array_new(FALSE, FALSE, sizeof(Result));
+    for (char **l = lines; *l; l++) {
+        if (sscanf(*l, "{\"name\":\"%63[^\"]\",\"size\":%u,\"ns_per_op\":%lf",
+                    r.name, &r.size, &r.ns_per_op) == 3) {
+            g_array_append_val(results, r);
+        }
+    }
+    g_strfreev(lines);
+
+    return results;
+}
+
+static const Result *baseline_find(GArray *baseline, const Result *r)
+{
+    for (guint i = 0; baseline && i < baseline->len; i++) {
+        const Result *b = &g_array_index(baseline, Result, i);
+        if (b->size == r->size && !strcmp(b->name, r->name)) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static void print_result(const Result *r, const Result *base)
+{
+    fprintf(out, "{\"name\":\"%s\",\"size\":%u,\"ns_per_op\":%.2f", r->name, r->size, r->ns_per_op);
+    if (base) {
+        fprintf(out, ",\"baseline_ns_per_op\":%.2f,\"change_percent\":%.2f",
+                base->ns_per_op, (r->ns_per_op / base->ns_per_op - 1.0) * 100);
+    }
+    fprintf(out, "}");
+    fflush(out);
+}
+
+static void ignore_log(const char *domain, GLogLevelFlags level,
+        const char *message, gpointer data)
+{
+}
+
+int main(int argc, char *argv[])
+{
+    char *sizes = "10000,100000,1000000", *baseline_file = NULL, *output = NULL, *only = NULL;
+    double threshold = 10.0;
+    GError *error = NULL;
+    GOptionContext *ctx;
+    GArray *baseline = NULL;
+    char **size_list;
+    guint nsizes, regressions = 0;
+    gboolean first = TRUE;
+    GOptionEntry opts[] = {
+        {"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes, "Comma separated dataset sizes", "LIST"},
+        {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline_file, "Compare against results of a previous run", "FILE"},
+        {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results to file instead of stdout", "FILE"},
+        {"threshold", 't', 0, G_OPTION_ARG_DOUBLE, &threshold, "Allowed slowdown in percent against the baseline", "PERCENT"},
+        {"filter", 'f', 0, G_OPTION_ARG_STRING, &only, "Run only benchmarks containing this string", "NAME"},
+        {NULL}
+    };
+
+    ctx = g_option_context_new(NULL);
+    g_option_context_add_main_entries(ctx, opts, NULL);
+    if (!g_option_context_parse(ctx, &argc, &argv, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(ctx);
+
+    if (baseline_file && !(baseline = baseline_load(baseline_file))) {
+        fprintf(stderr, "Could not read baseline %s\n", baseline_file);
+        return EXIT_FAILURE;
+    }
+
+    out = stdout;
+    if (output && !(out = fopen(output, "w"))) {
+        fprintf(stderr, "Could not write %s\n", output);
+        return EXIT_FAILURE;
+    }
+
+    /* There are no statusbar widgets the map code could write to. */
+    g_log_set_handler("Gtk", G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING, ignore_log, NULL);
+
+    tmpdir    = g_dir_make_tmp("vimb-bench-XXXXXX", NULL);
+    size_list = g_strsplit(sizes, ",", -1);
+    nsizes    = g_strv_length(size_list);
+
+    fprintf(out, "{\"runs\":%d,\"results\":[\n", BENCH_RUNS);
+    for (guint b = 0; b < G_N_ELEMENTS(benches); b++) {
+        if (only && !strstr(benches[b].name, only)) {
+            continue;
+        }
+        for (guint s = 0; s < nsizes; s++) {
+            Result r;
+            const Result *base;
+            gpointer data;
+            gint64 start, best = G_MAXINT64;
+            guint n = (guint)g_ascii_strtoull(size_list[s], NULL, 10), ops = 0;
+
+            if (!n) {
+                continue;
+            }
+
+            data = benches[b].setup(n);
+            for (int i = 0; i < BENCH_RUNS; i++) {
+                start = g_get_monotonic_time();
+                ops   = benches[b].run(data, n);
+                best  = MIN(best, g_get_monotonic_time() - start);
+            }
+            benches[b].teardown(data);
+
+            g_strlcpy(r.name, benches[b].name, sizeof(r.name));
+            r.size      = n;
+            r.ns_per_op = best * 1000.0 / MAX(ops, 1);
+            base        = baseline_find(baseline, &r);
+            if (base && r.ns_per_op > base->ns_per_op * (1.0 + threshold / 100)) {
+                regressions++;
+            }
+
+            /* one result per line, as expected by baseline_load() */
+            if (!first) {
+                fprintf(out, ",\n");
+            }
+            first = FALSE;
+            print_result(&r, base);
+        }
+    }
+    fprintf(out, "\n],\"regressions\":%u}\n", regressions);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    g_rmdir(tmpdir);
+    g_free(tmpdir);
+    g_strfreev(size_list);
+    if (baseline) {
+        g_array_free(baseline, TRUE);
+    }
+
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
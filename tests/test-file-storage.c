@@ -126,6 +126,33 @@ static void test_ephemeral_with_file(void)
     g_free(file_path);
 }
 
+static void test_copy(void)
+{
+    FileStorage *s, *copy;
+    char **lines;
+
+    s = file_storage_new(pwd, none_existing_file, TRUE);
+    file_storage_append(s, "%s\n", "foo");
+
+    copy = file_storage_copy(s);
+    g_assert_true(file_storage_is_readonly(copy));
+    g_assert_cmpstr(file_storage_get_path(s), ==, file_storage_get_path(copy));
+
+    /* data appended after the copy is not seen by the copy */
+    file_storage_append(s, "%s\n", "bar");
+    lines = file_storage_get_lines(copy);
+    g_assert_cmpint(g_strv_length(lines), ==, 2);
+    g_assert_cmpstr(lines[0], ==, "foo");
+    g_strfreev(lines);
+
+    lines = file_storage_get_lines(s);
+    g_assert_cmpint(g_strv_length(lines), ==, 3);
+    g_strfreev(lines);
+
+    file_storage_free(s);
+    file_storage_free(copy);
+}
+
 int main(int argc, char *argv[])
 {
     int result;
@@ -136,6 +163,7 @@ int main(int argc, char *argv[])
     g_test_add_func("/test-file-storage/ephemeral-no-file", test_ephemeral_no_file);
     g_test_add_func("/test-file-storage/file-created", test_file_created);
     g_test_add_func("/test-file-storage/ephemeral-with-file", test_ephemeral_with_file);
+    g_test_add_func("/test-file-storage/copy", test_copy);
 
     result = g_test_run();
 
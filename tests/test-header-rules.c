@@ -0,0 +1,201 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2026 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <src/main.h>
+#include <src/ext-proxy.h>
+#include <src/webextension/ext-headers.h>
+#include <src/webextension/ext-main.h>
+
+#define REMOVE "(remove)"
+
+/* provide a minimal Vimb struct required by the linked sources */
+struct Vimb vb;
+
+static const char *headers =
+    "X-A=global,X-B=global,Example.com:X-A=com,sub.example.com:x-a=sub,example.com:X-B";
+
+/**
+ * Returns the value of the compiled rule for the header of host, REMOVE if
+ * the header is removed or NULL if there is no such rule.
+ */
+static char *rule_get(GVariant *rules, const char *host, const char *name)
+{
+    GVariant *actions;
+    GVariantIter iter;
+    const char *n, *v;
+    char *result = NULL;
+
+    actions = g_variant_lookup_value(rules, host, G_VARIANT_TYPE("a(sms)"));
+    if (!actions) {
+        return NULL;
+    }
+    g_variant_iter_init(&iter, actions);
+    while (g_variant_iter_next(&iter, "(&sm&s)", &n, &v)) {
+        if (!strcmp(n, name)) {
+            g_free(result);
+            result = g_strdup(v ? v : REMOVE);
+        }
+    }
+    g_variant_unref(actions);
+
+    return result;
+}
+
+/**
+ * Returns the value the resolved actions set for the header, REMOVE if the
+ * header is removed or NULL if the header is not changed.
+ */
+static const char *action_get(GPtrArray *actions, const char *name)
+{
+    HeaderAction *action;
+    const char *result = NULL;
+    guint i, count = 0;
+
+    for (i = 0; actions && i < actions->len; i++) {
+        action = g_ptr_array_index(actions, i);
+        if (!g_ascii_strcasecmp(action->name, name)) {
+            result = action->value ? action->value : REMOVE;
+            count++;
+        }
+    }
+    /* each header is changed only once */
+    g_assert_cmpuint(count, <=, 1);
+
+    return result;
+}
+
+static void test_compile(void)
+{
+    GVariant *rules;
+    char *value;
+
+    rules = g_variant_ref_sink(ext_proxy_compile_header_rules(headers));
+    g_assert_true(g_variant_is_of_type(rules, G_VARIANT_TYPE(VB_HEADER_RULES_TYPE)));
+    /* global rules, example.com and sub.example.com */
+    g_assert_cmpuint(g_variant_n_children(rules), ==, 3);
+
+    value = rule_get(rules, "", "X-A");
+    g_assert_cmpstr(value, ==, "global");
+    g_free(value);
+
+    /* hosts are lower cased, the header names are kept */
+    value = rule_get(rules, "example.com", "X-A");
+    g_assert_cmpstr(value, ==, "com");
+    g_free(value);
+    value = rule_get(rules, "example.com", "X-B");
+    g_assert_cmpstr(value, ==, REMOVE);
+    g_free(value);
+    g_assert_null(rule_get(rules, "Example.com", "X-A"));
+
+    value = rule_get(rules, "sub.example.com", "x-a");
+    g_assert_cmpstr(value, ==, "sub");
+    g_free(value);
+
+    g_variant_unref(rules);
+}
+
+static void test_compile_empty(void)
+{
+    GVariant *rules;
+
+    rules = g_variant_ref_sink(ext_proxy_compile_header_rules(""));
+    g_assert_true(g_variant_is_of_type(rules, G_VARIANT_TYPE(VB_HEADER_RULES_TYPE)));
+    g_assert_cmpuint(g_variant_n_children(rules), ==, 0);
+    g_assert_null(ext_headers_new(rules));
+    g_variant_unref(rules);
+}
+
+static void test_resolve(void)
+{
+    GVariant *rules;
+    HeaderRules *hr;
+    GPtrArray *actions;
+
+    rules = g_variant_ref_sink(ext_proxy_compile_header_rules(headers));
+    hr    = ext_headers_new(rules);
+    g_variant_unref(rules);
+    g_assert_nonnull(hr);
+
+    /* the most specific host wins for each header */
+    actions = ext_headers_lookup(hr, "https://user@Sub.Example.COM:8080/path?q#f");
+    g_assert_cmpuint(actions->len, ==, 2);
+    g_assert_cmpstr(action_get(actions, "X-A"), ==, "sub");
+    g_assert_cmpstr(action_get(actions, "X-B"), ==, REMOVE);
+
+    actions = ext_headers_lookup(hr, "http://example.com/");
+    g_assert_cmpuint(actions->len, ==, 2);
+    g_assert_cmpstr(action_get(actions, "X-A"), ==, "com");
+    g_assert_cmpstr(action_get(actions, "X-B"), ==, REMOVE);
+
+    /* parent domains match only at a dot */
+    actions = ext_headers_lookup(hr, "http://notexample.com/");
+    g_assert_cmpuint(actions->len, ==, 2);
+    g_assert_cmpstr(action_get(actions, "X-A"), ==, "global");
+    g_assert_cmpstr(action_get(actions, "X-B"), ==, "global");
+
+    /* uris without host get the global rules */
+    actions = ext_headers_lookup(hr, "about:blank");
+    g_assert_cmpstr(action_get(actions, "X-A"), ==, "global");
+
+    ext_headers_free(hr);
+}
+
+static void test_resolve_cache(void)
+{
+    GVariant *rules;
+    HeaderRules *hr;
+    GPtrArray *actions;
+    char *uri;
+    int i;
+
+    rules = g_variant_ref_sink(ext_proxy_compile_header_rules("example.com:X-A=com"));
+    hr    = ext_headers_new(rules);
+    g_variant_unref(rules);
+
+    /* without global rules other hosts are not changed */
+    g_assert_null(ext_headers_lookup(hr, "http://example.org/"));
+
+    /* the resolved actions stay right while the cache is trimmed */
+    for (i = 0; i < 200; i++) {
+        uri     = g_strdup_printf("http://h%d.example.com/", i);
+        actions = ext_headers_lookup(hr, uri);
+        g_assert_cmpstr(action_get(actions, "X-A"), ==, "com");
+        g_free(uri);
+    }
+    actions = ext_headers_lookup(hr, "http://example.com/");
+    g_assert_cmpstr(action_get(actions, "X-A"), ==, "com");
+
+    ext_headers_free(hr);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    memset(&vb, 0, sizeof(vb));
+
+    g_test_add_func("/test-header-rules/compile", test_compile);
+    g_test_add_func("/test-header-rules/compile-empty", test_compile_empty);
+    g_test_add_func("/test-header-rules/resolve", test_resolve);
+    g_test_add_func("/test-header-rules/resolve-cache", test_resolve_cache);
+
+    return g_test_run();
+}
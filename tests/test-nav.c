@@ -0,0 +1,135 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2026 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <src/main.h>
+#include <src/nav.h>
+
+/* provide a minimal Vimb struct required by the linked sources */
+struct Vimb vb;
+
+static void test_nav_get_reuse(void)
+{
+    Client *c = g_new0(Client, 1);
+    NavContext *ctx;
+
+    ctx = nav_get(c, "http://example.com/");
+    g_assert_nonnull(ctx);
+    g_assert_true(nav_get(c, "http://example.com/") == ctx);
+    g_assert_null(nav_get(c, NULL));
+
+    nav_client_remove(c);
+    g_free(c);
+}
+
+static void test_nav_get_redirect(void)
+{
+    Client *c = g_new0(Client, 1);
+    NavContext *ctx;
+
+    ctx = nav_ref(nav_get(c, "http://example.com/"));
+    g_assert_true(nav_get(c, "https://example.com/login") != ctx);
+    g_assert_cmpstr(nav_get(c, "https://example.com/login")->path, ==, "/login");
+    /* the former context is still usable by the holder of a reference */
+    g_assert_cmpstr(ctx->uri, ==, "http://example.com/");
+    nav_unref(ctx);
+
+    nav_client_remove(c);
+    g_free(c);
+}
+
+static void test_nav_begin_pending(void)
+{
+    Client *c = g_new0(Client, 1);
+    NavContext *page, *decided;
+
+    page = nav_get(c, "http://example.com/");
+
+    /* a decided navigation of a subframe does not replace the page context */
+    nav_begin(c, "http://ads.example.org/frame");
+    g_assert_true(nav_get(c, "http://example.com/") == page);
+
+    /* a decided navigation is taken over by the load of the main frame */
+    decided = nav_begin(c, "http://example.net/");
+    g_assert_true(nav_get(c, "http://example.net/") == decided);
+    g_assert_true(nav_get(c, "http://example.net/") == decided);
+
+    nav_client_remove(c);
+    g_free(c);
+}
+
+static void test_nav_wildmatch(void)
+{
+    Client *c = g_new0(Client, 1);
+    NavContext *ctx;
+
+    ctx = nav_get(c, "http://example.com/index.html");
+    g_assert_cmpuint(g_hash_table_size(ctx->matches), ==, 0);
+
+    g_assert_true(nav_wildmatch(ctx, "*example.com*"));
+    g_assert_false(nav_wildmatch(ctx, "*.org/*"));
+    g_assert_cmpuint(g_hash_table_size(ctx->matches), ==, 2);
+
+    /* further matches are answered from the memo */
+    g_assert_true(nav_wildmatch(ctx, "*example.com*"));
+    g_assert_false(nav_wildmatch(ctx, "*.org/*"));
+    g_assert_cmpuint(g_hash_table_size(ctx->matches), ==, 2);
+    g_assert_true(g_hash_table_contains(ctx->matches, "*example.com*"));
+
+    nav_client_remove(c);
+    g_free(c);
+}
+
+static void test_nav_host_lowercase(void)
+{
+    Client *c = g_new0(Client, 1);
+    NavContext *ctx;
+
+    ctx = nav_get(c, "HTTP://WWW.Example.COM/Path");
+    g_assert_cmpstr(ctx->scheme, ==, "http");
+    g_assert_cmpstr(ctx->host, ==, "www.example.com");
+    g_assert_cmpstr(ctx->path, ==, "/Path");
+
+    ctx = nav_get(c, "about:blank");
+    g_assert_null(ctx->host);
+
+    nav_client_remove(c);
+    g_free(c);
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    memset(&vb, 0, sizeof(vb));
+
+    g_test_add_func("/test-nav/get-reuse", test_nav_get_reuse);
+    g_test_add_func("/test-nav/get-redirect", test_nav_get_redirect);
+    g_test_add_func("/test-nav/begin-pending", test_nav_begin_pending);
+    g_test_add_func("/test-nav/wildmatch", test_nav_wildmatch);
+    g_test_add_func("/test-nav/host-lowercase", test_nav_host_lowercase);
+
+    result = g_test_run();
+    nav_cleanup();
+
+    return result;
+}
@@ -285,6 +285,30 @@ static void test_strescape(void)
     }
 }
 
+static void test_json_append_string(void)
+{
+    unsigned int i;
+    GString *str = g_string_new(NULL);
+    struct {
+        char *in;
+        char *expected;
+    } data[] = {
+        {"", "\"\""},
+        {"foo", "\"foo\""},
+        {"a\"b\\c", "\"a\\\"b\\\\c\""},
+        {"a\nb\tc\r", "\"a\\nb\\tc\\r\""},
+        {"v\vb\b", "\"v\\u000bb\\u0008\""},
+        {"http://example.com/caf\xc3\xa9", "\"http://example.com/caf\xc3\xa9\""},
+        {"bad\xff", "\"bad\xef\xbf\xbd\""},
+    };
+    for (i = 0; i < LENGTH(data); i++) {
+        g_string_truncate(str, 0);
+        util_json_append_string(str, data[i].in);
+        g_assert_cmpstr(str->str, ==, data[i].expected);
+    }
+    g_string_free(str, TRUE);
+}
+
 static void test_string_to_timespan(void)
 {
     g_assert_cmpuint(util_string_to_timespan("d"), ==, G_TIME_SPAN_DAY);
@@ -328,6 +352,7 @@ int main(int argc, char *argv[])
     g_test_add_func("/test-util/wildmatch-complete", test_wildmatch_complete);
     g_test_add_func("/test-util/wildmatch-multi", test_wildmatch_multi);
     g_test_add_func("/test-util/strescape", test_strescape);
+    g_test_add_func("/test-util/json-append-string", test_json_append_string);
     g_test_add_func("/test-util/string_to_timespan", test_string_to_timespan);
 
     return g_test_run();